@@ -0,0 +1,199 @@
+//Compares BVH build modes and triangle layouts on the shipped OBJ files and a synthetic mesh of long, thin triangles.
+//Modes ending in 4 or 8 intersect the leaves as SIMD triangle blocks of that width.
+//Usage: BVHBenchmark [resource directory] [frames]
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/ThreadPool.h"
+#include "../src/Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr int Width{ 320 };
+	constexpr int Height{ 240 };
+
+	struct BenchmarkResult
+	{
+		float buildTime{};
+		size_t nodeCount{};
+		uint32_t referenceCount{};
+		float cost{};
+		double nodeVisitsPerRay{};
+		double primitiveTestsPerRay{};
+		double frameTime{};
+		int hitCount{};
+	};
+
+	//long, thin strips running along the axes, like beams and window frames in architectural models
+	TriangleMesh CreateSkinnyMesh(int triangleCount)
+	{
+		std::mt19937 rng{ 12345 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> length{ 4.f, 10.f };
+		std::uniform_int_distribution<int> axis{ 0, 2 };
+		std::uniform_int_distribution<int> sideOffset{ 1, 2 };
+
+		TriangleMesh mesh{};
+		mesh.cullMode = TriangleCullMode::NoCulling;
+		for (int triangleIdx{}; triangleIdx < triangleCount; ++triangleIdx)
+		{
+			const Vector3 start{ position(rng), position(rng), position(rng) };
+
+			const int lengthAxis{ axis(rng) };
+			Vector3 end{ start };
+			end[lengthAxis] += length(rng);
+
+			//width along one of the other axes, so the triangle never collapses into a line
+			Vector3 side{ start };
+			side[(lengthAxis + sideOffset(rng)) % 3] += .02f;
+
+			mesh.AppendTriangle(Triangle{ start, end, side }, true);
+		}
+		return mesh;
+	}
+
+	//traces one pinhole camera frame looking at the mesh from the front
+	BenchmarkResult TraceFrames(const TriangleMesh& mesh, int frameCount)
+	{
+		const Vector3 center{ (mesh.transformedMinAABB + mesh.transformedMaxAABB) * .5f };
+		const float radius{ (mesh.transformedMaxAABB - mesh.transformedMinAABB).Magnitude() * .5f };
+		const Vector3 origin{ center - Vector3::UnitZ * radius * 2.5f };
+
+		const float aspectRatio{ static_cast<float>(Width) / Height };
+		const float fov{ std::tan(22.5f * TO_RADIANS) };
+
+		BenchmarkResult result{};
+		TraversalStats stats{};
+
+		const std::vector<uint32_t>& primitiveIndices{ mesh.bvh.GetPrimitiveIndices() };
+		const float cullSign{ GeometryUtils::GetCullSign(mesh.cullMode) };
+		HitRecord closestHit{};
+		const auto intersectTriangle{ [&](uint32_t triangleIdx, Ray& currentRay)
+			{
+				if (!GeometryUtils::HitTest_Triangle(mesh.triangleRecords[triangleIdx], mesh.cullMode, mesh.materialIndex, currentRay, closestHit)) return false;
+				currentRay.max = closestHit.t;
+				return true;
+			} };
+
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+		for (int frameIdx{}; frameIdx < frameCount; ++frameIdx)
+		{
+			for (int py{}; py < Height; ++py)
+			{
+				for (int px{}; px < Width; ++px)
+				{
+					const float cx{ (2.f * (px + .5f) / Width - 1.f) * aspectRatio * fov };
+					const float cy{ (1.f - 2.f * (py + .5f) / Height) * fov };
+					Ray ray{ origin, Vector3{ cx, cy, 1.f }.Normalized() };
+
+					closestHit = HitRecord{};
+					const bool didHit{ GeometryUtils::TraverseBVHLeaves(mesh.bvh, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& currentRay)
+						{
+							switch (mesh.triangleLayout)
+							{
+							case TriangleLayout::Block4:
+								return GeometryUtils::HitTest_TriangleBlocks(mesh.triangleBlocks4, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, currentRay, closestHit);
+							case TriangleLayout::Block8:
+								return GeometryUtils::HitTest_TriangleBlocks(mesh.triangleBlocks8, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, currentRay, closestHit);
+							default:
+								return GeometryUtils::IntersectPrimitives(primitiveIndices, firstPrimitive, primitiveCount, currentRay, intersectTriangle, false);
+							}
+						}, false, &stats) };
+
+					result.hitCount += didHit;
+				}
+			}
+		}
+		const auto endTime{ std::chrono::high_resolution_clock::now() };
+
+		const double rayCount{ static_cast<double>(Width) * Height * frameCount };
+		result.frameTime = std::chrono::duration<double, std::milli>(endTime - startTime).count() / frameCount;
+		result.nodeVisitsPerRay = stats.nodeVisits / rayCount;
+		result.primitiveTestsPerRay = stats.primitiveTests / rayCount;
+		result.hitCount /= frameCount;
+		return result;
+	}
+
+	BenchmarkResult Run(TriangleMesh mesh, BVHBuildMode buildMode, TriangleLayout triangleLayout, ThreadPool& buildThreadPool, int frameCount)
+	{
+		mesh.bvh.SetThreadPool(&buildThreadPool);
+		mesh.bvhBuildMode = buildMode;
+		mesh.triangleLayout = triangleLayout;
+		mesh.bvhUpdateMode = BVHUpdateMode::Rebuild;
+		mesh.UpdateAABB();
+		mesh.UpdateTransforms();
+
+		BenchmarkResult result{ TraceFrames(mesh, frameCount) };
+		result.buildTime = mesh.bvh.GetBuildTime();
+		result.nodeCount = mesh.bvh.GetNodes().size();
+		result.referenceCount = mesh.bvh.GetReferenceCount();
+		result.cost = mesh.bvh.GetCost();
+		return result;
+	}
+
+	void Report(const std::string& name, const TriangleMesh& mesh, ThreadPool& buildThreadPool, int frameCount)
+	{
+		std::cout << name << " (" << mesh.indices.size() / 3 << " triangles)\n";
+		std::cout << "  mode  build ms    nodes     refs    cost  nodes/ray  tris/ray  frame ms   hits\n";
+
+		struct Mode
+		{
+			const char* name;
+			BVHBuildMode buildMode;
+			TriangleLayout triangleLayout;
+		};
+
+		//LBVH leaves hold up to four triangles, which is where the SIMD blocks pay off
+		for (const Mode& mode : { Mode{ "SAH ", BVHBuildMode::SAH, TriangleLayout::Single }, Mode{ "SBVH", BVHBuildMode::SBVH, TriangleLayout::Single },
+			Mode{ "SAH4", BVHBuildMode::SAH, TriangleLayout::Block4 }, Mode{ "SAH8", BVHBuildMode::SAH, TriangleLayout::Block8 },
+			Mode{ "LBVH", BVHBuildMode::LBVH, TriangleLayout::Single }, Mode{ "LBV4", BVHBuildMode::LBVH, TriangleLayout::Block4 } })
+		{
+			const BenchmarkResult result{ Run(mesh, mode.buildMode, mode.triangleLayout, buildThreadPool, frameCount) };
+			std::cout << "  " << mode.name << std::fixed
+				<< std::setw(10) << std::setprecision(2) << result.buildTime
+				<< std::setw(9) << result.nodeCount
+				<< std::setw(9) << result.referenceCount
+				<< std::setw(8) << std::setprecision(1) << result.cost
+				<< std::setw(11) << std::setprecision(2) << result.nodeVisitsPerRay
+				<< std::setw(10) << result.primitiveTestsPerRay
+				<< std::setw(10) << result.frameTime
+				<< std::setw(7) << result.hitCount << "\n";
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const std::filesystem::path resourceDirectory{ argc > 1 ? argv[1] : "resources" };
+	const int frameCount{ argc > 2 ? std::max(1, std::stoi(argv[2])) : 5 };
+	//LBVH builds run their passes on it
+	ThreadPool buildThreadPool{};
+
+	if (std::filesystem::is_directory(resourceDirectory))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(resourceDirectory))
+		{
+			if (entry.path().extension() != ".obj") continue;
+
+			TriangleMesh mesh{};
+			mesh.cullMode = TriangleCullMode::NoCulling;
+			if (!Utils::ParseOBJ(entry.path().string(), mesh.positions, mesh.normals, mesh.indices) || mesh.indices.empty()) continue;
+
+			Report(entry.path().filename().string(), mesh, buildThreadPool, frameCount);
+		}
+	}
+	else
+	{
+		std::cout << "Resource directory " << resourceDirectory << " not found, only running the synthetic mesh\n\n";
+	}
+
+	Report("synthetic skinny triangles", CreateSkinnyMesh(5000), buildThreadPool, frameCount);
+	return 0;
+}
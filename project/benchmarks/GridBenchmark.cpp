@@ -0,0 +1,196 @@
+//Compares the uniform grid against the BVH on dense sphere (particle) sets.
+//Usage: GridBenchmark [frames]
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr int Width{ 320 };
+	constexpr int Height{ 240 };
+
+	struct BenchmarkResult
+	{
+		float buildTime{};
+		size_t memory{};
+		double nodeVisitsPerRay{};
+		double primitiveTestsPerRay{};
+		double frameTime{};
+		double shadowTime{};
+		int hitCount{};
+	};
+
+	std::vector<Sphere> CreateUniformParticles(int sphereCount)
+	{
+		std::mt19937 rng{ 2024 };
+		std::uniform_real_distribution<float> position{ -10.f, 10.f };
+		std::uniform_real_distribution<float> radius{ .02f, .08f };
+
+		std::vector<Sphere> spheres(sphereCount);
+		for (Sphere& sphere : spheres)
+		{
+			sphere.origin = { position(rng), position(rng), position(rng) };
+			sphere.radius = radius(rng);
+		}
+		return spheres;
+	}
+
+	//a few dense blobs, like molecules or a splash of particles
+	std::vector<Sphere> CreateClusteredParticles(int sphereCount)
+	{
+		std::mt19937 rng{ 4048 };
+		std::uniform_real_distribution<float> position{ -8.f, 8.f };
+		std::normal_distribution<float> spread{ 0.f, 1.f };
+		std::uniform_real_distribution<float> radius{ .02f, .08f };
+
+		std::vector<Vector3> clusterCenters(16);
+		for (Vector3& center : clusterCenters)
+		{
+			center = { position(rng), position(rng), position(rng) };
+		}
+
+		std::vector<Sphere> spheres(sphereCount);
+		for (size_t sphereIdx{}; sphereIdx < spheres.size(); ++sphereIdx)
+		{
+			spheres[sphereIdx].origin = clusterCenters[sphereIdx % clusterCenters.size()] + Vector3{ spread(rng), spread(rng), spread(rng) };
+			spheres[sphereIdx].radius = radius(rng);
+		}
+		return spheres;
+	}
+
+	std::vector<AABB> GetBounds(const std::vector<Sphere>& spheres)
+	{
+		std::vector<AABB> bounds{};
+		bounds.reserve(spheres.size());
+		for (const Sphere& sphere : spheres)
+		{
+			const Vector3 radius{ sphere.radius, sphere.radius, sphere.radius };
+			bounds.emplace_back(AABB{ sphere.origin - radius, sphere.origin + radius });
+		}
+		return bounds;
+	}
+
+	//traverse(Ray&, intersect, anyHit, TraversalStats*) wraps either structure
+	template<typename Traverse>
+	BenchmarkResult TraceFrames(const std::vector<Sphere>& spheres, int frameCount, Traverse&& traverse)
+	{
+		const Vector3 origin{ 0.f, 0.f, -30.f };
+		const Vector3 lightPosition{ 20.f, 20.f, -20.f };
+		const float fov{ std::tan(22.5f * TO_RADIANS) };
+		const float aspectRatio{ static_cast<float>(Width) / Height };
+
+		BenchmarkResult result{};
+		TraversalStats stats{};
+		std::vector<Vector3> hitPoints{};
+		hitPoints.reserve(static_cast<size_t>(Width) * Height);
+
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+		for (int frameIdx{}; frameIdx < frameCount; ++frameIdx)
+		{
+			hitPoints.clear();
+			for (int py{}; py < Height; ++py)
+			{
+				for (int px{}; px < Width; ++px)
+				{
+					const float cx{ (2.f * (px + .5f) / Width - 1.f) * aspectRatio * fov };
+					const float cy{ (1.f - 2.f * (py + .5f) / Height) * fov };
+					Ray ray{ origin, Vector3{ cx, cy, 1.f }.Normalized() };
+
+					HitRecord closestHit{};
+					traverse(ray, [&](uint32_t sphereIdx, Ray& currentRay)
+						{
+							if (!GeometryUtils::HitTest_Sphere(spheres[sphereIdx], currentRay, closestHit)) return false;
+							currentRay.max = closestHit.t;
+							return true;
+						}, false, &stats);
+
+					if (closestHit.didHit) hitPoints.emplace_back(closestHit.origin + closestHit.normal * .001f);
+				}
+			}
+		}
+		const auto shadowStartTime{ std::chrono::high_resolution_clock::now() };
+
+		//one shadow ray per hit of the last frame
+		for (const Vector3& hitPoint : hitPoints)
+		{
+			const Vector3 toLight{ lightPosition - hitPoint };
+			Ray shadowRay{ hitPoint, toLight.Normalized() };
+			shadowRay.max = toLight.Magnitude();
+
+			traverse(shadowRay, [&](uint32_t sphereIdx, Ray& currentRay)
+				{
+					return GeometryUtils::HitTest_Sphere(spheres[sphereIdx], currentRay);
+				}, true, nullptr);
+		}
+		const auto endTime{ std::chrono::high_resolution_clock::now() };
+
+		const double rayCount{ static_cast<double>(Width) * Height * frameCount };
+		result.frameTime = std::chrono::duration<double, std::milli>(shadowStartTime - startTime).count() / frameCount;
+		result.shadowTime = std::chrono::duration<double, std::milli>(endTime - shadowStartTime).count();
+		result.nodeVisitsPerRay = stats.nodeVisits / rayCount;
+		result.primitiveTestsPerRay = stats.primitiveTests / rayCount;
+		result.hitCount = static_cast<int>(hitPoints.size());
+		return result;
+	}
+
+	void PrintRow(const char* name, const BenchmarkResult& result)
+	{
+		std::cout << "  " << name << std::fixed
+			<< std::setw(10) << std::setprecision(2) << result.buildTime
+			<< std::setw(10) << result.memory / 1024
+			<< std::setw(11) << result.nodeVisitsPerRay
+			<< std::setw(11) << result.primitiveTestsPerRay
+			<< std::setw(10) << result.frameTime
+			<< std::setw(11) << result.shadowTime
+			<< std::setw(8) << result.hitCount << "\n";
+	}
+
+	void Report(const std::string& name, const std::vector<Sphere>& spheres, int frameCount)
+	{
+		const std::vector<AABB> bounds{ GetBounds(spheres) };
+
+		std::cout << name << " (" << spheres.size() << " spheres)\n";
+		std::cout << "  type  build ms    mem KB  cells/ray  tests/ray  frame ms  shadow ms    hits\n";
+
+		BVH bvh{};
+		bvh.Build(bounds);
+		BenchmarkResult bvhResult{ TraceFrames(spheres, frameCount, [&](Ray& ray, auto&& intersect, bool anyHit, TraversalStats* pStats)
+			{
+				return GeometryUtils::TraverseBVH(bvh, ray, intersect, anyHit, pStats);
+			}) };
+		bvhResult.buildTime = bvh.GetBuildTime();
+		bvhResult.memory = bvh.GetNodes().capacity() * sizeof(BVHNode) + bvh.GetPrimitiveIndices().capacity() * sizeof(uint32_t);
+		PrintRow("BVH ", bvhResult);
+
+		UniformGrid grid{};
+		grid.Build(bounds);
+		BenchmarkResult gridResult{ TraceFrames(spheres, frameCount, [&](Ray& ray, auto&& intersect, bool anyHit, TraversalStats* pStats)
+			{
+				return GeometryUtils::TraverseGrid(grid, ray, intersect, anyHit, pStats);
+			}) };
+		gridResult.buildTime = grid.GetBuildTime();
+		gridResult.memory = grid.GetMemoryUsage();
+		PrintRow("Grid", gridResult);
+
+		const int* resolution{ grid.GetResolution() };
+		std::cout << "  grid resolution " << resolution[0] << "x" << resolution[1] << "x" << resolution[2] << "\n" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int frameCount{ argc > 1 ? std::max(1, std::stoi(argv[1])) : 3 };
+
+	for (const int sphereCount : { 10000, 100000, 1000000 })
+	{
+		Report("uniform particles", CreateUniformParticles(sphereCount), frameCount);
+		Report("clustered particles", CreateClusteredParticles(sphereCount), frameCount);
+	}
+	return 0;
+}
@@ -0,0 +1,161 @@
+//Compares the Vector3/ColorRGB build (scalar, or SSE with USE_SIMD_MATH) against a plain scalar reference.
+//Usage: MathBenchmark [iterations]
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/Maths.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr size_t VectorCount{ 4096 };
+
+	//the scalar Vector3 implementation, kept here so both can be timed in one binary
+	struct ScalarVector3
+	{
+		float x{};
+		float y{};
+		float z{};
+
+		static float Dot(const ScalarVector3& v1, const ScalarVector3& v2) { return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z; }
+		static ScalarVector3 Cross(const ScalarVector3& v1, const ScalarVector3& v2)
+		{
+			return { v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
+		}
+		ScalarVector3 Normalized() const
+		{
+			const float m{ std::sqrt(x * x + y * y + z * z) };
+			return { x / m, y / m, z / m };
+		}
+		ScalarVector3 operator*(float scale) const { return { x * scale, y * scale, z * scale }; }
+		ScalarVector3 operator+(const ScalarVector3& v) const { return { x + v.x, y + v.y, z + v.z }; }
+		ScalarVector3 operator-(const ScalarVector3& v) const { return { x - v.x, y - v.y, z - v.z }; }
+	};
+
+	struct BenchmarkResult
+	{
+		double referenceTime{}; //nanoseconds per operation
+		double vectorTime{};
+		float maxError{};
+	};
+
+	template<typename Function>
+	double TimePerOperation(int iterations, Function&& function)
+	{
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+		for (int iteration{}; iteration < iterations; ++iteration)
+		{
+			function();
+		}
+		const double elapsed{ std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - startTime).count() };
+		return elapsed / (static_cast<double>(iterations) * VectorCount);
+	}
+
+	//referenceOperation(size_t idx) and vectorOperation(size_t idx) both return the float that gets checked and accumulated
+	template<typename ReferenceOperation, typename VectorOperation>
+	BenchmarkResult Run(int iterations, ReferenceOperation&& referenceOperation, VectorOperation&& vectorOperation)
+	{
+		BenchmarkResult result{};
+		for (size_t idx{}; idx < VectorCount; ++idx)
+		{
+			result.maxError = std::max(result.maxError, std::abs(referenceOperation(idx) - vectorOperation(idx)));
+		}
+
+		//the sinks keep the compiler from dropping the loops
+		volatile float sink{};
+		result.referenceTime = TimePerOperation(iterations, [&]()
+			{
+				float sum{};
+				for (size_t idx{}; idx < VectorCount; ++idx) sum += referenceOperation(idx);
+				sink = sink + sum;
+			});
+		result.vectorTime = TimePerOperation(iterations, [&]()
+			{
+				float sum{};
+				for (size_t idx{}; idx < VectorCount; ++idx) sum += vectorOperation(idx);
+				sink = sink + sum;
+			});
+		return result;
+	}
+
+	void Report(const std::string& name, const BenchmarkResult& result)
+	{
+		std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+			<< std::setprecision(2) << std::setw(12) << result.referenceTime
+			<< std::setw(12) << result.vectorTime
+			<< std::setw(10) << result.referenceTime / result.vectorTime << "x"
+			<< std::scientific << std::setprecision(2) << std::setw(14) << result.maxError << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int iterations{ argc > 1 ? std::stoi(argv[1]) : 2000 };
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> value{ -1.f, 1.f };
+
+	std::vector<ScalarVector3> referenceA(VectorCount), referenceB(VectorCount);
+	std::vector<Vector3> vectorA(VectorCount), vectorB(VectorCount);
+	std::vector<ColorRGB> colorA(VectorCount), colorB(VectorCount);
+	for (size_t idx{}; idx < VectorCount; ++idx)
+	{
+		referenceA[idx] = { value(rng), value(rng), value(rng) };
+		referenceB[idx] = { value(rng), value(rng), value(rng) };
+		vectorA[idx] = { referenceA[idx].x, referenceA[idx].y, referenceA[idx].z };
+		vectorB[idx] = { referenceB[idx].x, referenceB[idx].y, referenceB[idx].z };
+		colorA[idx] = { std::abs(referenceA[idx].x), std::abs(referenceA[idx].y), std::abs(referenceA[idx].z) };
+		colorB[idx] = { std::abs(referenceB[idx].x), std::abs(referenceB[idx].y), std::abs(referenceB[idx].z) };
+	}
+
+#if defined(SIMD_MATH)
+	std::cout << "Vector3/ColorRGB: SSE (USE_SIMD_MATH)" << std::endl;
+#else
+	std::cout << "Vector3/ColorRGB: scalar" << std::endl;
+#endif
+	std::cout << iterations << " iterations over " << VectorCount << " vectors, nanoseconds per operation\n" << std::endl;
+	std::cout << std::left << std::setw(12) << "operation" << std::right << std::setw(12) << "reference" << std::setw(12) << "Vector3"
+		<< std::setw(11) << "speedup" << std::setw(14) << "max error" << std::endl;
+
+	Report("Dot", Run(iterations,
+		[&](size_t idx) { return ScalarVector3::Dot(referenceA[idx], referenceB[idx]); },
+		[&](size_t idx) { return Vector3::Dot(vectorA[idx], vectorB[idx]); }));
+
+	Report("Cross", Run(iterations,
+		[&](size_t idx) { const ScalarVector3 cross{ ScalarVector3::Cross(referenceA[idx], referenceB[idx]) }; return cross.x + cross.y + cross.z; },
+		[&](size_t idx) { const Vector3 cross{ Vector3::Cross(vectorA[idx], vectorB[idx]) }; return cross.x + cross.y + cross.z; }));
+
+	Report("Normalized", Run(iterations,
+		[&](size_t idx) { const ScalarVector3 normal{ referenceA[idx].Normalized() }; return normal.x + normal.y + normal.z; },
+		[&](size_t idx) { const Vector3 normal{ vectorA[idx].Normalized() }; return normal.x + normal.y + normal.z; }));
+
+	//the half vector and reflection of the BRDFs
+	Report("Reflect", Run(iterations,
+		[&](size_t idx)
+		{
+			const ScalarVector3 reflect{ referenceA[idx] - referenceB[idx] * (2.f * ScalarVector3::Dot(referenceA[idx], referenceB[idx])) };
+			return ScalarVector3::Dot((referenceA[idx] + referenceB[idx]).Normalized(), reflect);
+		},
+		[&](size_t idx)
+		{
+			const Vector3 reflect{ Vector3::Reflect(vectorA[idx], vectorB[idx]) };
+			return Vector3::Dot((vectorA[idx] + vectorB[idx]).Normalized(), reflect);
+		}));
+
+	Report("ColorMad", Run(iterations,
+		[&](size_t idx)
+		{
+			const float r{ colorA[idx].r * colorB[idx].r * .5f + colorB[idx].r };
+			const float g{ colorA[idx].g * colorB[idx].g * .5f + colorB[idx].g };
+			const float b{ colorA[idx].b * colorB[idx].b * .5f + colorB[idx].b };
+			return r + g + b;
+		},
+		[&](size_t idx) { const ColorRGB color{ colorA[idx] * colorB[idx] * .5f + colorB[idx] }; return color.r + color.g + color.b; }));
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+//Per-ray cost of the single-threaded hot path: camera ray setup, closest hit through the mesh BVH, one shadow ray and a Lambert term.
+//Reports retired instructions per ray (Linux perf counters, when the kernel allows them) and TSC cycles per ray.
+//Usage: RayCostBenchmark [resource directory] [frames]
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../src/Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr int Width{ 320 };
+	constexpr int Height{ 240 };
+
+	//hardware counter of retired user-space instructions, IsAvailable() is false without perf access (and off Linux)
+	class InstructionCounter final
+	{
+	public:
+		InstructionCounter()
+		{
+#if defined(__linux__)
+			perf_event_attr attributes{};
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.size = sizeof(attributes);
+			attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			m_FileDescriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+		}
+
+		~InstructionCounter()
+		{
+#if defined(__linux__)
+			if (IsAvailable()) close(m_FileDescriptor);
+#endif
+		}
+
+		InstructionCounter(const InstructionCounter&) = delete;
+		InstructionCounter(InstructionCounter&&) noexcept = delete;
+		InstructionCounter& operator=(const InstructionCounter&) = delete;
+		InstructionCounter& operator=(InstructionCounter&&) noexcept = delete;
+
+		bool IsAvailable() const { return m_FileDescriptor >= 0; }
+
+		void Start()
+		{
+#if defined(__linux__)
+			if (!IsAvailable()) return;
+			ioctl(m_FileDescriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(m_FileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+		}
+
+		uint64_t Stop()
+		{
+			uint64_t instructionCount{};
+#if defined(__linux__)
+			if (!IsAvailable()) return 0;
+			ioctl(m_FileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(m_FileDescriptor, &instructionCount, sizeof(instructionCount)) != sizeof(instructionCount)) return 0;
+#endif
+			return instructionCount;
+		}
+
+	private:
+		int m_FileDescriptor{ -1 };
+	};
+
+	struct BenchmarkResult
+	{
+		double instructionsPerRay{};
+		double cyclesPerRay{};
+		double nanosecondsPerRay{};
+		int hitCount{};
+		double lambertSum{}; //checksum of the shading, has to stay the same across builds
+	};
+
+	TriangleMesh CreateRandomMesh(int triangleCount)
+	{
+		std::mt19937 rng{ 777 };
+		std::uniform_real_distribution<float> position{ -1.f, 1.f };
+		std::uniform_real_distribution<float> offset{ -.1f, .1f };
+
+		TriangleMesh mesh{};
+		for (int triangleIdx{}; triangleIdx < triangleCount; ++triangleIdx)
+		{
+			const Vector3 center{ position(rng), position(rng), position(rng) };
+			mesh.AppendTriangle(Triangle{ center + Vector3{ offset(rng), offset(rng), offset(rng) },
+				center + Vector3{ offset(rng), offset(rng), offset(rng) },
+				center + Vector3{ offset(rng), offset(rng), offset(rng) } }, true);
+		}
+		return mesh;
+	}
+
+	BenchmarkResult TraceFrames(const TriangleMesh& mesh, int frameCount, InstructionCounter& counter)
+	{
+		const Vector3 center{ (mesh.transformedMinAABB + mesh.transformedMaxAABB) * .5f };
+		const float radius{ (mesh.transformedMaxAABB - mesh.transformedMinAABB).Magnitude() * .5f };
+		const Vector3 lightPosition{ center + Vector3{ radius, radius * 2.f, -radius * 2.f } };
+
+		//a slightly rotated camera, so the ray setup goes through a full matrix like in the renderer
+		const Matrix cameraToWorld{ Matrix::CreateRotationY(.1f) * Matrix::CreateTranslation(center - Vector3::UnitZ * radius * 2.5f) };
+		const Vector3 origin{ cameraToWorld.GetTranslation() };
+		const float aspectRatio{ static_cast<float>(Width) / Height };
+		const float fov{ std::tan(22.5f * TO_RADIANS) };
+
+		BenchmarkResult result{};
+
+		counter.Start();
+		const uint64_t startCycles{ __rdtsc() };
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+		for (int frameIdx{}; frameIdx < frameCount; ++frameIdx)
+		{
+			for (int py{}; py < Height; ++py)
+			{
+				for (int px{}; px < Width; ++px)
+				{
+					const float cx{ (2.f * (px + .5f) / Width - 1.f) * aspectRatio * fov };
+					const float cy{ (1.f - 2.f * (py + .5f) / Height) * fov };
+					const Ray ray{ origin, cameraToWorld.TransformVector(Vector3{ cx, cy, 1.f }).Normalized() };
+
+					HitRecord closestHit{};
+					if (!GeometryUtils::HitTest_TriangleMesh(mesh, ray, closestHit)) continue;
+					++result.hitCount;
+
+					Vector3 toLight{ lightPosition - closestHit.origin };
+					const float distanceToLight{ toLight.Normalize() };
+					Ray shadowRay{ closestHit.origin + toLight * .01f, toLight };
+					shadowRay.max = distanceToLight;
+					if (GeometryUtils::Occluded_TriangleMesh(mesh, shadowRay)) continue;
+
+					result.lambertSum += std::abs(Vector3::Dot(closestHit.normal, toLight));
+				}
+			}
+		}
+		const auto endTime{ std::chrono::high_resolution_clock::now() };
+		const uint64_t endCycles{ __rdtsc() };
+		const uint64_t instructionCount{ counter.Stop() };
+
+		const double rayCount{ static_cast<double>(Width) * Height * frameCount };
+		result.instructionsPerRay = instructionCount / rayCount;
+		result.cyclesPerRay = (endCycles - startCycles) / rayCount;
+		result.nanosecondsPerRay = std::chrono::duration<double, std::nano>(endTime - startTime).count() / rayCount;
+		result.hitCount /= frameCount;
+		result.lambertSum /= frameCount;
+		return result;
+	}
+
+	void Report(const std::string& name, TriangleMesh mesh, int frameCount, InstructionCounter& counter)
+	{
+		mesh.cullMode = TriangleCullMode::NoCulling;
+		mesh.UpdateAABB();
+		mesh.UpdateTransforms();
+
+		const BenchmarkResult result{ TraceFrames(mesh, frameCount, counter) };
+		std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1);
+		if (counter.IsAvailable()) std::cout << std::setw(14) << result.instructionsPerRay;
+		else std::cout << std::setw(14) << "n/a";
+		std::cout << std::setw(12) << result.cyclesPerRay << std::setw(10) << result.nanosecondsPerRay << std::setw(8) << result.hitCount
+			<< std::setw(12) << std::setprecision(2) << result.lambertSum << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const std::filesystem::path resourceDirectory{ argc > 1 ? argv[1] : "resources" };
+	const int frameCount{ argc > 2 ? std::max(1, std::stoi(argv[2])) : 5 };
+
+	InstructionCounter counter{};
+	if (!counter.IsAvailable()) std::cout << "Instruction counter unavailable (no perf access), only reporting cycles\n";
+	std::cout << std::left << std::setw(28) << "scene" << std::right << std::setw(14) << "instr/ray" << std::setw(12) << "cycles/ray"
+		<< std::setw(10) << "ns/ray" << std::setw(8) << "hits" << std::setw(12) << "checksum" << std::endl;
+
+	const std::filesystem::path bunnyPath{ resourceDirectory / "lowpoly_bunny.obj" };
+	TriangleMesh bunny{};
+	if (std::filesystem::exists(bunnyPath) && Utils::ParseOBJ(bunnyPath.string(), bunny.positions, bunny.normals, bunny.indices))
+		Report("lowpoly_bunny.obj", bunny, frameCount, counter);
+
+	Report("random triangles", CreateRandomMesh(20000), frameCount, counter);
+	return 0;
+}
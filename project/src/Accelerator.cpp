@@ -0,0 +1,436 @@
+#include "Accelerator.h"
+#include "Utils.h"
+
+#include <bit>
+#include <chrono>
+
+namespace dae
+{
+#pragma region Geometry
+	uint32_t AcceleratorGeometry::GetPrimitiveCount() const
+	{
+		return static_cast<uint32_t>(pSpheres->size() + pMeshes->size() + pInstances->size());
+	}
+
+	std::vector<AABB> AcceleratorGeometry::GetPrimitiveBounds() const
+	{
+		std::vector<AABB> primitiveBounds{};
+		primitiveBounds.reserve(GetPrimitiveCount());
+
+		for (const Sphere& sphere : *pSpheres)
+		{
+			const Vector3 radius{ sphere.radius, sphere.radius, sphere.radius };
+			primitiveBounds.emplace_back(AABB{ sphere.origin - radius, sphere.origin + radius });
+		}
+
+		for (const TriangleMesh& mesh : *pMeshes)
+		{
+			primitiveBounds.emplace_back(AABB{ mesh.transformedMinAABB, mesh.transformedMaxAABB });
+		}
+
+		for (const MeshInstance& instance : *pInstances)
+		{
+			primitiveBounds.emplace_back(AABB{ instance.transformedMinAABB, instance.transformedMaxAABB });
+		}
+
+		return primitiveBounds;
+	}
+
+	bool AcceleratorGeometry::HitTest_Primitive(uint32_t primitiveIdx, const Ray& ray, HitRecord& hitRecord) const
+	{
+		if (primitiveIdx < pSpheres->size())
+			return GeometryUtils::HitTest_Sphere((*pSpheres)[primitiveIdx], ray, hitRecord);
+		primitiveIdx -= static_cast<uint32_t>(pSpheres->size());
+
+		if (primitiveIdx < pMeshes->size())
+			return GeometryUtils::HitTest_TriangleMesh((*pMeshes)[primitiveIdx], ray, hitRecord);
+		primitiveIdx -= static_cast<uint32_t>(pMeshes->size());
+
+		return GeometryUtils::HitTest_MeshInstance((*pInstances)[primitiveIdx], ray, hitRecord);
+	}
+
+	bool AcceleratorGeometry::Occluded_Primitive(uint32_t primitiveIdx, const Ray& ray) const
+	{
+		if (primitiveIdx < pSpheres->size())
+			return GeometryUtils::HitTest_Sphere((*pSpheres)[primitiveIdx], ray);
+		primitiveIdx -= static_cast<uint32_t>(pSpheres->size());
+
+		if (primitiveIdx < pMeshes->size())
+			return GeometryUtils::Occluded_TriangleMesh((*pMeshes)[primitiveIdx], ray);
+		primitiveIdx -= static_cast<uint32_t>(pMeshes->size());
+
+		return GeometryUtils::Occluded_MeshInstance((*pInstances)[primitiveIdx], ray);
+	}
+
+	void AcceleratorGeometry::HitTest_Primitive(uint32_t primitiveIdx, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords) const
+	{
+		const uint32_t meshIdx{ primitiveIdx - static_cast<uint32_t>(pSpheres->size()) };
+		if (primitiveIdx >= pSpheres->size() && meshIdx < pMeshes->size())
+		{
+			GeometryUtils::HitTest_TriangleMesh((*pMeshes)[meshIdx], packet, rayMask, hitRecords);
+			return;
+		}
+
+		//spheres are single tests anyway, instances need every ray moved into object space
+		for (; rayMask; rayMask &= rayMask - 1)
+		{
+			const uint32_t lane{ static_cast<uint32_t>(std::countr_zero(rayMask)) };
+			if (HitTest_Primitive(primitiveIdx, packet.GetRay(lane), hitRecords[lane])) packet.max[lane] = hitRecords[lane].t;
+		}
+	}
+#pragma endregion
+
+#pragma region Accelerator
+	std::unique_ptr<Accelerator> Accelerator::Create(AcceleratorType type)
+	{
+		switch (type)
+		{
+		case AcceleratorType::Linear:
+			return std::make_unique<LinearAccelerator>();
+		case AcceleratorType::WideBVH4:
+			return std::make_unique<WideBVHAccelerator<4>>();
+		case AcceleratorType::WideBVH8:
+			return std::make_unique<WideBVHAccelerator<8>>();
+		case AcceleratorType::Grid:
+			return std::make_unique<GridAccelerator>();
+		default:
+			return std::make_unique<BVHAccelerator>();
+		}
+	}
+
+	const char* Accelerator::GetName(AcceleratorType type)
+	{
+		switch (type)
+		{
+		case AcceleratorType::Linear:
+			return "Linear";
+		case AcceleratorType::BVH:
+			return "BVH";
+		case AcceleratorType::WideBVH4:
+			return "WideBVH4";
+		case AcceleratorType::WideBVH8:
+			return "WideBVH8";
+		case AcceleratorType::Grid:
+			return "Grid";
+		default:
+			return "Unknown";
+		}
+	}
+
+	void Accelerator::CopyFrom(const Accelerator& source, const AcceleratorGeometry& geometry)
+	{
+		//the sphere store only holds copies of the spheres, so it carries over like the structure
+		m_Geometry = geometry;
+		m_PrimitiveCount = source.m_PrimitiveCount;
+		m_SphereStore = source.m_SphereStore;
+		CopyStructure(source);
+	}
+
+	void Accelerator::IntersectClosestPacket(RayPacket& packet, HitRecord* hitRecords, TraversalStats* pStats) const
+	{
+		for (uint32_t lane{}; lane < packet.rayCount; ++lane)
+		{
+			if (IntersectClosest(packet.GetRay(lane), hitRecords[lane], pStats)) packet.max[lane] = hitRecords[lane].t;
+		}
+	}
+#pragma endregion
+
+	namespace
+	{
+		//spheres of a leaf or cell go through the SoA store in one sweep, meshes and instances are tested one at a time
+		bool IntersectRange(const AcceleratorGeometry& geometry, const SphereStore& sphereStore, const std::vector<uint32_t>& primitiveIndices,
+			uint32_t firstPrimitive, uint32_t primitiveCount, Ray& ray, HitRecord& closestHit)
+		{
+			bool didHit{ sphereStore.HitTest(firstPrimitive, primitiveCount, ray, closestHit) };
+			if (!sphereStore.HasEmptySlots()) return didHit;
+
+			const uint32_t sphereCount{ static_cast<uint32_t>(geometry.pSpheres->size()) };
+			for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+			{
+				const uint32_t primitiveIdx{ primitiveIndices[idx] };
+				if (primitiveIdx < sphereCount) continue;
+
+				HitRecord primitiveHit{};
+				if (!geometry.HitTest_Primitive(primitiveIdx, ray, primitiveHit)) continue;
+
+				closestHit = primitiveHit;
+				ray.max = primitiveHit.t;
+				didHit = true;
+			}
+			return didHit;
+		}
+
+		bool OccludedRange(const AcceleratorGeometry& geometry, const SphereStore& sphereStore, const std::vector<uint32_t>& primitiveIndices,
+			uint32_t firstPrimitive, uint32_t primitiveCount, const Ray& ray)
+		{
+			if (sphereStore.Occluded(firstPrimitive, primitiveCount, ray)) return true;
+			if (!sphereStore.HasEmptySlots()) return false;
+
+			const uint32_t sphereCount{ static_cast<uint32_t>(geometry.pSpheres->size()) };
+			for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+			{
+				const uint32_t primitiveIdx{ primitiveIndices[idx] };
+				if (primitiveIdx >= sphereCount && geometry.Occluded_Primitive(primitiveIdx, ray)) return true;
+			}
+			return false;
+		}
+
+		//packet counterpart of IntersectRange, the spheres are tested ray by ray
+		void IntersectRangePacket(const AcceleratorGeometry& geometry, const SphereStore& sphereStore, const std::vector<uint32_t>& primitiveIndices,
+			uint32_t firstPrimitive, uint32_t primitiveCount, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			for (uint64_t sphereMask{ rayMask }; sphereMask; sphereMask &= sphereMask - 1)
+			{
+				const uint32_t lane{ static_cast<uint32_t>(std::countr_zero(sphereMask)) };
+				Ray ray{ packet.GetRay(lane) };
+				if (sphereStore.HitTest(firstPrimitive, primitiveCount, ray, hitRecords[lane])) packet.max[lane] = ray.max;
+			}
+			if (!sphereStore.HasEmptySlots()) return;
+
+			const uint32_t sphereCount{ static_cast<uint32_t>(geometry.pSpheres->size()) };
+			for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+			{
+				const uint32_t primitiveIdx{ primitiveIndices[idx] };
+				if (primitiveIdx >= sphereCount) geometry.HitTest_Primitive(primitiveIdx, packet, rayMask, hitRecords);
+			}
+		}
+
+		Ray ClampRay(const Ray& ray, const HitRecord& hitRecord)
+		{
+			Ray clampedRay{ ray };
+			clampedRay.max = std::min(ray.max, hitRecord.t);
+			return clampedRay;
+		}
+	}
+
+#pragma region Linear
+	void LinearAccelerator::Build(const AcceleratorGeometry& geometry)
+	{
+		m_Geometry = geometry;
+		m_PrimitiveCount = m_Geometry.GetPrimitiveCount();
+		m_SphereStore.Build(*m_Geometry.pSpheres);
+	}
+
+	void LinearAccelerator::Refit()
+	{
+		m_SphereStore.Build(*m_Geometry.pSpheres);
+	}
+
+	bool LinearAccelerator::IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats) const
+	{
+		Ray currentRay{ ClampRay(ray, hitRecord) };
+		if (pStats) pStats->primitiveTests += m_PrimitiveCount;
+
+		//all spheres in one sweep, they fill the first slots of the primitive order
+		bool didHit{ m_SphereStore.HitTest(0, m_SphereStore.GetSlotCount(), currentRay, hitRecord) };
+		for (uint32_t primitiveIdx{ m_SphereStore.GetSlotCount() }; primitiveIdx < m_PrimitiveCount; ++primitiveIdx)
+		{
+			HitRecord primitiveHit{};
+			if (!m_Geometry.HitTest_Primitive(primitiveIdx, currentRay, primitiveHit)) continue;
+
+			hitRecord = primitiveHit;
+			currentRay.max = primitiveHit.t;
+			didHit = true;
+		}
+		return didHit;
+	}
+
+	bool LinearAccelerator::IntersectAny(const Ray& ray, TraversalStats* pStats) const
+	{
+		if (pStats) pStats->primitiveTests += m_PrimitiveCount;
+		if (m_SphereStore.Occluded(0, m_SphereStore.GetSlotCount(), ray)) return true;
+
+		for (uint32_t primitiveIdx{ m_SphereStore.GetSlotCount() }; primitiveIdx < m_PrimitiveCount; ++primitiveIdx)
+		{
+			if (m_Geometry.Occluded_Primitive(primitiveIdx, ray)) return true;
+		}
+		return false;
+	}
+
+	AcceleratorStats LinearAccelerator::GetStats() const
+	{
+		return { Accelerator::GetName(AcceleratorType::Linear), m_PrimitiveCount, 0, 0, 0.f };
+	}
+#pragma endregion
+
+#pragma region BVH
+	void BVHAccelerator::Build(const AcceleratorGeometry& geometry)
+	{
+		m_Geometry = geometry;
+		m_PrimitiveCount = m_Geometry.GetPrimitiveCount();
+		m_BVH.Build(m_Geometry.GetPrimitiveBounds());
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_BVH.GetPrimitiveIndices());
+	}
+
+	void BVHAccelerator::Refit()
+	{
+		m_BVH.Update(m_Geometry.GetPrimitiveBounds());
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_BVH.GetPrimitiveIndices());
+	}
+
+	void BVHAccelerator::CopyStructure(const Accelerator& source)
+	{
+		m_BVH = static_cast<const BVHAccelerator&>(source).m_BVH;
+	}
+
+	bool BVHAccelerator::IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats) const
+	{
+		Ray currentRay{ ClampRay(ray, hitRecord) };
+		return GeometryUtils::TraverseBVHLeaves(m_BVH, currentRay, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& leafRay)
+			{
+				return IntersectRange(m_Geometry, m_SphereStore, m_BVH.GetPrimitiveIndices(), firstPrimitive, primitiveCount, leafRay, hitRecord);
+			}, false, pStats);
+	}
+
+	bool BVHAccelerator::IntersectAny(const Ray& ray, TraversalStats* pStats) const
+	{
+		return GeometryUtils::OccludedBVHLeaves(m_BVH, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount)
+			{
+				return OccludedRange(m_Geometry, m_SphereStore, m_BVH.GetPrimitiveIndices(), firstPrimitive, primitiveCount, ray);
+			}, pStats);
+	}
+
+	void BVHAccelerator::IntersectClosestPacket(RayPacket& packet, HitRecord* hitRecords, TraversalStats* pStats) const
+	{
+		//rays spanning several octants have no common near-to-far order
+		if (!packet.isCoherent)
+		{
+			Accelerator::IntersectClosestPacket(packet, hitRecords, pStats);
+			return;
+		}
+
+		for (uint32_t lane{}; lane < packet.rayCount; ++lane)
+		{
+			packet.max[lane] = std::min(packet.max[lane], hitRecords[lane].t);
+		}
+
+		GeometryUtils::TraversePacketBVHLeaves(m_BVH, packet, packet.GetRayMask(), [&](uint32_t firstPrimitive, uint32_t primitiveCount, uint64_t rayMask)
+			{
+				IntersectRangePacket(m_Geometry, m_SphereStore, m_BVH.GetPrimitiveIndices(), firstPrimitive, primitiveCount, packet, rayMask, hitRecords);
+			}, pStats);
+	}
+
+	size_t BVHAccelerator::GetMemoryUsage() const
+	{
+		return m_BVH.GetNodes().capacity() * sizeof(BVHNode) + m_BVH.GetPrimitiveIndices().capacity() * sizeof(uint32_t);
+	}
+
+	AcceleratorStats BVHAccelerator::GetStats() const
+	{
+		return { Accelerator::GetName(AcceleratorType::BVH), m_PrimitiveCount, m_BVH.GetNodes().size(), GetMemoryUsage(), m_BVH.GetBuildTime() };
+	}
+#pragma endregion
+
+#pragma region WideBVH
+	template<int Width>
+	void WideBVHAccelerator<Width>::Build(const AcceleratorGeometry& geometry)
+	{
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+
+		m_Geometry = geometry;
+		m_PrimitiveCount = m_Geometry.GetPrimitiveCount();
+		m_BVH.Build(m_Geometry.GetPrimitiveBounds());
+		m_WideBVH.Build(m_BVH);
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_WideBVH.GetPrimitiveIndices());
+
+		m_BuildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	template<int Width>
+	void WideBVHAccelerator<Width>::Refit()
+	{
+		m_BVH.Update(m_Geometry.GetPrimitiveBounds());
+		m_WideBVH.Build(m_BVH);
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_WideBVH.GetPrimitiveIndices());
+	}
+
+	template<int Width>
+	void WideBVHAccelerator<Width>::CopyStructure(const Accelerator& source)
+	{
+		const WideBVHAccelerator& wideSource{ static_cast<const WideBVHAccelerator&>(source) };
+		m_BVH = wideSource.m_BVH;
+		m_WideBVH = wideSource.m_WideBVH;
+		m_BuildTime = wideSource.m_BuildTime;
+	}
+
+	template<int Width>
+	bool WideBVHAccelerator<Width>::IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats) const
+	{
+		Ray currentRay{ ClampRay(ray, hitRecord) };
+		return GeometryUtils::TraverseWideBVHLeaves(m_WideBVH, currentRay, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& leafRay)
+			{
+				return IntersectRange(m_Geometry, m_SphereStore, m_WideBVH.GetPrimitiveIndices(), firstPrimitive, primitiveCount, leafRay, hitRecord);
+			}, false, pStats);
+	}
+
+	template<int Width>
+	bool WideBVHAccelerator<Width>::IntersectAny(const Ray& ray, TraversalStats* pStats) const
+	{
+		return GeometryUtils::OccludedWideBVHLeaves(m_WideBVH, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount)
+			{
+				return OccludedRange(m_Geometry, m_SphereStore, m_WideBVH.GetPrimitiveIndices(), firstPrimitive, primitiveCount, ray);
+			}, pStats);
+	}
+
+	template<int Width>
+	size_t WideBVHAccelerator<Width>::GetMemoryUsage() const
+	{
+		return m_WideBVH.GetNodes().capacity() * sizeof(WideBVHNode<Width>) + m_WideBVH.GetPrimitiveIndices().capacity() * sizeof(uint32_t);
+	}
+
+	template<int Width>
+	AcceleratorStats WideBVHAccelerator<Width>::GetStats() const
+	{
+		return { Accelerator::GetName(Width == 4 ? AcceleratorType::WideBVH4 : AcceleratorType::WideBVH8),
+			m_PrimitiveCount, m_WideBVH.GetNodes().size(), GetMemoryUsage(), m_BuildTime };
+	}
+
+	template class WideBVHAccelerator<4>;
+	template class WideBVHAccelerator<8>;
+#pragma endregion
+
+#pragma region Grid
+	void GridAccelerator::Build(const AcceleratorGeometry& geometry)
+	{
+		m_Geometry = geometry;
+		m_PrimitiveCount = m_Geometry.GetPrimitiveCount();
+		m_Grid.Build(m_Geometry.GetPrimitiveBounds());
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_Grid.GetPrimitiveIndices());
+	}
+
+	void GridAccelerator::Refit()
+	{
+		m_Grid.Build(m_Geometry.GetPrimitiveBounds());
+		m_SphereStore.Build(*m_Geometry.pSpheres, m_Grid.GetPrimitiveIndices());
+	}
+
+	void GridAccelerator::CopyStructure(const Accelerator& source)
+	{
+		m_Grid = static_cast<const GridAccelerator&>(source).m_Grid;
+	}
+
+	bool GridAccelerator::IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats) const
+	{
+		Ray currentRay{ ClampRay(ray, hitRecord) };
+		return GeometryUtils::TraverseGridCells(m_Grid, currentRay, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& cellRay)
+			{
+				return IntersectRange(m_Geometry, m_SphereStore, m_Grid.GetPrimitiveIndices(), firstPrimitive, primitiveCount, cellRay, hitRecord);
+			}, false, pStats);
+	}
+
+	bool GridAccelerator::IntersectAny(const Ray& ray, TraversalStats* pStats) const
+	{
+		Ray currentRay{ ray };
+		return GeometryUtils::TraverseGridCells(m_Grid, currentRay, [&](uint32_t firstPrimitive, uint32_t primitiveCount, const Ray&)
+			{
+				return OccludedRange(m_Geometry, m_SphereStore, m_Grid.GetPrimitiveIndices(), firstPrimitive, primitiveCount, ray);
+			}, true, pStats);
+	}
+
+	AcceleratorStats GridAccelerator::GetStats() const
+	{
+		const int* resolution{ m_Grid.GetResolution() };
+		return { Accelerator::GetName(AcceleratorType::Grid), m_PrimitiveCount, static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2], GetMemoryUsage(), m_Grid.GetBuildTime() };
+	}
+#pragma endregion
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "DataTypes.h"
+#include "RayPacket.h"
+#include "SphereStore.h"
+#include "UniformGrid.h"
+#include "WideBVH.h"
+
+namespace dae
+{
+	enum class AcceleratorType
+	{
+		Linear, //tests every primitive, no build cost
+		BVH,
+		WideBVH4,
+		WideBVH8,
+		Grid,
+		count
+	};
+
+	//View on the bounded scene geometry as one list of primitives: spheres first, then meshes, then mesh instances.
+	//Only the vectors are referenced, so adding geometry is fine as long as the accelerator is rebuilt afterwards.
+	struct AcceleratorGeometry
+	{
+		const std::vector<Sphere>* pSpheres{};
+		const std::vector<TriangleMesh>* pMeshes{};
+		const std::vector<MeshInstance>* pInstances{};
+
+		uint32_t GetPrimitiveCount() const;
+		std::vector<AABB> GetPrimitiveBounds() const;
+
+		bool HitTest_Primitive(uint32_t primitiveIdx, const Ray& ray, HitRecord& hitRecord) const;
+		//closest hits of the packet rays in rayMask, meshes keep the packet together through their own hierarchy
+		void HitTest_Primitive(uint32_t primitiveIdx, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords) const;
+		bool Occluded_Primitive(uint32_t primitiveIdx, const Ray& ray) const;
+	};
+
+	struct AcceleratorStats
+	{
+		const char* name{};
+		uint32_t primitiveCount{};
+		size_t nodeCount{}; //nodes or grid cells
+		size_t memoryUsage{}; //bytes
+		float buildTime{}; //milliseconds
+	};
+
+	//Acceleration structure over the bounded scene geometry, Scene delegates its ray queries to one of these.
+	//Unbounded geometry (planes) stays with the scene.
+	class Accelerator
+	{
+	public:
+		Accelerator() = default;
+		virtual ~Accelerator() = default;
+
+		Accelerator(const Accelerator&) = delete;
+		Accelerator(Accelerator&&) noexcept = delete;
+		Accelerator& operator=(const Accelerator&) = delete;
+		Accelerator& operator=(Accelerator&&) noexcept = delete;
+
+		static std::unique_ptr<Accelerator> Create(AcceleratorType type);
+		static const char* GetName(AcceleratorType type);
+
+		virtual void Build(const AcceleratorGeometry& geometry) = 0;
+		//follows moved geometry, cheaper than Build where the structure allows it
+		virtual void Refit() = 0;
+		/**
+		 * \brief Takes over the structure source built or refitted over another copy of the same geometry, instead of redoing that work
+		 * \param source Accelerator of the same type
+		 * \param geometry This accelerator's own copy of the geometry source was built over
+		 */
+		void CopyFrom(const Accelerator& source, const AcceleratorGeometry& geometry);
+
+		/**
+		 * \brief Closest hit along the ray, nothing behind hitRecord.t is considered
+		 * \param hitRecord Only overwritten when a closer hit is found
+		 * \param pStats Optional traversal counters
+		 * \return true if a closer hit was found
+		 */
+		virtual bool IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats = nullptr) const = 0;
+		//any hit within [ray.min, ray.max], for shadow rays
+		virtual bool IntersectAny(const Ray& ray, TraversalStats* pStats = nullptr) const = 0;
+		/**
+		 * \brief Closest hits of every ray in a packet, the default traces the rays one by one
+		 * \param hitRecords One record per packet lane, only overwritten when a closer hit is found
+		 */
+		virtual void IntersectClosestPacket(RayPacket& packet, HitRecord* hitRecords, TraversalStats* pStats = nullptr) const;
+
+		virtual size_t GetMemoryUsage() const = 0;
+		virtual AcceleratorStats GetStats() const = 0;
+
+	protected:
+		//copies the structure of the derived type, source is always of the same type
+		virtual void CopyStructure(const Accelerator& source) = 0;
+
+		AcceleratorGeometry m_Geometry{};
+		uint32_t m_PrimitiveCount{};
+		//spheres in the primitive order of the structure, so whole leaves or cells of spheres are tested with SIMD
+		SphereStore m_SphereStore{};
+	};
+
+	class LinearAccelerator final : public Accelerator
+	{
+	public:
+		void Build(const AcceleratorGeometry& geometry) override;
+		void Refit() override;
+
+		bool IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats = nullptr) const override;
+		bool IntersectAny(const Ray& ray, TraversalStats* pStats = nullptr) const override;
+
+		size_t GetMemoryUsage() const override { return 0; }
+		AcceleratorStats GetStats() const override;
+
+	private:
+		void CopyStructure(const Accelerator&) override {}
+	};
+
+	class BVHAccelerator final : public Accelerator
+	{
+	public:
+		void Build(const AcceleratorGeometry& geometry) override;
+		void Refit() override;
+
+		bool IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats = nullptr) const override;
+		bool IntersectAny(const Ray& ray, TraversalStats* pStats = nullptr) const override;
+		//coherent packets share one walk through the tree, diverged ones fall back to single rays
+		void IntersectClosestPacket(RayPacket& packet, HitRecord* hitRecords, TraversalStats* pStats = nullptr) const override;
+
+		size_t GetMemoryUsage() const override;
+		AcceleratorStats GetStats() const override;
+
+	private:
+		void CopyStructure(const Accelerator& source) override;
+
+		BVH m_BVH{};
+	};
+
+	//binary BVH collapsed into Width-wide nodes after every build or refit
+	template<int Width>
+	class WideBVHAccelerator final : public Accelerator
+	{
+	public:
+		void Build(const AcceleratorGeometry& geometry) override;
+		void Refit() override;
+
+		bool IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats = nullptr) const override;
+		bool IntersectAny(const Ray& ray, TraversalStats* pStats = nullptr) const override;
+
+		size_t GetMemoryUsage() const override;
+		AcceleratorStats GetStats() const override;
+
+	private:
+		void CopyStructure(const Accelerator& source) override;
+
+		BVH m_BVH{};
+		WideBVH<Width> m_WideBVH{};
+		float m_BuildTime{};
+	};
+
+	class GridAccelerator final : public Accelerator
+	{
+	public:
+		void Build(const AcceleratorGeometry& geometry) override;
+		//grids are cheap enough to rebuild on every refit
+		void Refit() override;
+
+		bool IntersectClosest(const Ray& ray, HitRecord& hitRecord, TraversalStats* pStats = nullptr) const override;
+		bool IntersectAny(const Ray& ray, TraversalStats* pStats = nullptr) const override;
+
+		size_t GetMemoryUsage() const override { return m_Grid.GetMemoryUsage(); }
+		AcceleratorStats GetStats() const override;
+
+	private:
+		void CopyStructure(const Accelerator& source) override;
+
+		UniformGrid m_Grid{};
+	};
+}
@@ -0,0 +1,875 @@
+#include "BVH.h"
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <numeric>
+
+#include "ThreadPool.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int BinCount{ 12 };
+
+		//relative cost of visiting a node versus intersecting a primitive
+		constexpr float TraversalCost{ 1.f };
+		constexpr float IntersectionCost{ 1.f };
+
+		struct Bin
+		{
+			AABB bounds{};
+			uint32_t primitiveCount{};
+		};
+
+		struct Split
+		{
+			int axis{ -1 };
+			int bin{};
+			float cost{ FLT_MAX };
+			float centroidMin{};
+			float binScale{};
+		};
+
+		int GetBinIndex(float centroid, float centroidMin, float binScale)
+		{
+			return std::min(BinCount - 1, static_cast<int>((centroid - centroidMin) * binScale));
+		}
+
+#pragma region LBVH Helpers
+		//LBVH leaves stop splitting at this many primitives
+		constexpr uint32_t LBVHLeafSize{ 4 };
+		//30-bit codes are cheaper to sort, bigger inputs switch to 63-bit codes to avoid piles of duplicate keys
+		constexpr size_t LongMortonCodeThreshold{ 1 << 16 };
+
+		constexpr int RadixBits{ 8 };
+		constexpr size_t RadixSize{ 1 << RadixBits };
+		constexpr size_t MinRadixChunkSize{ 4096 };
+
+		//spreads the lower 21 bits of value so there are two zero bits between every bit
+		uint64_t ExpandBits(uint32_t value)
+		{
+			uint64_t x{ value & 0x1fffffu };
+			x = (x | x << 32) & 0x1f00000000ffffull;
+			x = (x | x << 16) & 0x1f0000ff0000ffull;
+			x = (x | x << 8) & 0x100f00f00f00f00full;
+			x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+			x = (x | x << 2) & 0x1249249249249249ull;
+			return x;
+		}
+
+		//one chunk per thread of the pool, as long as every chunk gets at least MinRadixChunkSize items
+		size_t GetChunkCount(const ThreadPool* pThreadPool, size_t count)
+		{
+			if (!pThreadPool) return 1;
+			return std::clamp<size_t>(count / MinRadixChunkSize, 1, pThreadPool->GetThreadCount());
+		}
+
+		//a single chunk runs on the calling thread without waking the pool
+		void ForEachChunk(ThreadPool* pThreadPool, size_t chunkCount, const std::function<void(uint32_t)>& task)
+		{
+			if (chunkCount == 1) task(0);
+			else pThreadPool->ParallelFor(static_cast<uint32_t>(chunkCount), task);
+		}
+
+		//runs task(begin, end) on contiguous chunks of [0, count)
+		void ParallelForChunks(ThreadPool* pThreadPool, size_t count, const std::function<void(size_t, size_t)>& task)
+		{
+			const size_t chunkCount{ GetChunkCount(pThreadPool, count) };
+			const size_t chunkSize{ (count + chunkCount - 1) / chunkCount };
+			ForEachChunk(pThreadPool, chunkCount, [&](uint32_t chunkIdx)
+				{
+					task(std::min(count, chunkIdx * chunkSize), std::min(count, (chunkIdx + 1) * chunkSize));
+				});
+		}
+
+		//LSD radix sort of (key, value) pairs, every pass counts and scatters chunks of the input in parallel
+		void ParallelRadixSort(ThreadPool* pThreadPool, std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int keyBits)
+		{
+			const size_t count{ keys.size() };
+			const size_t chunkCount{ GetChunkCount(pThreadPool, count) };
+			const size_t chunkSize{ (count + chunkCount - 1) / chunkCount };
+
+			std::vector<std::array<size_t, RadixSize>> histograms(chunkCount);
+			std::vector<uint64_t> sortedKeys(count);
+			std::vector<uint32_t> sortedValues(count);
+
+			for (int shift{}; shift < keyBits; shift += RadixBits)
+			{
+				ForEachChunk(pThreadPool, chunkCount, [&](uint32_t chunkIdx)
+					{
+						std::array<size_t, RadixSize>& histogram{ histograms[chunkIdx] };
+						histogram.fill(0);
+
+						const size_t end{ std::min(count, (chunkIdx + 1) * chunkSize) };
+						for (size_t idx{ chunkIdx * chunkSize }; idx < end; ++idx)
+						{
+							++histogram[(keys[idx] >> shift) & (RadixSize - 1)];
+						}
+					});
+
+				//exclusive prefix sum over digits first and chunks second, keeps the sort stable
+				size_t offset{};
+				for (size_t digit{}; digit < RadixSize; ++digit)
+				{
+					for (std::array<size_t, RadixSize>& histogram : histograms)
+					{
+						const size_t digitCount{ histogram[digit] };
+						histogram[digit] = offset;
+						offset += digitCount;
+					}
+				}
+
+				ForEachChunk(pThreadPool, chunkCount, [&](uint32_t chunkIdx)
+					{
+						std::array<size_t, RadixSize>& histogram{ histograms[chunkIdx] };
+
+						const size_t end{ std::min(count, (chunkIdx + 1) * chunkSize) };
+						for (size_t idx{ chunkIdx * chunkSize }; idx < end; ++idx)
+						{
+							const size_t destination{ histogram[(keys[idx] >> shift) & (RadixSize - 1)]++ };
+							sortedKeys[destination] = keys[idx];
+							sortedValues[destination] = values[idx];
+						}
+					});
+
+				keys.swap(sortedKeys);
+				values.swap(sortedValues);
+			}
+		}
+
+		//length of the common prefix of two sorted keys, equal keys are told apart by their index (Karras 2012)
+		int CommonPrefix(const std::vector<uint64_t>& keys, int64_t first, int64_t second)
+		{
+			if (second < 0 || second >= static_cast<int64_t>(keys.size())) return -1;
+
+			const uint64_t firstKey{ keys[first] };
+			const uint64_t secondKey{ keys[second] };
+			if (firstKey == secondKey)
+				return 64 + std::countl_zero(static_cast<uint64_t>(first ^ second));
+
+			return std::countl_zero(firstKey ^ secondKey);
+		}
+
+		struct RadixTreeNode
+		{
+			uint32_t children[2]{};
+			bool isLeafChild[2]{};
+			uint32_t first{};
+			uint32_t last{};
+		};
+#pragma endregion
+
+#pragma region SBVH Helpers
+		//spatial splits are only tried when the children of the best object split overlap by more than this fraction of the root area (Stich et al. 2009)
+		constexpr float SpatialSplitOverlapThreshold{ 1e-5f };
+		constexpr int SpatialBinCount{ 16 };
+
+		struct SpatialBin
+		{
+			AABB bounds{};
+			uint32_t entries{}; //references starting in this bin
+			uint32_t exits{}; //references ending in this bin
+		};
+
+		bool IsValid(const AABB& bounds)
+		{
+			return bounds.min.x <= bounds.max.x && bounds.min.y <= bounds.max.y && bounds.min.z <= bounds.max.z;
+		}
+
+		AABB Intersect(const AABB& first, const AABB& second)
+		{
+			return AABB{ Vector3::Max(first.min, second.min), Vector3::Min(first.max, second.max) };
+		}
+
+		//bounds of the part of a triangle that lies between two planes perpendicular to axis
+		AABB ClipTriangle(const Vector3* vertices, int axis, float planeMin, float planeMax)
+		{
+			AABB clipped{};
+			for (int vertexIdx{}; vertexIdx < 3; ++vertexIdx)
+			{
+				const Vector3& start{ vertices[vertexIdx] };
+				const Vector3& end{ vertices[(vertexIdx + 1) % 3] };
+				const float startValue{ start[axis] };
+				const float endValue{ end[axis] };
+
+				if (startValue >= planeMin && startValue <= planeMax) clipped.Grow(start);
+
+				//add the points where the edge crosses either plane
+				for (const float plane : { planeMin, planeMax })
+				{
+					if ((startValue < plane && endValue > plane) || (startValue > plane && endValue < plane))
+					{
+						Vector3 crossing{ start + (end - start) * ((plane - startValue) / (endValue - startValue)) };
+						crossing[axis] = plane;
+						clipped.Grow(crossing);
+					}
+				}
+			}
+			return clipped;
+		}
+
+		//part of a (possibly already clipped) reference between two planes, empty if nothing is left
+		AABB ClipReference(const AABB& referenceBounds, const Vector3* vertices, int axis, float planeMin, float planeMax)
+		{
+			const AABB clipped{ Intersect(ClipTriangle(vertices, axis, planeMin, planeMax), referenceBounds) };
+			return IsValid(clipped) ? clipped : AABB{};
+		}
+#pragma endregion
+	}
+
+	struct BVH::SpatialReference
+	{
+		AABB bounds{};
+		uint32_t primitiveIdx{};
+	};
+
+	void BVH::Build(const std::vector<AABB>& primitiveBounds, BVHBuildMode buildMode, const std::vector<Vector3>* pTriangleVertices)
+	{
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+
+		Clear();
+		if (!primitiveBounds.empty())
+		{
+			m_PrimitiveCount = static_cast<uint32_t>(primitiveBounds.size());
+
+			if (buildMode == BVHBuildMode::LBVH)
+				BuildLBVH(primitiveBounds);
+			else if (buildMode == BVHBuildMode::SBVH && pTriangleVertices && pTriangleVertices->size() == primitiveBounds.size() * 3)
+				BuildSBVH(primitiveBounds, *pTriangleVertices);
+			else
+				BuildSAH(primitiveBounds);
+
+			m_Cost = CalculateCost();
+			m_BuildCost = m_Cost;
+		}
+
+		m_BuildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void BVH::BuildSAH(const std::vector<AABB>& primitiveBounds)
+	{
+		const uint32_t primitiveCount{ static_cast<uint32_t>(primitiveBounds.size()) };
+
+		m_PrimitiveIndices.resize(primitiveCount);
+		std::iota(m_PrimitiveIndices.begin(), m_PrimitiveIndices.end(), 0u);
+
+		std::vector<Vector3> centroids{};
+		centroids.reserve(primitiveCount);
+		for (const AABB& bounds : primitiveBounds)
+		{
+			centroids.emplace_back(bounds.GetCenter());
+		}
+
+		//a binary tree with one primitive per leaf never needs more than 2n - 1 nodes
+		m_Nodes.reserve(2 * primitiveCount - 1);
+
+		BVHNode& root{ m_Nodes.emplace_back() };
+		root.leftFirst = 0;
+		root.primitiveCount = primitiveCount;
+
+		UpdateNodeBounds(0, primitiveBounds);
+		Subdivide(0, 0, primitiveBounds, centroids);
+	}
+
+	void BVH::BuildLBVH(const std::vector<AABB>& primitiveBounds)
+	{
+		const uint32_t primitiveCount{ static_cast<uint32_t>(primitiveBounds.size()) };
+
+		//quantize centroids inside their bounds and interleave the bits into Morton codes
+		AABB centroidBounds{};
+		for (const AABB& bounds : primitiveBounds)
+		{
+			centroidBounds.Grow(bounds.GetCenter());
+		}
+
+		const int bitsPerAxis{ primitiveCount > LongMortonCodeThreshold ? 21 : 10 };
+		const float cellCount{ static_cast<float>((1u << bitsPerAxis) - 1) };
+		const Vector3 extent{ centroidBounds.max - centroidBounds.min };
+		const Vector3 scale{
+			extent.x > 0.f ? cellCount / extent.x : 0.f,
+			extent.y > 0.f ? cellCount / extent.y : 0.f,
+			extent.z > 0.f ? cellCount / extent.z : 0.f };
+
+		std::vector<uint64_t> mortonCodes(primitiveCount);
+		m_PrimitiveIndices.resize(primitiveCount);
+		std::iota(m_PrimitiveIndices.begin(), m_PrimitiveIndices.end(), 0u);
+
+		ParallelForChunks(m_pThreadPool, primitiveCount, [&](size_t begin, size_t end)
+			{
+				for (size_t primitiveIdx{ begin }; primitiveIdx < end; ++primitiveIdx)
+				{
+					const Vector3 cell{ primitiveBounds[primitiveIdx].GetCenter() - centroidBounds.min };
+					mortonCodes[primitiveIdx] =
+						(ExpandBits(static_cast<uint32_t>(cell.x * scale.x)) << 2) |
+						(ExpandBits(static_cast<uint32_t>(cell.y * scale.y)) << 1) |
+						ExpandBits(static_cast<uint32_t>(cell.z * scale.z));
+				}
+			});
+
+		ParallelRadixSort(m_pThreadPool, mortonCodes, m_PrimitiveIndices, bitsPerAxis * 3);
+
+		m_Nodes.reserve(2 * primitiveCount - 1);
+		BVHNode& root{ m_Nodes.emplace_back() };
+		root.leftFirst = 0;
+		root.primitiveCount = primitiveCount;
+
+		if (primitiveCount > 1)
+		{
+			//every internal node of the radix tree finds its own key range and split independently
+			std::vector<RadixTreeNode> radixTree(primitiveCount - 1);
+			ParallelForChunks(m_pThreadPool, primitiveCount - 1, [&](size_t begin, size_t end)
+				{
+					for (size_t nodeIdx{ begin }; nodeIdx < end; ++nodeIdx)
+					{
+						const int64_t idx{ static_cast<int64_t>(nodeIdx) };
+						const int64_t direction{ CommonPrefix(mortonCodes, idx, idx + 1) > CommonPrefix(mortonCodes, idx, idx - 1) ? 1 : -1 };
+
+						//upper bound for the range length, then binary search the other end
+						const int minPrefix{ CommonPrefix(mortonCodes, idx, idx - direction) };
+						int64_t maxLength{ 2 };
+						while (CommonPrefix(mortonCodes, idx, idx + maxLength * direction) > minPrefix)
+							maxLength *= 2;
+
+						int64_t length{};
+						for (int64_t step{ maxLength / 2 }; step >= 1; step /= 2)
+						{
+							if (CommonPrefix(mortonCodes, idx, idx + (length + step) * direction) > minPrefix)
+								length += step;
+						}
+						const int64_t otherEnd{ idx + length * direction };
+
+						//binary search the highest differing bit inside the range
+						const int nodePrefix{ CommonPrefix(mortonCodes, idx, otherEnd) };
+						int64_t split{};
+						int64_t step{ length };
+						do
+						{
+							step = (step + 1) / 2;
+							if (CommonPrefix(mortonCodes, idx, idx + (split + step) * direction) > nodePrefix)
+								split += step;
+						} while (step > 1);
+						const int64_t splitIdx{ idx + split * direction + std::min<int64_t>(direction, 0) };
+
+						RadixTreeNode& node{ radixTree[nodeIdx] };
+						node.first = static_cast<uint32_t>(std::min(idx, otherEnd));
+						node.last = static_cast<uint32_t>(std::max(idx, otherEnd));
+						node.children[0] = static_cast<uint32_t>(splitIdx);
+						node.children[1] = static_cast<uint32_t>(splitIdx + 1);
+						node.isLeafChild[0] = node.first == splitIdx;
+						node.isLeafChild[1] = node.last == splitIdx + 1;
+					}
+				});
+
+			//flatten into the regular layout with adjacent children, small ranges become a single leaf
+			struct FlattenTask
+			{
+				uint32_t nodeIdx;
+				uint32_t radixIdx;
+				uint32_t depth;
+			};
+
+			std::vector<FlattenTask> tasks{ { 0, 0, 0 } };
+			while (!tasks.empty())
+			{
+				const FlattenTask task{ tasks.back() };
+				tasks.pop_back();
+
+				const RadixTreeNode& radixNode{ radixTree[task.radixIdx] };
+				const uint32_t count{ radixNode.last - radixNode.first + 1 };
+				if (count <= LBVHLeafSize || task.depth + 1 >= MaxDepth)
+				{
+					m_Nodes[task.nodeIdx].leftFirst = radixNode.first;
+					m_Nodes[task.nodeIdx].primitiveCount = count;
+					continue;
+				}
+
+				const uint32_t leftChildIdx{ static_cast<uint32_t>(m_Nodes.size()) };
+				m_Nodes[task.nodeIdx].leftFirst = leftChildIdx;
+				m_Nodes[task.nodeIdx].primitiveCount = 0;
+
+				for (int childIdx{}; childIdx < 2; ++childIdx)
+				{
+					BVHNode& child{ m_Nodes.emplace_back() };
+					if (radixNode.isLeafChild[childIdx])
+					{
+						child.leftFirst = radixNode.children[childIdx];
+						child.primitiveCount = 1;
+					}
+					else
+					{
+						tasks.push_back({ leftChildIdx + childIdx, radixNode.children[childIdx], task.depth + 1 });
+					}
+				}
+			}
+		}
+
+		//children always come after their parent, so a refit fills in every bound
+		Refit(primitiveBounds);
+	}
+
+	void BVH::BuildSBVH(const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& triangleVertices)
+	{
+		const uint32_t primitiveCount{ static_cast<uint32_t>(primitiveBounds.size()) };
+
+		std::vector<SpatialReference> references{};
+		references.reserve(primitiveCount);
+
+		AABB rootBounds{};
+		for (uint32_t primitiveIdx{}; primitiveIdx < primitiveCount; ++primitiveIdx)
+		{
+			references.push_back({ primitiveBounds[primitiveIdx], primitiveIdx });
+			rootBounds.Grow(primitiveBounds[primitiveIdx]);
+		}
+
+		//spatial splits stop once the duplicated references use up the budget
+		m_ReferenceCount = primitiveCount;
+		m_MaxReferenceCount = static_cast<uint32_t>(primitiveCount * (1.f + std::max(m_SpatialSplitBudget, 0.f)));
+
+		m_PrimitiveIndices.reserve(m_MaxReferenceCount);
+		m_Nodes.reserve(2 * m_MaxReferenceCount - 1);
+		m_Nodes.emplace_back(BVHNode{ rootBounds.min, 0, rootBounds.max, 0 });
+
+		SubdivideSpatial(0, 0, references, triangleVertices);
+	}
+
+	void BVH::SubdivideSpatial(uint32_t nodeIdx, uint32_t depth, std::vector<SpatialReference>& references, const std::vector<Vector3>& triangleVertices)
+	{
+		const uint32_t count{ static_cast<uint32_t>(references.size()) };
+		const AABB nodeBounds{ m_Nodes[nodeIdx].minAABB, m_Nodes[nodeIdx].maxAABB };
+
+		const auto makeLeaf{ [&]()
+			{
+				m_Nodes[nodeIdx].leftFirst = static_cast<uint32_t>(m_PrimitiveIndices.size());
+				m_Nodes[nodeIdx].primitiveCount = count;
+				for (const SpatialReference& reference : references)
+				{
+					m_PrimitiveIndices.push_back(reference.primitiveIdx);
+				}
+			} };
+
+		if (count <= 2 || depth + 1 >= MaxDepth)
+		{
+			makeLeaf();
+			return;
+		}
+
+		//object split, same binned SAH as Subdivide but over the (clipped) reference bounds
+		Split objectSplit{};
+		AABB objectLeftBounds{}, objectRightBounds{};
+		for (int axis{}; axis < 3; ++axis)
+		{
+			float centroidMin{ FLT_MAX };
+			float centroidMax{ -FLT_MAX };
+			for (const SpatialReference& reference : references)
+			{
+				const float centroid{ reference.bounds.GetCenter()[axis] };
+				centroidMin = std::min(centroidMin, centroid);
+				centroidMax = std::max(centroidMax, centroid);
+			}
+
+			if (centroidMin == centroidMax) continue;
+
+			const float binScale{ BinCount / (centroidMax - centroidMin) };
+
+			Bin bins[BinCount]{};
+			for (const SpatialReference& reference : references)
+			{
+				Bin& bin{ bins[GetBinIndex(reference.bounds.GetCenter()[axis], centroidMin, binScale)] };
+				bin.bounds.Grow(reference.bounds);
+				++bin.primitiveCount;
+			}
+
+			AABB leftBounds[BinCount - 1]{}, rightBounds[BinCount - 1]{};
+			uint32_t leftCount[BinCount - 1]{}, rightCount[BinCount - 1]{};
+
+			AABB leftSweep{}, rightSweep{};
+			uint32_t leftSum{}, rightSum{};
+			for (int binIdx{}; binIdx < BinCount - 1; ++binIdx)
+			{
+				leftSum += bins[binIdx].primitiveCount;
+				leftCount[binIdx] = leftSum;
+				leftSweep.Grow(bins[binIdx].bounds);
+				leftBounds[binIdx] = leftSweep;
+
+				rightSum += bins[BinCount - 1 - binIdx].primitiveCount;
+				rightCount[BinCount - 2 - binIdx] = rightSum;
+				rightSweep.Grow(bins[BinCount - 1 - binIdx].bounds);
+				rightBounds[BinCount - 2 - binIdx] = rightSweep;
+			}
+
+			for (int binIdx{}; binIdx < BinCount - 1; ++binIdx)
+			{
+				if (leftCount[binIdx] == 0 || rightCount[binIdx] == 0) continue;
+
+				const float cost{ leftCount[binIdx] * leftBounds[binIdx].GetSurfaceArea() + rightCount[binIdx] * rightBounds[binIdx].GetSurfaceArea() };
+				if (cost < objectSplit.cost)
+				{
+					objectSplit = { axis, binIdx, cost, centroidMin, binScale };
+					objectLeftBounds = leftBounds[binIdx];
+					objectRightBounds = rightBounds[binIdx];
+				}
+			}
+		}
+
+		//spatial split, only worth it when the object split children overlap noticeably and there is budget left
+		const float rootArea{ std::max(AABB{ m_Nodes[0].minAABB, m_Nodes[0].maxAABB }.GetSurfaceArea(), FLT_MIN) };
+		const bool trySpatialSplit{ m_ReferenceCount < m_MaxReferenceCount &&
+			(objectSplit.axis < 0 || Intersect(objectLeftBounds, objectRightBounds).GetSurfaceArea() / rootArea > SpatialSplitOverlapThreshold) };
+
+		Split spatialSplit{};
+		if (trySpatialSplit)
+		{
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float axisMin{ nodeBounds.min[axis] };
+				const float extent{ nodeBounds.max[axis] - axisMin };
+				if (extent <= 0.f) continue;
+
+				const float binScale{ SpatialBinCount / extent };
+				const float binWidth{ extent / SpatialBinCount };
+				const auto getSpatialBin{ [&](float value)
+					{
+						return std::clamp(static_cast<int>((value - axisMin) * binScale), 0, SpatialBinCount - 1);
+					} };
+
+				//chop every reference into the bins it overlaps
+				SpatialBin bins[SpatialBinCount]{};
+				for (const SpatialReference& reference : references)
+				{
+					const int firstBin{ getSpatialBin(reference.bounds.min[axis]) };
+					const int lastBin{ getSpatialBin(reference.bounds.max[axis]) };
+					const Vector3* vertices{ &triangleVertices[reference.primitiveIdx * size_t(3)] };
+
+					for (int binIdx{ firstBin }; binIdx <= lastBin; ++binIdx)
+					{
+						const float planeMin{ binIdx == firstBin ? -FLT_MAX : axisMin + binIdx * binWidth };
+						const float planeMax{ binIdx == lastBin ? FLT_MAX : axisMin + (binIdx + 1) * binWidth };
+						bins[binIdx].bounds.Grow(ClipReference(reference.bounds, vertices, axis, planeMin, planeMax));
+					}
+
+					++bins[firstBin].entries;
+					++bins[lastBin].exits;
+				}
+
+				//references entering left of a plane go left, references exiting right of it go right
+				float leftArea[SpatialBinCount - 1]{}, rightArea[SpatialBinCount - 1]{};
+				uint32_t leftCount[SpatialBinCount - 1]{}, rightCount[SpatialBinCount - 1]{};
+
+				AABB leftSweep{}, rightSweep{};
+				uint32_t leftSum{}, rightSum{};
+				for (int binIdx{}; binIdx < SpatialBinCount - 1; ++binIdx)
+				{
+					leftSum += bins[binIdx].entries;
+					leftCount[binIdx] = leftSum;
+					leftSweep.Grow(bins[binIdx].bounds);
+					leftArea[binIdx] = leftSweep.GetSurfaceArea();
+
+					rightSum += bins[SpatialBinCount - 1 - binIdx].exits;
+					rightCount[SpatialBinCount - 2 - binIdx] = rightSum;
+					rightSweep.Grow(bins[SpatialBinCount - 1 - binIdx].bounds);
+					rightArea[SpatialBinCount - 2 - binIdx] = rightSweep.GetSurfaceArea();
+				}
+
+				for (int binIdx{}; binIdx < SpatialBinCount - 1; ++binIdx)
+				{
+					if (leftCount[binIdx] == 0 || rightCount[binIdx] == 0) continue;
+
+					const uint32_t duplicates{ leftCount[binIdx] + rightCount[binIdx] - count };
+					if (m_ReferenceCount + duplicates > m_MaxReferenceCount) continue;
+
+					const float cost{ leftCount[binIdx] * leftArea[binIdx] + rightCount[binIdx] * rightArea[binIdx] };
+					if (cost < spatialSplit.cost) spatialSplit = { axis, binIdx, cost, axisMin, binScale };
+				}
+			}
+		}
+
+		const bool useSpatialSplit{ spatialSplit.cost < objectSplit.cost };
+		const Split& bestSplit{ useSpatialSplit ? spatialSplit : objectSplit };
+		if (bestSplit.axis < 0)
+		{
+			makeLeaf();
+			return;
+		}
+
+		const float nodeArea{ nodeBounds.GetSurfaceArea() };
+		const float splitCost{ TraversalCost + IntersectionCost * bestSplit.cost / std::max(nodeArea, FLT_MIN) };
+		const float leafCost{ IntersectionCost * count };
+		if (splitCost >= leafCost && count <= MaxLeafSize)
+		{
+			makeLeaf();
+			return;
+		}
+
+		std::vector<SpatialReference> leftReferences{};
+		std::vector<SpatialReference> rightReferences{};
+		AABB leftBounds{}, rightBounds{};
+
+		const auto addLeft{ [&](const SpatialReference& reference) { leftReferences.push_back(reference); leftBounds.Grow(reference.bounds); } };
+		const auto addRight{ [&](const SpatialReference& reference) { rightReferences.push_back(reference); rightBounds.Grow(reference.bounds); } };
+
+		if (useSpatialSplit)
+		{
+			leftReferences.reserve(count);
+			rightReferences.reserve(count);
+
+			const int axis{ bestSplit.axis };
+			const float plane{ bestSplit.centroidMin + (bestSplit.bin + 1) / bestSplit.binScale };
+			const auto getSpatialBin{ [&](float value)
+				{
+					return std::clamp(static_cast<int>((value - bestSplit.centroidMin) * bestSplit.binScale), 0, SpatialBinCount - 1);
+				} };
+
+			for (const SpatialReference& reference : references)
+			{
+				if (getSpatialBin(reference.bounds.max[axis]) <= bestSplit.bin)
+				{
+					addLeft(reference);
+					continue;
+				}
+				if (getSpatialBin(reference.bounds.min[axis]) > bestSplit.bin)
+				{
+					addRight(reference);
+					continue;
+				}
+
+				//straddles the plane, both sides get the clipped part on their side
+				const Vector3* vertices{ &triangleVertices[reference.primitiveIdx * size_t(3)] };
+				const AABB leftPart{ ClipReference(reference.bounds, vertices, axis, -FLT_MAX, plane) };
+				const AABB rightPart{ ClipReference(reference.bounds, vertices, axis, plane, FLT_MAX) };
+
+				if (!IsValid(leftPart))
+				{
+					addRight(reference);
+				}
+				else if (!IsValid(rightPart))
+				{
+					addLeft(reference);
+				}
+				else
+				{
+					addLeft({ leftPart, reference.primitiveIdx });
+					addRight({ rightPart, reference.primitiveIdx });
+					++m_ReferenceCount;
+				}
+			}
+		}
+		else
+		{
+			for (const SpatialReference& reference : references)
+			{
+				if (GetBinIndex(reference.bounds.GetCenter()[bestSplit.axis], bestSplit.centroidMin, bestSplit.binScale) <= bestSplit.bin)
+					addLeft(reference);
+				else
+					addRight(reference);
+			}
+		}
+
+		if (leftReferences.empty() || rightReferences.empty())
+		{
+			makeLeaf();
+			return;
+		}
+
+		//references of this node are no longer needed, free them before going deeper
+		references.clear();
+		references.shrink_to_fit();
+
+		const uint32_t leftChildIdx{ static_cast<uint32_t>(m_Nodes.size()) };
+		m_Nodes.emplace_back(BVHNode{ leftBounds.min, 0, leftBounds.max, 0 });
+		m_Nodes.emplace_back(BVHNode{ rightBounds.min, 0, rightBounds.max, 0 });
+
+		m_Nodes[nodeIdx].leftFirst = leftChildIdx;
+		m_Nodes[nodeIdx].primitiveCount = 0;
+
+		SubdivideSpatial(leftChildIdx, depth + 1, leftReferences, triangleVertices);
+		SubdivideSpatial(leftChildIdx + 1, depth + 1, rightReferences, triangleVertices);
+	}
+
+	void BVH::Refit(const std::vector<AABB>& primitiveBounds)
+	{
+		//children are always created after their parent, so walking backwards visits them first
+		for (size_t nodeIdx{ m_Nodes.size() }; nodeIdx-- > 0;)
+		{
+			BVHNode& node{ m_Nodes[nodeIdx] };
+			if (node.IsLeaf())
+			{
+				UpdateNodeBounds(static_cast<uint32_t>(nodeIdx), primitiveBounds);
+				continue;
+			}
+
+			const BVHNode& leftChild{ m_Nodes[node.leftFirst] };
+			const BVHNode& rightChild{ m_Nodes[node.leftFirst + 1] };
+			node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+			node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		}
+
+		m_Cost = CalculateCost();
+	}
+
+	void BVH::Update(const std::vector<AABB>& primitiveBounds, BVHUpdateMode updateMode, BVHBuildMode buildMode, const std::vector<Vector3>* pTriangleVertices)
+	{
+		if (updateMode == BVHUpdateMode::Rebuild || m_Nodes.empty() || primitiveBounds.size() != m_PrimitiveCount)
+		{
+			Build(primitiveBounds, buildMode, pTriangleVertices);
+			return;
+		}
+
+		Refit(primitiveBounds);
+
+		//bounds of a refitted tree only get looser as primitives move apart, start over once traversal gets too expensive
+		if (m_Cost > m_BuildCost * m_RebuildThreshold)
+			Build(primitiveBounds, buildMode, pTriangleVertices);
+	}
+
+	void BVH::Clear()
+	{
+		m_Nodes.clear();
+		m_PrimitiveIndices.clear();
+		m_PrimitiveCount = 0;
+		m_Cost = 0.f;
+		m_BuildCost = 0.f;
+	}
+
+	float BVH::CalculateCost() const
+	{
+		if (m_Nodes.empty()) return 0.f;
+
+		float cost{};
+		for (const BVHNode& node : m_Nodes)
+		{
+			const float area{ AABB{ node.minAABB, node.maxAABB }.GetSurfaceArea() };
+			cost += node.IsLeaf() ? IntersectionCost * node.primitiveCount * area : TraversalCost * area;
+		}
+
+		const float rootArea{ AABB{ m_Nodes[0].minAABB, m_Nodes[0].maxAABB }.GetSurfaceArea() };
+		return cost / std::max(rootArea, FLT_MIN);
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIdx, const std::vector<AABB>& primitiveBounds)
+	{
+		BVHNode& node{ m_Nodes[nodeIdx] };
+
+		AABB nodeBounds{};
+		for (uint32_t idx{}; idx < node.primitiveCount; ++idx)
+		{
+			nodeBounds.Grow(primitiveBounds[m_PrimitiveIndices[node.leftFirst + idx]]);
+		}
+
+		node.minAABB = nodeBounds.min;
+		node.maxAABB = nodeBounds.max;
+	}
+
+	void BVH::Subdivide(uint32_t nodeIdx, uint32_t depth, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids)
+	{
+		const uint32_t first{ m_Nodes[nodeIdx].leftFirst };
+		const uint32_t count{ m_Nodes[nodeIdx].primitiveCount };
+
+		if (count <= 2 || depth + 1 >= MaxDepth) return;
+
+		//find the cheapest split plane over all axes using binned SAH
+		Split bestSplit{};
+		for (int axis{}; axis < 3; ++axis)
+		{
+			float centroidMin{ FLT_MAX };
+			float centroidMax{ -FLT_MAX };
+			for (uint32_t idx{}; idx < count; ++idx)
+			{
+				const float centroid{ centroids[m_PrimitiveIndices[first + idx]][axis] };
+				centroidMin = std::min(centroidMin, centroid);
+				centroidMax = std::max(centroidMax, centroid);
+			}
+
+			//all centroids on one plane, nothing to split on this axis
+			if (centroidMin == centroidMax) continue;
+
+			const float binScale{ BinCount / (centroidMax - centroidMin) };
+
+			Bin bins[BinCount]{};
+			for (uint32_t idx{}; idx < count; ++idx)
+			{
+				const uint32_t primitiveIdx{ m_PrimitiveIndices[first + idx] };
+				Bin& bin{ bins[GetBinIndex(centroids[primitiveIdx][axis], centroidMin, binScale)] };
+				bin.bounds.Grow(primitiveBounds[primitiveIdx]);
+				++bin.primitiveCount;
+			}
+
+			//sweep from both sides to get the area and count left and right of every plane
+			float leftArea[BinCount - 1]{}, rightArea[BinCount - 1]{};
+			uint32_t leftCount[BinCount - 1]{}, rightCount[BinCount - 1]{};
+
+			AABB leftBounds{}, rightBounds{};
+			uint32_t leftSum{}, rightSum{};
+			for (int binIdx{}; binIdx < BinCount - 1; ++binIdx)
+			{
+				leftSum += bins[binIdx].primitiveCount;
+				leftCount[binIdx] = leftSum;
+				leftBounds.Grow(bins[binIdx].bounds);
+				leftArea[binIdx] = leftBounds.GetSurfaceArea();
+
+				rightSum += bins[BinCount - 1 - binIdx].primitiveCount;
+				rightCount[BinCount - 2 - binIdx] = rightSum;
+				rightBounds.Grow(bins[BinCount - 1 - binIdx].bounds);
+				rightArea[BinCount - 2 - binIdx] = rightBounds.GetSurfaceArea();
+			}
+
+			for (int binIdx{}; binIdx < BinCount - 1; ++binIdx)
+			{
+				if (leftCount[binIdx] == 0 || rightCount[binIdx] == 0) continue;
+
+				const float cost{ leftCount[binIdx] * leftArea[binIdx] + rightCount[binIdx] * rightArea[binIdx] };
+				if (cost < bestSplit.cost)
+				{
+					bestSplit.axis = axis;
+					bestSplit.bin = binIdx;
+					bestSplit.cost = cost;
+					bestSplit.centroidMin = centroidMin;
+					bestSplit.binScale = binScale;
+				}
+			}
+		}
+
+		if (bestSplit.axis < 0) return;
+
+		//compare against not splitting at all, big nodes are split regardless to keep leaves small
+		const AABB nodeBounds{ m_Nodes[nodeIdx].minAABB, m_Nodes[nodeIdx].maxAABB };
+		const float nodeArea{ nodeBounds.GetSurfaceArea() };
+		const float splitCost{ TraversalCost + IntersectionCost * bestSplit.cost / std::max(nodeArea, FLT_MIN) };
+		const float leafCost{ IntersectionCost * count };
+		if (splitCost >= leafCost && count <= MaxLeafSize) return;
+
+		//partition primitives in place, everything left of the split bin goes first
+		uint32_t leftIdx{ first };
+		uint32_t rightIdx{ first + count };
+		while (leftIdx < rightIdx)
+		{
+			const float centroid{ centroids[m_PrimitiveIndices[leftIdx]][bestSplit.axis] };
+			if (GetBinIndex(centroid, bestSplit.centroidMin, bestSplit.binScale) <= bestSplit.bin)
+			{
+				++leftIdx;
+			}
+			else
+			{
+				std::swap(m_PrimitiveIndices[leftIdx], m_PrimitiveIndices[--rightIdx]);
+			}
+		}
+
+		const uint32_t leftCount{ leftIdx - first };
+		if (leftCount == 0 || leftCount == count) return;
+
+		//create child nodes, this invalidates references into m_Nodes
+		const uint32_t leftChildIdx{ static_cast<uint32_t>(m_Nodes.size()) };
+		m_Nodes.emplace_back(BVHNode{ {}, first, {}, leftCount });
+		m_Nodes.emplace_back(BVHNode{ {}, leftIdx, {}, count - leftCount });
+
+		m_Nodes[nodeIdx].leftFirst = leftChildIdx;
+		m_Nodes[nodeIdx].primitiveCount = 0;
+
+		UpdateNodeBounds(leftChildIdx, primitiveBounds);
+		UpdateNodeBounds(leftChildIdx + 1, primitiveBounds);
+
+		Subdivide(leftChildIdx, depth + 1, primitiveBounds, centroids);
+		Subdivide(leftChildIdx + 1, depth + 1, primitiveBounds, centroids);
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Maths.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	struct AABB
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& point)
+		{
+			min = Vector3::Min(min, point);
+			max = Vector3::Max(max, point);
+		}
+
+		void Grow(const AABB& other)
+		{
+			min = Vector3::Min(min, other.min);
+			max = Vector3::Max(max, other.max);
+		}
+
+		Vector3 GetCenter() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		//bounds of all eight corners after transforming them
+		AABB Transformed(const Matrix& transform) const
+		{
+			AABB transformed{};
+			for (int cornerIdx{}; cornerIdx < 8; ++cornerIdx)
+			{
+				transformed.Grow(transform.TransformPoint(
+					(cornerIdx & 1) ? max.x : min.x,
+					(cornerIdx & 2) ? max.y : min.y,
+					(cornerIdx & 4) ? max.z : min.z));
+			}
+			return transformed;
+		}
+
+		float GetSurfaceArea() const
+		{
+			//empty boxes (nothing grown yet) have no area
+			const Vector3 extent{ max - min };
+			if (extent.x < 0.f || extent.y < 0.f || extent.z < 0.f) return 0.f;
+
+			return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+	};
+
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		uint32_t leftFirst{}; //left child index for interior nodes, first primitive index for leaves
+		Vector3 maxAABB{};
+		uint32_t primitiveCount{}; //0 for interior nodes
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	enum class BVHBuildMode
+	{
+		SAH, //binned surface area heuristic, best trees
+		LBVH, //parallel Morton code sort (linear BVH), fastest build
+		SBVH //SAH that can also split primitives across both children (spatial splits), needs triangle vertices
+	};
+
+	enum class BVHUpdateMode
+	{
+		Rebuild, //build a new tree every update
+		Refit //keep the topology and only grow/shrink node bounds, rebuild once the tree quality degrades too much
+	};
+
+	//counters filled in by the traversal functions when asked for, to compare hierarchies
+	struct TraversalStats
+	{
+		uint64_t nodeVisits{};
+		uint64_t primitiveTests{};
+	};
+
+	//Bounding Volume Hierarchy over a list of primitive bounds, built with the binned Surface Area Heuristic.
+	//The children of an interior node are always stored next to each other (leftFirst, leftFirst + 1).
+	//Traversal lives with the other hit-tests in Utils.h.
+	class BVH final
+	{
+	public:
+		//deepest path the builder will create, traversal stacks are sized on this
+		static constexpr uint32_t MaxDepth{ 64 };
+		//nodes with more primitives than this are always split when a valid split exists
+		static constexpr uint32_t MaxLeafSize{ 8 };
+
+		//refitted trees whose SAH cost grows past this factor of the cost right after building get rebuilt
+		static constexpr float DefaultRebuildThreshold{ 1.5f };
+		//SBVH builds may add this fraction of the primitive count as extra references
+		static constexpr float DefaultSpatialSplitBudget{ .3f };
+
+		/**
+		 * \brief Builds a new tree over the given primitives
+		 * \param pTriangleVertices Corners of every primitive (primitive i uses [i * 3, i * 3 + 2]), only used by SBVH which falls back to SAH without them
+		 */
+		void Build(const std::vector<AABB>& primitiveBounds, BVHBuildMode buildMode = BVHBuildMode::SAH, const std::vector<Vector3>* pTriangleVertices = nullptr);
+		//spatial split references keep their full primitive bounds after a refit, so refitted SBVH trees are looser than built ones
+		void Refit(const std::vector<AABB>& primitiveBounds);
+		//refits (or rebuilds when the primitive count changed or the refitted tree is too costly) following updateMode
+		void Update(const std::vector<AABB>& primitiveBounds, BVHUpdateMode updateMode = BVHUpdateMode::Refit, BVHBuildMode buildMode = BVHBuildMode::SAH,
+			const std::vector<Vector3>* pTriangleVertices = nullptr);
+		void Clear();
+
+		void SetRebuildThreshold(float threshold) { m_RebuildThreshold = threshold; }
+		void SetSpatialSplitBudget(float budget) { m_SpatialSplitBudget = budget; }
+		//LBVH builds split their passes over this pool, without one they run on the calling thread.
+		//The pool is shared with the caller, so it must not be running another job while this tree builds.
+		void SetThreadPool(ThreadPool* pThreadPool) { m_pThreadPool = pThreadPool; }
+		//SAH cost of the tree relative to its root area, lower is better
+		float GetCost() const { return m_Cost; }
+		float GetBuildCost() const { return m_BuildCost; }
+		//wall clock time of the last full build in milliseconds
+		float GetBuildTime() const { return m_BuildTime; }
+		uint32_t GetPrimitiveCount() const { return m_PrimitiveCount; }
+		//number of primitive references in the leaves, higher than the primitive count when spatial splits duplicated some
+		uint32_t GetReferenceCount() const { return static_cast<uint32_t>(m_PrimitiveIndices.size()); }
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		const std::vector<BVHNode>& GetNodes() const { return m_Nodes; }
+		const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+	private:
+		struct SpatialReference;
+
+		void UpdateNodeBounds(uint32_t nodeIdx, const std::vector<AABB>& primitiveBounds);
+		void Subdivide(uint32_t nodeIdx, uint32_t depth, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids);
+		void BuildSAH(const std::vector<AABB>& primitiveBounds);
+		void BuildLBVH(const std::vector<AABB>& primitiveBounds);
+		void BuildSBVH(const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& triangleVertices);
+		void SubdivideSpatial(uint32_t nodeIdx, uint32_t depth, std::vector<SpatialReference>& references, const std::vector<Vector3>& triangleVertices);
+		float CalculateCost() const;
+
+		std::vector<BVHNode> m_Nodes{};
+		std::vector<uint32_t> m_PrimitiveIndices{};
+		uint32_t m_PrimitiveCount{};
+
+		float m_Cost{};
+		float m_BuildCost{};
+		float m_BuildTime{};
+		float m_RebuildThreshold{ DefaultRebuildThreshold };
+
+		float m_SpatialSplitBudget{ DefaultSpatialSplitBudget };
+		uint32_t m_MaxReferenceCount{};
+		uint32_t m_ReferenceCount{};
+
+		ThreadPool* m_pThreadPool{};
+	};
+}
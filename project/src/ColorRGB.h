@@ -1,12 +1,31 @@
 #pragma once
 #include "MathHelpers.h"
+#if defined(SIMD_MATH)
+#include <immintrin.h>
+#endif
 namespace dae
 {
+	//SIMD_MATH builds keep the color in one 16-byte aligned SSE register, like Vector3
+#if defined(SIMD_MATH)
+	struct alignas(16) ColorRGB
+#else
 	struct ColorRGB
+#endif
 	{
 		float r{};
 		float g{};
 		float b{};
+#if defined(SIMD_MATH)
+		float a{}; //padding lane, never part of the result
+
+		static ColorRGB FromRegister(__m128 values)
+		{
+			ColorRGB color;
+			_mm_store_ps(&color.r, values);
+			return color;
+		}
+		__m128 Load() const { return _mm_load_ps(&r); }
+#endif
 		void MaxToOne()
 		{
 			const float maxValue = std::max(r, std::max(g, b));
@@ -20,6 +39,62 @@ namespace dae
 			Lerpf(c1.b, c2.b, factor) };
 		}
 #pragma region ColorRGB (Member) Operators
+#if defined(SIMD_MATH)
+		const ColorRGB& operator+=(const ColorRGB& c)
+		{
+			_mm_store_ps(&r, _mm_add_ps(Load(), c.Load()));
+			return *this;
+		}
+		ColorRGB operator+(const ColorRGB& c) const
+		{
+			return FromRegister(_mm_add_ps(Load(), c.Load()));
+		}
+		const ColorRGB& operator-=(const ColorRGB& c)
+		{
+			_mm_store_ps(&r, _mm_sub_ps(Load(), c.Load()));
+			return *this;
+		}
+		ColorRGB operator-(const ColorRGB& c) const
+		{
+			return FromRegister(_mm_sub_ps(Load(), c.Load()));
+		}
+		const ColorRGB& operator*=(const ColorRGB& c)
+		{
+			_mm_store_ps(&r, _mm_mul_ps(Load(), c.Load()));
+			return *this;
+		}
+		ColorRGB operator*(const ColorRGB& c) const
+		{
+			return FromRegister(_mm_mul_ps(Load(), c.Load()));
+		}
+		const ColorRGB& operator/=(const ColorRGB& c)
+		{
+			_mm_store_ps(&r, _mm_div_ps(Load(), c.Load()));
+			return *this;
+		}
+		ColorRGB operator/(const ColorRGB& c) const
+		{
+			return FromRegister(_mm_div_ps(Load(), c.Load()));
+		}
+		const ColorRGB& operator*=(float s)
+		{
+			_mm_store_ps(&r, _mm_mul_ps(Load(), _mm_set1_ps(s)));
+			return *this;
+		}
+		ColorRGB operator*(float s) const
+		{
+			return FromRegister(_mm_mul_ps(Load(), _mm_set1_ps(s)));
+		}
+		const ColorRGB& operator/=(float s)
+		{
+			_mm_store_ps(&r, _mm_div_ps(Load(), _mm_set1_ps(s)));
+			return *this;
+		}
+		ColorRGB operator/(float s) const
+		{
+			return FromRegister(_mm_div_ps(Load(), _mm_set1_ps(s)));
+		}
+#else
 		const ColorRGB& operator+=(const ColorRGB& c)
 		{
 			r += c.r;
@@ -60,7 +135,7 @@ namespace dae
 			b /= c.b;
 			return *this;
 		}
-		const ColorRGB& operator/(const ColorRGB& c) const
+		ColorRGB operator/(const ColorRGB& c) const
 		{
 			return { r / c.r, g / c.g, b / c.b };
 		}
@@ -82,10 +157,11 @@ namespace dae
 			b /= s;
 			return *this;
 		}
-		const ColorRGB& operator/(float s) const
+		ColorRGB operator/(float s) const
 		{
 			return { r / s, g / s, b / s };
 		}
+#endif
 #pragma endregion
 	};
 	//ColorRGB (Global) Operators
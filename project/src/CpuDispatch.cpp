@@ -0,0 +1,129 @@
+#include "CpuDispatch.h"
+
+#include <algorithm>
+#include <cctype>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace dae
+{
+	//one table per ISA, each defined in its own SimdKernels_*.cpp
+	namespace SimdKernels
+	{
+		const KernelTable& GetKernelTable_SSE();
+		const KernelTable& GetKernelTable_AVX2();
+		const KernelTable& GetKernelTable_AVX512();
+	}
+
+	namespace
+	{
+		constexpr const char* IsaNames[]{ "SSE", "AVX2", "AVX512" };
+
+		void ReadCpuid(uint32_t leaf, uint32_t subLeaf, uint32_t registers[4])
+		{
+#if defined(_MSC_VER)
+			int values[4]{};
+			__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subLeaf));
+			for (int registerIdx{}; registerIdx < 4; ++registerIdx) registers[registerIdx] = static_cast<uint32_t>(values[registerIdx]);
+#else
+			__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+		}
+
+		//register state the OS saves on context switches (XCR0)
+		uint64_t ReadEnabledRegisterState()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t low{}, high{};
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+		}
+
+		const KernelTable*& GetSelectedTable()
+		{
+			static const KernelTable* pTable{ &Dispatch::GetKernels(Dispatch::DetectIsaLevel()) };
+			return pTable;
+		}
+	}
+
+	namespace Dispatch
+	{
+		IsaLevel DetectIsaLevel()
+		{
+			uint32_t registers[4]{};
+			ReadCpuid(0, 0, registers);
+			const uint32_t maxLeaf{ registers[0] };
+			if (maxLeaf < 7) return IsaLevel::SSE;
+
+			ReadCpuid(1, 0, registers);
+			const bool hasFma{ (registers[2] & (1u << 12)) != 0 };
+			const bool hasOsxsave{ (registers[2] & (1u << 27)) != 0 };
+			const bool hasAvx{ (registers[2] & (1u << 28)) != 0 };
+			if (!hasOsxsave || !hasAvx || !hasFma) return IsaLevel::SSE;
+
+			//the OS has to save the xmm/ymm registers (bits 1 and 2), and the AVX-512 mask and zmm registers (bits 5 to 7)
+			const uint64_t enabledState{ ReadEnabledRegisterState() };
+			if ((enabledState & 0x6) != 0x6) return IsaLevel::SSE;
+
+			ReadCpuid(7, 0, registers);
+			const bool hasAvx2{ (registers[1] & (1u << 5)) != 0 };
+			const bool hasAvx512F{ (registers[1] & (1u << 16)) != 0 };
+			if (!hasAvx2) return IsaLevel::SSE;
+			if (hasAvx512F && (enabledState & 0xE6) == 0xE6) return IsaLevel::AVX512;
+			return IsaLevel::AVX2;
+		}
+
+		const char* GetIsaName(IsaLevel isaLevel)
+		{
+			return IsaNames[static_cast<int>(isaLevel)];
+		}
+
+		bool ParseIsaLevel(std::string_view name, IsaLevel& isaLevel)
+		{
+			for (int levelIdx{}; levelIdx < static_cast<int>(IsaLevel::count); ++levelIdx)
+			{
+				const std::string_view levelName{ IsaNames[levelIdx] };
+				const bool isMatch{ std::equal(name.begin(), name.end(), levelName.begin(), levelName.end(),
+					[](char a, char b) { return std::toupper(static_cast<unsigned char>(a)) == b; }) };
+				if (!isMatch) continue;
+
+				isaLevel = static_cast<IsaLevel>(levelIdx);
+				return true;
+			}
+			return false;
+		}
+
+		bool SelectIsaLevel(IsaLevel isaLevel)
+		{
+			const IsaLevel supportedLevel{ DetectIsaLevel() };
+			const bool isSupported{ isaLevel <= supportedLevel };
+			GetSelectedTable() = &GetKernels(isSupported ? isaLevel : supportedLevel);
+			return isSupported;
+		}
+
+		const KernelTable& GetKernels()
+		{
+			return *GetSelectedTable();
+		}
+
+		const KernelTable& GetKernels(IsaLevel isaLevel)
+		{
+			switch (isaLevel)
+			{
+			case IsaLevel::AVX512:
+				return SimdKernels::GetKernelTable_AVX512();
+			case IsaLevel::AVX2:
+				return SimdKernels::GetKernelTable_AVX2();
+			default:
+				return SimdKernels::GetKernelTable_SSE();
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+#include "FastMath.h"
+#include "Maths.h"
+
+namespace dae
+{
+	struct Ray;
+	struct RayPacket;
+	struct ShadingBatch;
+	struct LambertPhongParameters;
+	struct CookTorranceParameters;
+	template<int Width>
+	struct TriangleBlock;
+
+	//Instruction set levels the hot kernels are compiled for, ordered from the oldest to the newest
+	enum class IsaLevel
+	{
+		SSE, //SSE4.2 machines, the baseline every x64 build runs on
+		AVX2, //AVX2 and FMA
+		AVX512, //AVX-512 Foundation
+		count
+	};
+
+	//Structure of arrays sphere data as the sphere kernels read it, every array is padded so a full register can be loaded from any slot
+	struct SphereSlots
+	{
+		const float* pX{};
+		const float* pY{};
+		const float* pZ{};
+		const float* pRadiusSquared{}; //negative for empty slots
+	};
+
+	//Channel layout of a 32-bit surface, a packed pixel is (channel >> loss) << shift for every channel, or'ed with alphaMask
+	struct PixelFormat
+	{
+		int redShift{ 16 };
+		int greenShift{ 8 };
+		int blueShift{ 0 };
+		int redLoss{};
+		int greenLoss{};
+		int blueLoss{};
+		uint32_t alphaMask{};
+	};
+
+	//Tone curves of the resolve pass
+	enum class ToneMapping
+	{
+		MaxToOne, //scales colors brighter than white down to it, keeping the hue, see ColorRGB::MaxToOne
+		Reinhard, //c / (1 + c) per channel
+		Aces, //Narkowicz's fit of the ACES filmic curve
+		count
+	};
+
+	//How the float frame becomes surface pixels: exposure, then the tone curve, then gamma, then 8-bit quantization
+	struct ResolveSettings
+	{
+		float exposure{ 1.f }; //scales the color before tone mapping
+		ToneMapping toneMapping{ ToneMapping::MaxToOne };
+		float gamma{ 1.f }; //every channel is raised to 1 / gamma, 1 keeps the linear values
+	};
+
+	//One implementation of every dispatched kernel, all compiled for the same instruction set
+	struct KernelTable
+	{
+		IsaLevel isaLevel{};
+
+		//nearest hit among slots [firstSlot, firstSlot + slotCount) within [ray.min, ray.max], see SphereStore::IntersectNearest
+		bool (*intersectSpheres)(const SphereSlots& spheres, uint32_t firstSlot, uint32_t slotCount, const Ray& ray, float& t, uint32_t& slot) {};
+		bool (*occludedSpheres)(const SphereSlots& spheres, uint32_t firstSlot, uint32_t slotCount, const Ray& ray) {};
+		//see TriangleBlocks::Intersect
+		int (*intersectTriangleBlock4)(const TriangleBlock<4>& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances) {};
+		int (*intersectTriangleBlock8)(const TriangleBlock<8>& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances) {};
+		//see RayPacket::IntersectBox
+		uint64_t (*intersectPacketBox)(const RayPacket& packet, const Vector3& boxMin, const Vector3& boxMax, uint64_t rayMask) {};
+		//turns count float colors into surface pixels as the settings describe, quantized to 8 bits per channel like SDL_MapRGB
+		void (*resolvePixels)(const float* pRed, const float* pGreen, const float* pBlue, uint32_t count, const ResolveSettings& settings, const PixelFormat& format, uint32_t* pPixels) {};
+		//BRDF of every sample of the batch, see Material::ShadeBatch
+		void (*shadeLambertPhong)(const ShadingBatch& batch, const LambertPhongParameters& parameters, MathTier tier, float* pRed, float* pGreen, float* pBlue) {};
+		void (*shadeCookTorrance)(const ShadingBatch& batch, const CookTorranceParameters& parameters, MathTier tier, float* pRed, float* pGreen, float* pBlue) {};
+	};
+
+	//Picks the kernels of the best instruction set the CPU supports, once at startup
+	namespace Dispatch
+	{
+		//highest level CPUID reports and the OS saves the registers of
+		IsaLevel DetectIsaLevel();
+		const char* GetIsaName(IsaLevel isaLevel);
+		//accepts the names of GetIsaName in any case, "sse", "avx2" or "avx512"
+		bool ParseIsaLevel(std::string_view name, IsaLevel& isaLevel);
+
+		/**
+		 * \brief Switches every dispatched kernel to one instruction set, for testing the narrower paths on a newer CPU
+		 * \return false if the CPU doesn't support the level, the best supported level is selected instead
+		 */
+		bool SelectIsaLevel(IsaLevel isaLevel);
+		//the kernels of the selected level, DetectIsaLevel() until SelectIsaLevel overrides it
+		const KernelTable& GetKernels();
+		//the kernels of one level, the CPU has to support it
+		const KernelTable& GetKernels(IsaLevel isaLevel);
+	}
+}
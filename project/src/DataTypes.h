@@ -1,8 +1,12 @@
 #pragma once
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include "Maths.h"
+#include "BVH.h"
+#include "WideBVH.h"
+#include "TriangleBlock.h"
 
 
 namespace dae
@@ -92,6 +96,24 @@ namespace dae
 
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
+		//one record per triangle, rebuilt in UpdateTransforms, indexed like transformedNormals
+		std::vector<TriangleRecord> triangleRecords{};
+
+		//hierarchy over the transformed triangles, primitive i is the triangle starting at indices[i * 3]
+		BVH bvh{};
+		//animated meshes refit their hierarchy every UpdateTransforms instead of rebuilding it
+		BVHUpdateMode bvhUpdateMode{ BVHUpdateMode::Refit };
+		//LBVH builds much faster on big meshes at the cost of a somewhat slower tree, see bvh.GetBuildTime()
+		//SBVH suits meshes with long, thin triangles, see bvh.SetSpatialSplitBudget()
+		BVHBuildMode bvhBuildMode{ BVHBuildMode::SAH };
+		//wide layouts are collapsed from bvh after every update and used for traversal instead of it
+		BVHLayout bvhLayout{ BVHLayout::Binary };
+		WideBVH<4> wideBVH4{};
+		WideBVH<8> wideBVH8{};
+		//packs the triangles of every leaf into SIMD blocks, rebuilt after every hierarchy update
+		TriangleLayout triangleLayout{ TriangleLayout::Single };
+		TriangleBlocks<4> triangleBlocks4{};
+		TriangleBlocks<8> triangleBlocks8{};
 
 		void Translate(const Vector3& translation)
 		{
@@ -167,6 +189,100 @@ namespace dae
 				transformedPositions.emplace_back(transformMatrix.TransformPoint(p));
 			}
 			UpdateTransformedAABB(transformMatrix);
+			UpdateTriangleRecords();
+			UpdateBVH();
+		}
+
+		//takes over everything UpdateTransforms derives from the transforms of a mesh built from the same triangles,
+		//the vectors keep their capacity so a copy every frame doesn't allocate
+		void CopyTransformedState(const TriangleMesh& source)
+		{
+			rotationTransform = source.rotationTransform;
+			translationTransform = source.translationTransform;
+			scaleTransform = source.scaleTransform;
+			transformedMinAABB = source.transformedMinAABB;
+			transformedMaxAABB = source.transformedMaxAABB;
+
+			transformedPositions = source.transformedPositions;
+			transformedNormals = source.transformedNormals;
+			triangleRecords = source.triangleRecords;
+
+			bvh = source.bvh;
+			wideBVH4 = source.wideBVH4;
+			wideBVH8 = source.wideBVH8;
+			triangleBlocks4 = source.triangleBlocks4;
+			triangleBlocks8 = source.triangleBlocks8;
+		}
+
+		void UpdateTriangleRecords()
+		{
+			triangleRecords.clear();
+			triangleRecords.reserve(indices.size() / 3);
+
+			for (size_t idx{}; idx + 2 < indices.size(); idx += 3)
+			{
+				const Vector3& v0{ transformedPositions[indices[idx]] };
+				triangleRecords.emplace_back(TriangleRecord::Create(v0,
+					transformedPositions[indices[idx + 1]] - v0,
+					transformedPositions[indices[idx + 2]] - v0,
+					transformedNormals[idx / 3].Normalized()));
+			}
+		}
+
+		void UpdateBVH()
+		{
+			//spatial splits clip the triangles themselves, the other builders only need their bounds
+			if (bvhBuildMode == BVHBuildMode::SBVH)
+			{
+				const std::vector<Vector3> triangleVertices{ GetTriangleVertices() };
+				bvh.Update(GetTriangleBounds(), bvhUpdateMode, bvhBuildMode, &triangleVertices);
+			}
+			else
+			{
+				bvh.Update(GetTriangleBounds(), bvhUpdateMode, bvhBuildMode);
+			}
+
+			wideBVH4.Clear();
+			wideBVH8.Clear();
+			if (bvhLayout == BVHLayout::Wide4) wideBVH4.Build(bvh);
+			else if (bvhLayout == BVHLayout::Wide8) wideBVH8.Build(bvh);
+
+			triangleBlocks4.Clear();
+			triangleBlocks8.Clear();
+			if (triangleLayout == TriangleLayout::Block4) triangleBlocks4.Build(bvh, triangleRecords);
+			else if (triangleLayout == TriangleLayout::Block8) triangleBlocks8.Build(bvh, triangleRecords);
+		}
+
+		std::vector<AABB> GetTriangleBounds() const
+		{
+			std::vector<AABB> triangleBounds{};
+			triangleBounds.reserve(indices.size() / 3);
+
+			for (size_t idx{}; idx + 2 < indices.size(); idx += 3)
+			{
+				AABB bounds{};
+				bounds.Grow(transformedPositions[indices[idx]]);
+				bounds.Grow(transformedPositions[indices[idx + 1]]);
+				bounds.Grow(transformedPositions[indices[idx + 2]]);
+				triangleBounds.emplace_back(bounds);
+			}
+
+			return triangleBounds;
+		}
+
+		std::vector<Vector3> GetTriangleVertices() const
+		{
+			std::vector<Vector3> triangleVertices{};
+			triangleVertices.reserve(indices.size());
+
+			for (size_t idx{}; idx + 2 < indices.size(); idx += 3)
+			{
+				triangleVertices.emplace_back(transformedPositions[indices[idx]]);
+				triangleVertices.emplace_back(transformedPositions[indices[idx + 1]]);
+				triangleVertices.emplace_back(transformedPositions[indices[idx + 2]]);
+			}
+
+			return triangleVertices;
 		}
 
 		void UpdateAABB()
@@ -219,8 +335,8 @@ namespace dae
 			tMinAABB = Vector3::Min(tAABB, tMinAABB);
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
-			// (xmax, ymin, zmin)
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, minAABB.z);
+			// (xmin, ymax, zmax)
+			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, maxAABB.z);
 			tMinAABB = Vector3::Min(tAABB, tMinAABB);
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
@@ -228,6 +344,50 @@ namespace dae
 			transformedMaxAABB = tMaxAABB;
 		}
 	};
+
+	//Lightweight placement of a shared mesh, rays are moved into the object space of the mesh instead of transforming its vertices.
+	//The shared mesh keeps identity transforms so its positions and BVH are in object space.
+	struct MeshInstance
+	{
+		MeshInstance() = default;
+		MeshInstance(const std::shared_ptr<const TriangleMesh>& _pMesh, const Matrix& _transform, unsigned char _materialIndex) :
+			pMesh{ _pMesh }, materialIndex{ _materialIndex }
+		{
+			SetTransform(_transform);
+		}
+
+		std::shared_ptr<const TriangleMesh> pMesh{};
+		unsigned char materialIndex{};
+
+		Matrix transform{};
+		Matrix inverseTransform{};
+
+		Vector3 transformedMinAABB;
+		Vector3 transformedMaxAABB;
+
+		void SetTransform(const Matrix& _transform)
+		{
+			transform = _transform;
+			inverseTransform = Matrix::Inverse(_transform);
+
+			//object space bounds come straight from the root of the shared hierarchy
+			if (!pMesh || pMesh->bvh.IsEmpty()) return;
+
+			const BVHNode& root{ pMesh->bvh.GetNodes()[0] };
+			const AABB worldBounds{ AABB{ root.minAABB, root.maxAABB }.Transformed(transform) };
+			transformedMinAABB = worldBounds.min;
+			transformedMaxAABB = worldBounds.max;
+		}
+
+		Vector3 TransformNormal(const Vector3& normal) const
+		{
+			//normals transform with the inverse transpose to stay perpendicular under non-uniform scale
+			return Vector3{
+				Vector3::Dot(inverseTransform.GetAxisX(), normal),
+				Vector3::Dot(inverseTransform.GetAxisY(), normal),
+				Vector3::Dot(inverseTransform.GetAxisZ(), normal) }.Normalized();
+		}
+	};
 #pragma endregion
 #pragma region LIGHT
 	enum class LightType
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+#include "SimdIsa.h"
+
+namespace dae
+{
+	//Accuracy of the math in the shading code, see Renderer::RenderQuality
+	enum class MathTier
+	{
+		Exact, //the std functions, reference renders
+		Fast //the FastMath approximations, previews
+	};
+
+	//Cheaper stand-ins for the std functions the shading code calls. Each states its error against the std version,
+	//the UnitTests check those bounds. SimdKernels.h has the same algorithms for whole registers.
+	//The dispatched kernels call them too, so they live in the ISA namespace of SimdIsa.h.
+	namespace FastMath
+	{
+	inline namespace SIMD_ISA_NAMESPACE
+	{
+		//std::bit_cast without the std template, see SimdIsa.h
+		template<typename To, typename From>
+		To BitCast(From value)
+		{
+			static_assert(sizeof(To) == sizeof(From));
+			To result;
+			std::memcpy(&result, &value, sizeof(To));
+			return result;
+		}
+
+		//coefficients 2 / (ln(2) * i) of the odd series of log2((1 + t) / (1 - t))
+		constexpr float Log2Coefficients[]{ 2.885390082f, 0.9617966939f, 0.5770780164f, 0.4121985831f, 0.3205988980f };
+		//coefficients ln(2)^i / i! of the Taylor series of 2^f
+		constexpr float Exp2Coefficients[]{ 1.f, 0.6931471806f, 0.2402265070f, 0.05550410866f, 0.009618129108f, 0.001333355815f, 0.0001540353039f };
+		//bits of sqrt(0.5), Log2 reduces the mantissa to [sqrt(0.5), sqrt(2))
+		constexpr uint32_t SqrtHalfBits{ 0x3f3504f3 };
+
+		/**
+		 * \brief x^Exponent as a chain of squarings, within 2 ulps of std::pow for the small exponents the BRDFs use
+		 */
+		template<unsigned int Exponent>
+		constexpr float Pow(float x)
+		{
+			if constexpr (Exponent == 0) return 1.f;
+			else if constexpr (Exponent == 1) return x;
+			else
+			{
+				const float half{ Pow<Exponent / 2>(x) };
+				if constexpr (Exponent % 2 == 0) return half * half;
+				else return half * half * x;
+			}
+		}
+
+		//1 / sqrt(x) for x > 0, the 12-bit hardware estimate refined by one Newton step, relative error below 1e-6
+		inline float RSqrt(float x)
+		{
+			const float estimate{ _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x))) };
+			return estimate * (1.5f - 0.5f * x * estimate * estimate);
+		}
+
+		//log2(x) for normal x > 0, absolute error below 2e-7 + 1e-7 * |log2(x)|
+		inline float Log2(float x)
+		{
+			//x = m * 2^exponent with m in [sqrt(0.5), sqrt(2))
+			const int32_t exponent{ static_cast<int32_t>(BitCast<uint32_t>(x) - SqrtHalfBits) >> 23 };
+			const float m{ BitCast<float>(BitCast<uint32_t>(x) - (static_cast<uint32_t>(exponent) << 23)) };
+
+			//log2(m) = log2((1 + t) / (1 - t)) with |t| < 0.172
+			const float t{ (m - 1.f) / (m + 1.f) };
+			const float tSquared{ t * t };
+			float series{ Log2Coefficients[4] };
+			for (int coefficientIdx{ 3 }; coefficientIdx >= 0; --coefficientIdx) series = series * tSquared + Log2Coefficients[coefficientIdx];
+			return t * series + static_cast<float>(exponent);
+		}
+
+		//2^x, relative error below 4e-7, x is clamped to [-126, 127] so the result stays a normal float
+		inline float Exp2(float x)
+		{
+			x = x < -126.f ? -126.f : (x > 127.f ? 127.f : x);
+
+			//2^x = 2^n * 2^f with f in [-0.5, 0.5]
+			const int32_t n{ static_cast<int32_t>(_mm_cvtss_si32(_mm_set_ss(x))) };
+			const float f{ x - static_cast<float>(n) };
+			float series{ Exp2Coefficients[6] };
+			for (int coefficientIdx{ 5 }; coefficientIdx >= 0; --coefficientIdx) series = series * f + Exp2Coefficients[coefficientIdx];
+			return BitCast<float>(BitCast<uint32_t>(series) + (static_cast<uint32_t>(n) << 23));
+		}
+
+		/**
+		 * \brief x^y through Exp2(y * Log2(x)), for the Phong lobe
+		 * \return 0 for x <= 0, a lobe facing away from the viewer adds no light. Relative error below 4e-7 * (1 + |y * log2(x)|)
+		 */
+		inline float Pow(float x, float y)
+		{
+			if (x <= 0.f) return 0.f;
+			return Exp2(y * Log2(x));
+		}
+	}
+	}
+}
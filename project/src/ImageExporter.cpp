@@ -0,0 +1,306 @@
+#include "ImageExporter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+namespace dae
+{
+	namespace
+	{
+		void AppendLittleEndian(std::vector<uint8_t>& bytes, uint32_t value, int byteCount)
+		{
+			for (int byteIdx{}; byteIdx < byteCount; ++byteIdx) bytes.push_back(static_cast<uint8_t>(value >> (8 * byteIdx)));
+		}
+
+		void AppendBigEndian(std::vector<uint8_t>& bytes, uint32_t value)
+		{
+			for (int byteIdx{ 3 }; byteIdx >= 0; --byteIdx) bytes.push_back(static_cast<uint8_t>(value >> (8 * byteIdx)));
+		}
+
+		//8-bit channel of a packed pixel, the inverse of the packing in PixelFormat
+		uint8_t UnpackChannel(uint32_t pixel, int shift, int loss)
+		{
+			return static_cast<uint8_t>(((pixel >> shift) & (0xFFu >> loss)) << loss);
+		}
+
+		uint32_t Crc32(const uint8_t* pBytes, size_t count)
+		{
+			static const std::array<uint32_t, 256> table{ [] {
+				std::array<uint32_t, 256> values{};
+				for (uint32_t byte{}; byte < 256; ++byte)
+				{
+					uint32_t crc{ byte };
+					for (int bit{}; bit < 8; ++bit) crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+					values[byte] = crc;
+				}
+				return values;
+				}() };
+
+			uint32_t crc{ 0xFFFFFFFFu };
+			for (size_t byteIdx{}; byteIdx < count; ++byteIdx) crc = table[(crc ^ pBytes[byteIdx]) & 0xFF] ^ (crc >> 8);
+			return crc ^ 0xFFFFFFFFu;
+		}
+
+		//length, type, data and the CRC of type and data
+		void AppendPngChunk(std::vector<uint8_t>& bytes, const char* type, const std::vector<uint8_t>& data)
+		{
+			AppendBigEndian(bytes, static_cast<uint32_t>(data.size()));
+			const size_t typeStart{ bytes.size() };
+			bytes.insert(bytes.end(), type, type + 4);
+			bytes.insert(bytes.end(), data.begin(), data.end());
+			AppendBigEndian(bytes, Crc32(&bytes[typeStart], bytes.size() - typeStart));
+		}
+	}
+
+#pragma region Encoding
+	const char* ImageEncoding::GetExtension(ImageFormat format)
+	{
+		constexpr const char* extensions[]{ "bmp", "png", "pfm" };
+		return extensions[int(format)];
+	}
+
+	void ImageEncoding::EncodeBmp(const uint32_t* pPixels, uint32_t width, uint32_t height, const PixelFormat& pixelFormat, std::vector<uint8_t>& bytes)
+	{
+		constexpr uint32_t headerSize{ 14 + 40 };
+		const uint32_t rowSize{ (width * 3 + 3) & ~3u };
+
+		bytes.clear();
+		bytes.reserve(headerSize + rowSize * height);
+
+		//file header
+		bytes.push_back('B');
+		bytes.push_back('M');
+		AppendLittleEndian(bytes, headerSize + rowSize * height, 4);
+		AppendLittleEndian(bytes, 0, 4);
+		AppendLittleEndian(bytes, headerSize, 4);
+
+		//info header, positive height stores the rows bottom-up
+		AppendLittleEndian(bytes, 40, 4);
+		AppendLittleEndian(bytes, width, 4);
+		AppendLittleEndian(bytes, height, 4);
+		AppendLittleEndian(bytes, 1, 2);
+		AppendLittleEndian(bytes, 24, 2);
+		for (int fieldIdx{}; fieldIdx < 6; ++fieldIdx) AppendLittleEndian(bytes, 0, 4);
+
+		for (uint32_t y{ height }; y-- > 0;)
+		{
+			const uint32_t* pRow{ pPixels + y * width };
+			for (uint32_t x{}; x < width; ++x)
+			{
+				bytes.push_back(UnpackChannel(pRow[x], pixelFormat.blueShift, pixelFormat.blueLoss));
+				bytes.push_back(UnpackChannel(pRow[x], pixelFormat.greenShift, pixelFormat.greenLoss));
+				bytes.push_back(UnpackChannel(pRow[x], pixelFormat.redShift, pixelFormat.redLoss));
+			}
+			bytes.resize(bytes.size() + rowSize - width * 3);
+		}
+	}
+
+	void ImageEncoding::EncodePng(const uint32_t* pPixels, uint32_t width, uint32_t height, const PixelFormat& pixelFormat, std::vector<uint8_t>& bytes)
+	{
+		constexpr uint8_t signature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		bytes.assign(std::begin(signature), std::end(signature));
+
+		std::vector<uint8_t> header{};
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bits per channel, RGB, deflate, no filter method extensions, not interlaced
+		AppendPngChunk(bytes, "IHDR", header);
+
+		//every row starts with filter type 0, the raw bytes are split into stored deflate blocks of at most 65535 bytes
+		std::vector<uint8_t> rows{};
+		rows.reserve((width * 3 + 1) * height);
+		for (uint32_t y{}; y < height; ++y)
+		{
+			rows.push_back(0);
+			const uint32_t* pRow{ pPixels + y * width };
+			for (uint32_t x{}; x < width; ++x)
+			{
+				rows.push_back(UnpackChannel(pRow[x], pixelFormat.redShift, pixelFormat.redLoss));
+				rows.push_back(UnpackChannel(pRow[x], pixelFormat.greenShift, pixelFormat.greenLoss));
+				rows.push_back(UnpackChannel(pRow[x], pixelFormat.blueShift, pixelFormat.blueLoss));
+			}
+		}
+
+		constexpr size_t MaxBlockSize{ 65535 };
+		std::vector<uint8_t> compressed{ 0x78, 0x01 };
+		compressed.reserve(rows.size() + rows.size() / MaxBlockSize * 5 + 16);
+		uint32_t adlerA{ 1 }, adlerB{};
+		size_t blockStart{};
+		do
+		{
+			const size_t blockSize{ std::min(rows.size() - blockStart, MaxBlockSize) };
+			compressed.push_back(blockStart + blockSize == rows.size() ? 1 : 0);
+			AppendLittleEndian(compressed, static_cast<uint32_t>(blockSize), 2);
+			AppendLittleEndian(compressed, static_cast<uint32_t>(~blockSize), 2);
+			compressed.insert(compressed.end(), rows.begin() + blockStart, rows.begin() + blockStart + blockSize);
+
+			for (size_t byteIdx{ blockStart }; byteIdx < blockStart + blockSize; ++byteIdx)
+			{
+				adlerA = (adlerA + rows[byteIdx]) % 65521;
+				adlerB = (adlerB + adlerA) % 65521;
+			}
+			blockStart += blockSize;
+		} while (blockStart < rows.size());
+		AppendBigEndian(compressed, adlerB << 16 | adlerA);
+
+		AppendPngChunk(bytes, "IDAT", compressed);
+		AppendPngChunk(bytes, "IEND", {});
+	}
+
+	void ImageEncoding::EncodePfm(const float* pRed, const float* pGreen, const float* pBlue, uint32_t width, uint32_t height, std::vector<uint8_t>& bytes)
+	{
+		//a negative scale marks little endian data
+		char header[64]{};
+		const int headerSize{ std::snprintf(header, sizeof(header), "PF\n%u %u\n-1.0\n", width, height) };
+		bytes.assign(header, header + headerSize);
+		bytes.reserve(headerSize + width * height * 3 * sizeof(float));
+
+		for (uint32_t y{ height }; y-- > 0;)
+		{
+			for (uint32_t pixelIdx{ y * width }; pixelIdx < (y + 1) * width; ++pixelIdx)
+			{
+				for (const float channel : { pRed[pixelIdx], pGreen[pixelIdx], pBlue[pixelIdx] })
+				{
+					AppendLittleEndian(bytes, std::bit_cast<uint32_t>(channel), 4);
+				}
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region Exporter
+	ImageExporter::ImageExporter(uint32_t maxBufferCount) :
+		m_MaxBufferCount{ std::max(maxBufferCount, 1u) }
+	{
+		m_ExportThread = std::thread{ &ImageExporter::ExportLoop, this };
+	}
+
+	ImageExporter::~ImageExporter()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_JobQueued.notify_one();
+		m_ExportThread.join();
+	}
+
+	bool ImageExporter::Export(ImageFormat format, const FrameView& frame)
+	{
+		std::unique_ptr<ExportJob> pJob{};
+		{
+			std::lock_guard lock{ m_Mutex };
+			if (!m_FreeJobs.empty())
+			{
+				pJob = std::move(m_FreeJobs.back());
+				m_FreeJobs.pop_back();
+			}
+			else if (m_BufferCount < m_MaxBufferCount)
+			{
+				pJob = std::make_unique<ExportJob>();
+				++m_BufferCount;
+			}
+			else
+			{
+				++m_Stats.skippedCaptures;
+				return false;
+			}
+		}
+
+		pJob->format = format;
+		pJob->width = frame.width;
+		pJob->height = frame.height;
+		pJob->pixelFormat = frame.pixelFormat;
+		pJob->captureTime = std::chrono::system_clock::now();
+
+		//the one copy the capture costs the frame
+		const uint32_t pixelCount{ frame.width * frame.height };
+		if (format == ImageFormat::Pfm)
+		{
+			pJob->red.assign(frame.pRed, frame.pRed + pixelCount);
+			pJob->green.assign(frame.pGreen, frame.pGreen + pixelCount);
+			pJob->blue.assign(frame.pBlue, frame.pBlue + pixelCount);
+		}
+		else pJob->pixels.assign(frame.pPixels, frame.pPixels + pixelCount);
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			pJob->sequenceIdx = m_NextSequenceIdx++;
+			m_QueuedJobs.push_back(std::move(pJob));
+		}
+		m_JobQueued.notify_one();
+		return true;
+	}
+
+	ExportStats ImageExporter::TakeStats()
+	{
+		std::lock_guard lock{ m_Mutex };
+		ExportStats stats{ std::move(m_Stats) };
+		m_Stats = {};
+		return stats;
+	}
+
+	void ImageExporter::ExportLoop()
+	{
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_JobQueued.wait(lock, [this] { return m_IsStopping || !m_QueuedJobs.empty(); });
+			//the queued captures are still written when the exporter is destroyed
+			if (m_QueuedJobs.empty()) return;
+
+			std::unique_ptr<ExportJob> pJob{ std::move(m_QueuedJobs.front()) };
+			m_QueuedJobs.pop_front();
+			lock.unlock();
+
+			const std::string fileName{ WriteJob(*pJob) };
+
+			lock.lock();
+			if (fileName.empty()) ++m_Stats.failedFiles;
+			else
+			{
+				++m_Stats.writtenFiles;
+				m_Stats.lastFileName = fileName;
+			}
+			m_FreeJobs.push_back(std::move(pJob));
+		}
+	}
+
+	std::string ImageExporter::WriteJob(const ExportJob& job)
+	{
+		switch (job.format)
+		{
+		case ImageFormat::Bmp:
+			ImageEncoding::EncodeBmp(job.pixels.data(), job.width, job.height, job.pixelFormat, m_EncodedBytes);
+			break;
+		case ImageFormat::Png:
+			ImageEncoding::EncodePng(job.pixels.data(), job.width, job.height, job.pixelFormat, m_EncodedBytes);
+			break;
+		default:
+			ImageEncoding::EncodePfm(job.red.data(), job.green.data(), job.blue.data(), job.width, job.height, m_EncodedBytes);
+			break;
+		}
+
+		//local capture time to the millisecond, the sequence number keeps captures within one millisecond apart
+		const std::time_t captureTime{ std::chrono::system_clock::to_time_t(job.captureTime) };
+		const auto milliseconds{ std::chrono::duration_cast<std::chrono::milliseconds>(job.captureTime.time_since_epoch()).count() % 1000 };
+		std::tm localTime{};
+#if defined(_WIN32)
+		localtime_s(&localTime, &captureTime);
+#else
+		localtime_r(&captureTime, &localTime);
+#endif
+		char fileName[96]{};
+		const size_t dateSize{ std::strftime(fileName, sizeof(fileName), "RayTracing_%Y%m%d_%H%M%S", &localTime) };
+		std::snprintf(fileName + dateSize, sizeof(fileName) - dateSize, "_%03d_%04u.%s", int(milliseconds), job.sequenceIdx, ImageEncoding::GetExtension(job.format));
+
+		std::ofstream file{ fileName, std::ios::binary };
+		file.write(reinterpret_cast<const char*>(m_EncodedBytes.data()), m_EncodedBytes.size());
+		return file ? fileName : std::string{};
+	}
+#pragma endregion
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuDispatch.h"
+
+namespace dae
+{
+	enum class ImageFormat
+	{
+		Bmp, //24-bit, the resolved frame
+		Png, //8-bit RGB, the resolved frame
+		Pfm, //32-bit float RGB, the linear frame before exposure and tone mapping
+		count
+	};
+
+	//A frame to export, only the pixels the format needs are read
+	struct FrameView
+	{
+		uint32_t width{};
+		uint32_t height{};
+		PixelFormat pixelFormat{};
+		const uint32_t* pPixels{}; //resolved, row major without padding, for Bmp and Png
+		const float* pRed{}; //linear planes, for Pfm
+		const float* pGreen{};
+		const float* pBlue{};
+	};
+
+	//What the export thread did since the last ImageExporter::TakeStats
+	struct ExportStats
+	{
+		uint32_t writtenFiles{};
+		uint32_t failedFiles{};
+		uint32_t skippedCaptures{}; //every pooled buffer was still waiting to be written
+		std::string lastFileName{};
+	};
+
+	//Encoders of the export formats, the files are built in memory and written in one go
+	namespace ImageEncoding
+	{
+		const char* GetExtension(ImageFormat format);
+
+		//bottom-up 24-bit BGR rows padded to 4 bytes
+		void EncodeBmp(const uint32_t* pPixels, uint32_t width, uint32_t height, const PixelFormat& pixelFormat, std::vector<uint8_t>& bytes);
+		//8-bit RGB in stored deflate blocks, there is no compression library in the tree and the writing thread isn't the bottleneck
+		void EncodePng(const uint32_t* pPixels, uint32_t width, uint32_t height, const PixelFormat& pixelFormat, std::vector<uint8_t>& bytes);
+		//little endian float RGB, bottom-up rows
+		void EncodePfm(const float* pRed, const float* pGreen, const float* pBlue, uint32_t width, uint32_t height, std::vector<uint8_t>& bytes);
+	}
+
+	//Writes captured frames to disk on its own thread. A capture copies the frame once into a pooled buffer and returns,
+	//encoding and writing happen in the background, so even capturing every frame costs the frame one copy.
+	class ImageExporter final
+	{
+	public:
+		/**
+		 * \param maxBufferCount Captures that can wait to be written at once, the buffers are allocated on first use
+		 */
+		explicit ImageExporter(uint32_t maxBufferCount = 4);
+		//writes every queued capture before it returns
+		~ImageExporter();
+
+		ImageExporter(const ImageExporter&) = delete;
+		ImageExporter(ImageExporter&&) noexcept = delete;
+		ImageExporter& operator=(const ImageExporter&) = delete;
+		ImageExporter& operator=(ImageExporter&&) noexcept = delete;
+
+		/**
+		 * \brief Copies the frame and queues it to be written as RayTracing_<date>_<time>_<sequence>.<extension>
+		 * \return false if every pooled buffer is taken, the capture is skipped rather than stalling the frame
+		 */
+		bool Export(ImageFormat format, const FrameView& frame);
+		//the stats since the previous call
+		ExportStats TakeStats();
+
+	private:
+		//one pooled capture, its vectors keep their capacity from one capture to the next
+		struct ExportJob
+		{
+			ImageFormat format{};
+			uint32_t width{};
+			uint32_t height{};
+			PixelFormat pixelFormat{};
+			std::chrono::system_clock::time_point captureTime{};
+			uint32_t sequenceIdx{};
+			std::vector<uint32_t> pixels{};
+			std::vector<float> red{};
+			std::vector<float> green{};
+			std::vector<float> blue{};
+		};
+
+		const uint32_t m_MaxBufferCount;
+		uint32_t m_BufferCount{};
+		uint32_t m_NextSequenceIdx{};
+
+		std::thread m_ExportThread{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_JobQueued{};
+
+		std::vector<std::unique_ptr<ExportJob>> m_FreeJobs{};
+		std::deque<std::unique_ptr<ExportJob>> m_QueuedJobs{};
+		bool m_IsStopping{};
+		ExportStats m_Stats{};
+
+		//only used by the export thread
+		std::vector<uint8_t> m_EncodedBytes{};
+
+		void ExportLoop();
+		//encodes and writes one capture, returns the file name or an empty string if the file couldn't be written
+		std::string WriteJob(const ExportJob& job);
+	};
+}
@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
+
 #include "Maths.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
+#include "CpuDispatch.h"
+#include "ShadingBatch.h"
 
 namespace dae
 {
@@ -25,6 +29,28 @@ namespace dae
 		 * \return color
 		 */
 		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+
+		/**
+		 * \brief Shade for every sample of a batch, the materials with a dispatched kernel evaluate several samples per instruction
+		 * \param batch normals, light and view directions of the samples
+		 * \param tier Fast lets the kernels use the FastMath approximations, the fallback always shades exactly
+		 * \param pRed, pGreen, pBlue receive one color per sample, each needs room for ShadingBatch::MaxSize values
+		 */
+		virtual void ShadeBatch(const ShadingBatch& batch, MathTier tier, float* pRed, float* pGreen, float* pBlue)
+		{
+			HitRecord hitRecord{};
+			for (uint32_t sampleIdx{}; sampleIdx < batch.count; ++sampleIdx)
+			{
+				hitRecord.normal = { batch.normalX[sampleIdx], batch.normalY[sampleIdx], batch.normalZ[sampleIdx] };
+				const Vector3 l{ batch.lightX[sampleIdx], batch.lightY[sampleIdx], batch.lightZ[sampleIdx] };
+				const Vector3 v{ batch.viewX[sampleIdx], batch.viewY[sampleIdx], batch.viewZ[sampleIdx] };
+
+				const ColorRGB color{ Shade(hitRecord, l, v) };
+				pRed[sampleIdx] = color.r;
+				pGreen[sampleIdx] = color.g;
+				pBlue[sampleIdx] = color.b;
+			}
+		}
 	};
 #pragma endregion
 
@@ -63,6 +89,15 @@ namespace dae
 			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
 		}
 
+		void ShadeBatch(const ShadingBatch& batch, MathTier tier, float* pRed, float* pGreen, float* pBlue) override
+		{
+			//independent of the directions
+			const ColorRGB color{ BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) };
+			std::fill_n(pRed, batch.count, color.r);
+			std::fill_n(pGreen, batch.count, color.g);
+			std::fill_n(pBlue, batch.count, color.b);
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{ colors::White };
 		float m_DiffuseReflectance{ 1.f }; //kd
@@ -88,6 +123,11 @@ namespace dae
 				+ BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal);
 		}
 
+		void ShadeBatch(const ShadingBatch& batch, MathTier tier, float* pRed, float* pGreen, float* pBlue) override
+		{
+			Dispatch::GetKernels().shadeLambertPhong(batch, { m_DiffuseColor, m_DiffuseReflectance, m_SpecularReflectance, m_PhongExponent }, tier, pRed, pGreen, pBlue);
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{ colors::White };
 		float m_DiffuseReflectance{ 0.5f }; //kd
@@ -138,6 +178,11 @@ namespace dae
 			return finalColor;
 		}
 
+		void ShadeBatch(const ShadingBatch& batch, MathTier tier, float* pRed, float* pGreen, float* pBlue) override
+		{
+			Dispatch::GetKernels().shadeCookTorrance(batch, { m_Albedo, m_Metalness, m_Roughness }, tier, pRed, pGreen, pBlue);
+		}
+
 	private:
 		ColorRGB m_Albedo{ 0.955f, 0.637f, 0.538f }; //Copper
 		float m_Metalness{ 1.0f };
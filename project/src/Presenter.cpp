@@ -0,0 +1,110 @@
+#include "Presenter.h"
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace dae
+{
+	Presenter::Presenter(SDL_Window* pWindow, uint32_t backBufferCount) :
+		m_pWindow{ pWindow },
+		m_pSurface{ SDL_GetWindowSurface(pWindow) }
+	{
+		backBufferCount = std::clamp(backBufferCount, 2u, 3u);
+		m_BackBuffers.resize(backBufferCount);
+		for (uint32_t bufferIdx{}; bufferIdx < backBufferCount; ++bufferIdx)
+		{
+			m_BackBuffers[bufferIdx].resize(m_pSurface->w * m_pSurface->h);
+			m_FreeBuffers.push_back(bufferIdx);
+		}
+
+		m_PresentThread = std::thread{ &Presenter::PresentLoop, this };
+	}
+
+	Presenter::~Presenter()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_FrameQueued.notify_one();
+		m_PresentThread.join();
+	}
+
+	uint32_t* Presenter::AcquireBuffer()
+	{
+		std::unique_lock lock{ m_Mutex };
+		if (m_FreeBuffers.empty() && m_LatencyPolicy == LatencyPolicy::Drop && !m_QueuedBuffers.empty())
+		{
+			m_FreeBuffers.push_back(m_QueuedBuffers.front());
+			m_QueuedBuffers.pop_front();
+			++m_Stats.droppedFrames;
+		}
+
+		//Queue waits here whenever the present thread is behind, Drop only while the one other buffer is being shown
+		m_BufferFreed.wait(lock, [this] { return !m_FreeBuffers.empty(); });
+		const uint32_t bufferIdx{ m_FreeBuffers.back() };
+		m_FreeBuffers.pop_back();
+		return m_BackBuffers[bufferIdx].data();
+	}
+
+	void Presenter::Submit(uint32_t* pPixels)
+	{
+		const auto it{ std::find_if(m_BackBuffers.begin(), m_BackBuffers.end(), [pPixels](const std::vector<uint32_t>& buffer) { return buffer.data() == pPixels; }) };
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_QueuedBuffers.push_back(static_cast<uint32_t>(it - m_BackBuffers.begin()));
+		}
+		m_FrameQueued.notify_one();
+	}
+
+	void Presenter::SetLatencyPolicy(LatencyPolicy policy)
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_LatencyPolicy = policy;
+	}
+
+	PresentStats Presenter::TakeStats()
+	{
+		std::lock_guard lock{ m_Mutex };
+		const PresentStats stats{ m_Stats };
+		m_Stats = {};
+		return stats;
+	}
+
+	void Presenter::PresentLoop()
+	{
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_FrameQueued.wait(lock, [this] { return m_IsStopping || !m_QueuedBuffers.empty(); });
+			if (m_IsStopping) return;
+
+			const uint32_t bufferIdx{ m_QueuedBuffers.front() };
+			m_QueuedBuffers.pop_front();
+			lock.unlock();
+
+			const auto startTime{ std::chrono::steady_clock::now() };
+
+			//the rows of the surface may be padded
+			const uint32_t* pPixels{ m_BackBuffers[bufferIdx].data() };
+			const size_t rowSize{ m_pSurface->w * sizeof(uint32_t) };
+			for (int y{}; y < m_pSurface->h; ++y)
+			{
+				std::memcpy(static_cast<uint8_t*>(m_pSurface->pixels) + y * m_pSurface->pitch, pPixels + y * m_pSurface->w, rowSize);
+			}
+			SDL_UpdateWindowSurface(m_pWindow);
+
+			const float presentTime{ std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+
+			lock.lock();
+			m_FreeBuffers.push_back(bufferIdx);
+			++m_Stats.presentedFrames;
+			m_Stats.presentTime += presentTime;
+			m_BufferFreed.notify_all();
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SDL_Window;
+struct SDL_Surface;
+
+namespace dae
+{
+	//What the present thread did since the last Presenter::TakeStats
+	struct PresentStats
+	{
+		uint32_t presentedFrames{};
+		uint32_t droppedFrames{}; //resolved but replaced by a newer frame before the present thread got to them
+		float presentTime{}; //milliseconds spent copying the presented frames to the window, all of them together
+	};
+
+	//Shows resolved frames on the window from its own thread, so the render threads never wait for the copy to the window.
+	//The frames are resolved into one of a few back buffers, which the present thread copies to the window surface in order.
+	class Presenter final
+	{
+	public:
+		//What AcquireBuffer does when the present thread is behind and every back buffer is taken
+		enum class LatencyPolicy
+		{
+			Queue, //waits for the present thread, every frame is shown at most backBufferCount - 1 frames late
+			Drop //takes over the oldest frame that wasn't shown yet, the renderer never waits
+		};
+
+		/**
+		 * \param backBufferCount 2 or 3, one is shown while another is resolved and the third can wait in line
+		 */
+		Presenter(SDL_Window* pWindow, uint32_t backBufferCount = 2);
+		~Presenter();
+
+		Presenter(const Presenter&) = delete;
+		Presenter(Presenter&&) noexcept = delete;
+		Presenter& operator=(const Presenter&) = delete;
+		Presenter& operator=(Presenter&&) noexcept = delete;
+
+		//a back buffer the size of the window surface to resolve the next frame into, see LatencyPolicy
+		uint32_t* AcquireBuffer();
+		//queues the buffer of the last AcquireBuffer for the present thread
+		void Submit(uint32_t* pPixels);
+
+		void SetLatencyPolicy(LatencyPolicy policy);
+		LatencyPolicy GetLatencyPolicy() const { return m_LatencyPolicy; }
+		uint32_t GetBackBufferCount() const { return static_cast<uint32_t>(m_BackBuffers.size()); }
+		//the stats since the previous call
+		PresentStats TakeStats();
+
+	private:
+		SDL_Window* m_pWindow{};
+		SDL_Surface* m_pSurface{};
+		LatencyPolicy m_LatencyPolicy{ LatencyPolicy::Queue };
+
+		std::vector<std::vector<uint32_t>> m_BackBuffers{};
+
+		std::thread m_PresentThread{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_FrameQueued{};
+		std::condition_variable m_BufferFreed{};
+
+		//indices into m_BackBuffers, every buffer is in exactly one of the lists or being resolved or shown
+		std::vector<uint32_t> m_FreeBuffers{};
+		std::deque<uint32_t> m_QueuedBuffers{};
+		bool m_IsStopping{};
+		PresentStats m_Stats{};
+
+		void PresentLoop();
+	};
+}
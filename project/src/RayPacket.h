@@ -0,0 +1,79 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#include "CpuDispatch.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Up to MaxSize coherent rays (an 8x8 pixel block) stored as structure of arrays, so one box test covers 4 (SSE), 8 (AVX2) or 16 (AVX-512) rays.
+	//Rays are addressed by lane, ray masks hold one bit per lane.
+	struct alignas(64) RayPacket
+	{
+		static constexpr uint32_t MaxSize{ 64 };
+
+		float originX[MaxSize]{};
+		float originY[MaxSize]{};
+		float originZ[MaxSize]{};
+		float directionX[MaxSize]{};
+		float directionY[MaxSize]{};
+		float directionZ[MaxSize]{};
+		float invDirectionX[MaxSize]{};
+		float invDirectionY[MaxSize]{};
+		float invDirectionZ[MaxSize]{};
+		float min[MaxSize]{};
+		float max[MaxSize]{}; //shrinks to the closest hit of every ray while tracing
+
+		uint32_t rayCount{};
+		bool isCoherent{ true }; //every ray points into the same octant as the first one
+
+		void Clear()
+		{
+			rayCount = 0;
+			isCoherent = true;
+		}
+
+		void AddRay(const Ray& ray)
+		{
+			const uint32_t lane{ rayCount++ };
+			originX[lane] = ray.origin.x;
+			originY[lane] = ray.origin.y;
+			originZ[lane] = ray.origin.z;
+			directionX[lane] = ray.direction.x;
+			directionY[lane] = ray.direction.y;
+			directionZ[lane] = ray.direction.z;
+			invDirectionX[lane] = 1.f / ray.direction.x;
+			invDirectionY[lane] = 1.f / ray.direction.y;
+			invDirectionZ[lane] = 1.f / ray.direction.z;
+			min[lane] = ray.min;
+			max[lane] = ray.max;
+
+			isCoherent = isCoherent &&
+				std::signbit(ray.direction.x) == std::signbit(directionX[0]) &&
+				std::signbit(ray.direction.y) == std::signbit(directionY[0]) &&
+				std::signbit(ray.direction.z) == std::signbit(directionZ[0]);
+		}
+
+		Ray GetRay(uint32_t lane) const
+		{
+			Ray ray{ { originX[lane], originY[lane], originZ[lane] }, { directionX[lane], directionY[lane], directionZ[lane] } };
+			ray.min = min[lane];
+			ray.max = max[lane];
+			return ray;
+		}
+
+		uint64_t GetRayMask() const { return rayCount == MaxSize ? ~uint64_t{} : (uint64_t{ 1 } << rayCount) - 1; }
+
+		/**
+		 * \brief Slab test of the rays in rayMask against one box, same logic as GeometryUtils::SlabTest_BVHNode
+		 * \return Mask of the rays that overlap the box within [min, max]
+		 */
+		uint64_t IntersectBox(const Vector3& boxMin, const Vector3& boxMax, uint64_t rayMask) const;
+	};
+
+	inline uint64_t RayPacket::IntersectBox(const Vector3& boxMin, const Vector3& boxMax, uint64_t rayMask) const
+	{
+		return Dispatch::GetKernels().intersectPacketBox(*this, boxMin, boxMax, rayMask);
+	}
+}
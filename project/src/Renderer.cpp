@@ -9,25 +9,66 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "RayPacket.h"
+#include "ShadingBatch.h"
 
-#include <execution>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 #define PARALLEL_EXECUTION
 
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window * pWindow) :
+Renderer::Renderer(SDL_Window * pWindow, uint32_t backBufferCount) :
 	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+	m_pBuffer(SDL_GetWindowSurface(pWindow)),
+	m_Presenter(pWindow, backBufferCount)
 {
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	m_PixelFormat = { pFormat->Rshift, pFormat->Gshift, pFormat->Bshift, pFormat->Rloss, pFormat->Gloss, pFormat->Bloss, pFormat->Amask };
+
+	for (HdrFrame& frame : m_HdrFrames)
+	{
+		frame.red.resize(m_Width * m_Height);
+		frame.green.resize(m_Width * m_Height);
+		frame.blue.resize(m_Width * m_Height);
+	}
+
+	UpdateTileOrder();
 }
 
-void Renderer::Render(Scene* pScene) const
+Renderer::~Renderer()
 {
-	Camera& camera = pScene->GetCamera();
+	EndTrace();
+	if (!m_FrameThread.joinable()) return;
+
+	{
+		std::lock_guard lock{ m_FrameMutex };
+		m_IsStopping = true;
+	}
+	m_TraceStarted.notify_one();
+	m_FrameThread.join();
+}
+
+void Renderer::Render(Scene* pScene)
+{
+	Trace(pScene);
+	Present();
+}
+
+void Renderer::Trace(Scene* pScene)
+{
+	TraceFrame(pScene);
+	SwapHdrFrames();
+}
+
+void Renderer::TraceFrame(Scene* pScene)
+{
+	//a copy, the caller may read the scene's camera while a pipelined trace is in flight
+	Camera camera{ pScene->GetCamera() };
 	const Matrix cameraToWorld = camera.CalculateCameraToWorld();
 
 	const float aspectRatio = m_Width / static_cast<float>(m_Height);
@@ -35,109 +76,318 @@ void Renderer::Render(Scene* pScene) const
 	const float fovAngle = camera.fovAngle * TO_RADIANS;
 	const float fov = tan( fovAngle / 2.f );
 
+	const uint32_t tileCount{ static_cast<uint32_t>(m_TileOrder.size()) };
+
 #if defined(PARALLEL_EXECUTION)
 	// Parallel logic
-	uint32_t amountOfPixels{ uint32_t(m_Width * m_Height)};
-	std::vector<uint32_t> pixelIndices{};
-
-	pixelIndices.reserve( amountOfPixels );
-	for (uint32_t index{}; index < amountOfPixels; ++index) pixelIndices.emplace_back(index);
-
-	std::for_each(std::execution::par, pixelIndices.begin(), pixelIndices.end(), [&](int i) {
-		RenderPixel(pScene, i, fov, aspectRatio, cameraToWorld, camera.origin);
+	//every thread starts on its own stretch of the curve and steals from the others once it is done
+	m_ThreadPool.ParallelFor(tileCount, [&](uint32_t orderIdx) {
+		RenderTile(pScene, m_TileOrder[orderIdx], fov, aspectRatio, cameraToWorld, camera.origin);
 		});
+	m_FrameThreadStats = m_ThreadPool.GetJobStats();
 
 #else
 	// Synchronous logic (no threading)
-	uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
-
-	for (uint32_t pixelIndex{}; pixelIndex < amountOfPixels; ++pixelIndex)
+	for (uint32_t tileIndex{}; tileIndex < tileCount; ++tileIndex)
 	{
-		RenderPixel(pScene, pixelIndex, fov, aspectRatio,cameraToWorld, camera.origin);
+		RenderTile(pScene, tileIndex, fov, aspectRatio, cameraToWorld, camera.origin);
 	}
 
 #endif
+}
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+void Renderer::SwapHdrFrames()
+{
+	m_ResolveFrameIdx = m_TraceFrameIdx;
+	m_TraceFrameIdx = 1 - m_TraceFrameIdx;
 }
 
-void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix &cameraToWorld, const Vector3 &cameraOrigin) const
+void Renderer::BeginTrace(Scene* pScene)
 {
-	auto& materials{ pScene->GetMaterials() };
-	auto& lights{ pScene->GetLights() };
-	const uint32_t px{ pixelIndex % m_Width }, py{ pixelIndex / m_Width };
+	EndTrace();
+	if (!m_FrameThread.joinable()) m_FrameThread = std::thread{ &Renderer::FrameLoop, this };
 
+	{
+		std::lock_guard lock{ m_FrameMutex };
+		m_pTraceScene = pScene;
+	}
+	m_IsTraceInFlight = true;
+	m_TraceStarted.notify_one();
+}
+
+void Renderer::EndTrace()
+{
+	if (!m_IsTraceInFlight) return;
+
+	std::unique_lock lock{ m_FrameMutex };
+	m_TraceFinished.wait(lock, [this] { return m_pTraceScene == nullptr; });
+	m_IsTraceInFlight = false;
+
+	//only now, Present may still have been resolving the previous frame while this one traced
+	SwapHdrFrames();
+}
+
+void Renderer::Present()
+{
+	//the present thread copies the frame to the window surface while the next one renders
+	uint32_t* pPixels{ m_Presenter.AcquireBuffer() };
+	Resolve(pPixels);
+
+	if (m_IsCaptureRequested || m_IsCapturingContinuously)
+	{
+		const HdrFrame& frame{ m_HdrFrames[m_ResolveFrameIdx] };
+		m_Exporter.Export(m_ExportFormat, { uint32_t(m_Width), uint32_t(m_Height), m_PixelFormat, pPixels, frame.red.data(), frame.green.data(), frame.blue.data() });
+		m_IsCaptureRequested = false;
+	}
+
+	m_Presenter.Submit(pPixels);
+}
+
+void Renderer::FrameLoop()
+{
+	std::unique_lock lock{ m_FrameMutex };
+	while (true)
+	{
+		m_TraceStarted.wait(lock, [this] { return m_IsStopping || m_pTraceScene; });
+		if (m_IsStopping) return;
+
+		lock.unlock();
+		TraceFrame(m_pTraceScene);
+		lock.lock();
+
+		m_pTraceScene = nullptr;
+		m_TraceFinished.notify_one();
+	}
+}
+
+void Renderer::RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	const uint32_t tilesPerRow{ (m_Width + m_TileSize - 1) / m_TileSize };
+	const uint32_t startX{ tileIndex % tilesPerRow * m_TileSize }, startY{ tileIndex / tilesPerRow * m_TileSize };
+	const uint32_t endX{ std::min(startX + m_TileSize, uint32_t(m_Width)) }, endY{ std::min(startY + m_TileSize, uint32_t(m_Height)) };
+
+	for (uint32_t blockY{ startY }; blockY < endY; blockY += BlockSize)
+	{
+		for (uint32_t blockX{ startX }; blockX < endX; blockX += BlockSize)
+		{
+			RenderBlock(pScene, blockX, blockY, fov, aspectRatio, cameraToWorld, cameraOrigin);
+		}
+	}
+}
+
+void Renderer::RenderBlock(Scene* pScene, uint32_t startX, uint32_t startY, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	const uint32_t blockWidth{ std::min(BlockSize, m_Width - startX) }, blockHeight{ std::min(BlockSize, m_Height - startY) };
+
+	//pixel (x, y) of the block is stored at x + y * blockWidth, so every row is contiguous
+	Ray viewRays[BlockPixelCount]{};
+	HitRecord closestHits[BlockPixelCount]{};
+
+	if (m_PacketSize == 1)
+	{
+		for (uint32_t y{}; y < blockHeight; ++y)
+		{
+			for (uint32_t x{}; x < blockWidth; ++x)
+			{
+				const uint32_t pixelIdx{ x + y * blockWidth };
+				viewRays[pixelIdx] = GetPrimaryRay(startX + x, startY + y, fov, aspectRatio, cameraToWorld, cameraOrigin);
+				pScene->GetClosestHit(viewRays[pixelIdx], closestHits[pixelIdx]);
+			}
+		}
+	}
+	else
+	{
+		//packetSize x packetSize squares of the block are traced as one packet each
+		RayPacket packet{};
+		HitRecord packetHits[RayPacket::MaxSize]{};
+		for (uint32_t packetY{}; packetY < blockHeight; packetY += m_PacketSize)
+		{
+			for (uint32_t packetX{}; packetX < blockWidth; packetX += m_PacketSize)
+			{
+				const uint32_t endX{ std::min(packetX + m_PacketSize, blockWidth) }, endY{ std::min(packetY + m_PacketSize, blockHeight) };
+
+				packet.Clear();
+				for (uint32_t y{ packetY }; y < endY; ++y)
+				{
+					for (uint32_t x{ packetX }; x < endX; ++x)
+					{
+						const uint32_t pixelIdx{ x + y * blockWidth };
+						viewRays[pixelIdx] = GetPrimaryRay(startX + x, startY + y, fov, aspectRatio, cameraToWorld, cameraOrigin);
+						packet.AddRay(viewRays[pixelIdx]);
+					}
+				}
+
+				std::fill_n(packetHits, packet.rayCount, HitRecord{});
+				pScene->GetClosestHits(packet, packetHits);
+
+				uint32_t lane{};
+				for (uint32_t y{ packetY }; y < endY; ++y)
+				{
+					for (uint32_t x{ packetX }; x < endX; ++x, ++lane) closestHits[x + y * blockWidth] = packetHits[lane];
+				}
+			}
+		}
+	}
+
+	ColorRGB colors[BlockPixelCount]{};
+	ShadeBlock(pScene, viewRays, closestHits, blockWidth * blockHeight, colors);
+
+	HdrFrame& frame{ m_HdrFrames[m_TraceFrameIdx] };
+	for (uint32_t y{}; y < blockHeight; ++y)
+	{
+		const uint32_t rowStart{ startX + ((startY + y) * m_Width) };
+		for (uint32_t x{}; x < blockWidth; ++x)
+		{
+			const ColorRGB& finalColor{ colors[x + y * blockWidth] };
+			frame.red[rowStart + x] = finalColor.r;
+			frame.green[rowStart + x] = finalColor.g;
+			frame.blue[rowStart + x] = finalColor.b;
+		}
+	}
+}
+
+void Renderer::Resolve(uint32_t* pPixels)
+{
+	//whole rows, so every register but the last of a row is full
+	constexpr uint32_t RowsPerTask{ 16 };
+	const uint32_t taskCount{ (m_Height + RowsPerTask - 1) / RowsPerTask };
+	const KernelTable& kernels{ Dispatch::GetKernels() };
+	const HdrFrame& frame{ m_HdrFrames[m_ResolveFrameIdx] };
+
+	const auto resolveRows{ [&](uint32_t taskIdx) {
+		const uint32_t startY{ taskIdx * RowsPerTask }, endY{ std::min(startY + RowsPerTask, uint32_t(m_Height)) };
+		for (uint32_t py{ startY }; py < endY; ++py)
+		{
+			const uint32_t rowStart{ py * m_Width };
+			kernels.resolvePixels(&frame.red[rowStart], &frame.green[rowStart], &frame.blue[rowStart], m_Width, m_ResolveSettings, m_PixelFormat, &pPixels[rowStart]);
+		}
+		} };
+
+#if defined(PARALLEL_EXECUTION)
+	//the pool takes one job at a time, while the next frame is tracing this thread resolves on its own
+	if (!m_IsTraceInFlight)
+	{
+		m_ThreadPool.ParallelFor(taskCount, resolveRows);
+		return;
+	}
+#endif
+	for (uint32_t taskIdx{}; taskIdx < taskCount; ++taskIdx) resolveRows(taskIdx);
+}
+
+Ray Renderer::GetPrimaryRay(uint32_t px, uint32_t py, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin) const
+{
 	float rx{ px + 0.5f }, ry{ py + 0.5f };
 	float cx{ (2 * (rx / float(m_Width)) - 1) * aspectRatio * fov };
 	float cy{ (1 - (2 * (ry / float(m_Height)))) * fov };
 
 	Vector3 rayDirection{ cx, cy, 1.0f };
 	rayDirection = cameraToWorld.TransformVector(rayDirection);
-	Ray viewRay{ cameraOrigin, rayDirection.Normalized() };
+	return Ray{ cameraOrigin, rayDirection.Normalized() };
+}
 
-	//Color to write to color buffer & hit verification
-	ColorRGB finalColor{};
-	HitRecord closestHit{};
+void Renderer::ShadeBlock(Scene* pScene, const Ray* viewRays, const HitRecord* closestHits, uint32_t pixelCount, ColorRGB* colors) const
+{
+	auto& materials{ pScene->GetMaterials() };
+	auto& lights{ pScene->GetLights() };
+	const MathTier mathTier{ m_RenderQuality == RenderQuality::Preview ? MathTier::Fast : MathTier::Exact };
 
-	//Rendering full scene
-	pScene->GetClosestHit(viewRay, closestHit);
+	//pixels the current light reaches, the BRDF modes shade them per material once all shadow rays are done
+	uint32_t samplePixels[BlockPixelCount];
+	Vector3 sampleLightDirections[BlockPixelCount];
+	float sampleObservedAreas[BlockPixelCount];
+	bool isSampleShaded[BlockPixelCount];
 
-	if (closestHit.didHit)
-	{
-		//finalColor should be initialized black
-		finalColor = {};
+	ShadingBatch batch{};
+	uint32_t batchSamples[ShadingBatch::MaxSize];
+	float brdfRed[ShadingBatch::MaxSize], brdfGreen[ShadingBatch::MaxSize], brdfBlue[ShadingBatch::MaxSize];
 
-		for (int lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+	for (const Light& light : lights)
+	{
+		uint32_t sampleCount{};
+		for (uint32_t pixelIdx{}; pixelIdx < pixelCount; ++pixelIdx)
 		{
-			Vector3 invLightDirection{ LightUtils::GetDirectionToLight(lights[lightIdx], closestHit.origin) };
-			float distanceToLight{ invLightDirection.Normalize() };
+			const HitRecord& closestHit{ closestHits[pixelIdx] };
+			if (!closestHit.didHit) continue;
 
-			Ray lightRay{ closestHit.origin + (invLightDirection * 0.01f), invLightDirection };
-			lightRay.max = distanceToLight;
+			Vector3 invLightDirection{ LightUtils::GetDirectionToLight(light, closestHit.origin) };
+			float distanceToLight{};
+			if (mathTier == MathTier::Fast)
+			{
+				const float sqrDistance{ invLightDirection.SqrMagnitude() };
+				const float invDistance{ FastMath::RSqrt(sqrDistance) };
+				invLightDirection *= invDistance;
+				distanceToLight = sqrDistance * invDistance;
+			}
+			else distanceToLight = invLightDirection.Normalize();
 
 			float observedAreaMeasure{ Vector3::Dot(closestHit.normal, invLightDirection) };
 			if (observedAreaMeasure <= 0.f) continue;
-			if (pScene->DoesHit(lightRay) && m_ShadowsEnabled) continue;
+
+			if (m_ShadowsEnabled)
+			{
+				Ray lightRay{ closestHit.origin + (invLightDirection * 0.01f), invLightDirection };
+				lightRay.max = distanceToLight;
+				if (pScene->DoesHit(lightRay)) continue;
+			}
 
 			switch (m_CurrentLightMode)
 			{
 			case dae::Renderer::LightMode::ObservedArea:
 				//Dot(normal, lightdirection)
-				finalColor += observedAreaMeasure * ColorRGB{ 1.f, 1.f, 1.f };
+				colors[pixelIdx] += observedAreaMeasure * ColorRGB{ 1.f, 1.f, 1.f };
 				break;
 			case dae::Renderer::LightMode::Radiance:
 				//Ergb
-				finalColor += LightUtils::GetRadiance(lights[lightIdx], closestHit.origin);
-				break;
-			case dae::Renderer::LightMode::BRDF:
-				//BRDFrgb
-				finalColor += materials[closestHit.materialIndex]->Shade(closestHit, invLightDirection, -viewRay.direction);
-				break;
-			case dae::Renderer::LightMode::Combined:
-				//Ergb * BRDFrgb * Dot(normal, lightdirection)
-				finalColor += LightUtils::GetRadiance(lights[lightIdx], closestHit.origin) *
-					materials[closestHit.materialIndex]->Shade(closestHit, invLightDirection, -viewRay.direction) * observedAreaMeasure;
+				colors[pixelIdx] += LightUtils::GetRadiance(light, closestHit.origin);
 				break;
 			default:
+				samplePixels[sampleCount] = pixelIdx;
+				sampleLightDirections[sampleCount] = invLightDirection;
+				sampleObservedAreas[sampleCount] = observedAreaMeasure;
+				isSampleShaded[sampleCount] = false;
+				++sampleCount;
 				break;
 			}
 		}
-	}
 
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+		//one batch per material among the samples, in the order the materials first show up
+		for (uint32_t firstSample{}; firstSample < sampleCount; ++firstSample)
+		{
+			if (isSampleShaded[firstSample]) continue;
+			const unsigned char materialIndex{ closestHits[samplePixels[firstSample]].materialIndex };
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
-}
+			batch.Clear();
+			for (uint32_t sampleIdx{ firstSample }; sampleIdx < sampleCount; ++sampleIdx)
+			{
+				const HitRecord& closestHit{ closestHits[samplePixels[sampleIdx]] };
+				if (isSampleShaded[sampleIdx] || closestHit.materialIndex != materialIndex) continue;
 
-bool Renderer::SaveBufferToImage() const
-{
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+				isSampleShaded[sampleIdx] = true;
+				batchSamples[batch.count] = sampleIdx;
+				batch.AddSample(closestHit.normal, sampleLightDirections[sampleIdx], -viewRays[samplePixels[sampleIdx]].direction);
+			}
+
+			materials[materialIndex]->ShadeBatch(batch, mathTier, brdfRed, brdfGreen, brdfBlue);
+
+			for (uint32_t lane{}; lane < batch.count; ++lane)
+			{
+				const uint32_t sampleIdx{ batchSamples[lane] };
+				const uint32_t pixelIdx{ samplePixels[sampleIdx] };
+				const ColorRGB brdf{ brdfRed[lane], brdfGreen[lane], brdfBlue[lane] };
+
+				if (m_CurrentLightMode == LightMode::BRDF)
+				{
+					//BRDFrgb
+					colors[pixelIdx] += brdf;
+				}
+				else
+				{
+					//Ergb * BRDFrgb * Dot(normal, lightdirection)
+					colors[pixelIdx] += LightUtils::GetRadiance(light, closestHits[pixelIdx].origin) * brdf * sampleObservedAreas[sampleIdx];
+				}
+			}
+		}
+	}
 }
 
 void Renderer::ToggleShadows()
@@ -149,4 +399,104 @@ void dae::Renderer::CycleLightingMode()
 {
 	int lightState{ int(m_CurrentLightMode) };
 	m_CurrentLightMode = LightMode((lightState + 1) % 4);
-}
\ No newline at end of file
+}
+
+void Renderer::ToggleRenderQuality()
+{
+	m_RenderQuality = m_RenderQuality == RenderQuality::Final ? RenderQuality::Preview : RenderQuality::Final;
+}
+
+void Renderer::SetTileSize(uint32_t tileSize)
+{
+	//whole blocks, so only the tiles on the screen edge have cut off blocks
+	m_TileSize = std::max((tileSize + BlockSize - 1) / BlockSize, 1u) * BlockSize;
+	UpdateTileOrder();
+}
+
+void Renderer::CycleLatencyPolicy()
+{
+	const bool isQueue{ m_Presenter.GetLatencyPolicy() == Presenter::LatencyPolicy::Queue };
+	m_Presenter.SetLatencyPolicy(isQueue ? Presenter::LatencyPolicy::Drop : Presenter::LatencyPolicy::Queue);
+}
+
+void Renderer::CycleExportFormat()
+{
+	m_ExportFormat = ImageFormat((int(m_ExportFormat) + 1) % int(ImageFormat::count));
+}
+
+void Renderer::CycleToneMapping()
+{
+	const int toneMapping{ int(m_ResolveSettings.toneMapping) };
+	m_ResolveSettings.toneMapping = ToneMapping((toneMapping + 1) % int(ToneMapping::count));
+}
+
+void Renderer::CyclePacketSize()
+{
+	//1 -> 2 -> 4 -> 8 -> 1, an 8x8 block fills a whole packet
+	m_PacketSize = m_PacketSize * 2 > 8 ? 1 : m_PacketSize * 2;
+}
+
+float Renderer::MeasurePrimaryRays(Scene* pScene, uint32_t packetSize)
+{
+	Camera& camera = pScene->GetCamera();
+	const Matrix cameraToWorld = camera.CalculateCameraToWorld();
+
+	const float aspectRatio = m_Width / static_cast<float>(m_Height);
+	const float fov = tan( camera.fovAngle * TO_RADIANS / 2.f );
+
+	const uint32_t blocksPerRow{ (m_Width + packetSize - 1) / packetSize };
+
+	const auto startTime{ std::chrono::high_resolution_clock::now() };
+
+	//packetSize x packetSize blocks traced as one packet each, a 1x1 block is a single ray
+	m_ThreadPool.ParallelFor(GetBlockCount(packetSize), [&](uint32_t blockIndex) {
+		const uint32_t startX{ blockIndex % blocksPerRow * packetSize }, startY{ blockIndex / blocksPerRow * packetSize };
+		const uint32_t endX{ std::min(startX + packetSize, uint32_t(m_Width)) }, endY{ std::min(startY + packetSize, uint32_t(m_Height)) };
+
+		if (packetSize == 1)
+		{
+			HitRecord closestHit{};
+			pScene->GetClosestHit(GetPrimaryRay(startX, startY, fov, aspectRatio, cameraToWorld, camera.origin), closestHit);
+			return;
+		}
+
+		RayPacket packet{};
+		for (uint32_t py{ startY }; py < endY; ++py)
+		{
+			for (uint32_t px{ startX }; px < endX; ++px)
+			{
+				packet.AddRay(GetPrimaryRay(px, py, fov, aspectRatio, cameraToWorld, camera.origin));
+			}
+		}
+
+		HitRecord closestHits[RayPacket::MaxSize]{};
+		pScene->GetClosestHits(packet, closestHits);
+		});
+
+	const float seconds{ std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count() };
+	return m_Width * m_Height / seconds * 1e-6f;
+}
+
+uint32_t Renderer::GetBlockCount(uint32_t packetSize) const
+{
+	return ((m_Width + packetSize - 1) / packetSize) * ((m_Height + packetSize - 1) / packetSize);
+}
+void Renderer::UpdateTileOrder()
+{
+	const uint32_t tilesPerRow{ (m_Width + m_TileSize - 1) / m_TileSize };
+
+	//interleaves the bits of the tile coordinates, x in the even bits and y in the odd ones
+	const auto getMortonCode{ [tilesPerRow](uint32_t tileIndex) {
+		const uint32_t tileX{ tileIndex % tilesPerRow }, tileY{ tileIndex / tilesPerRow };
+		uint64_t code{};
+		for (uint32_t bit{}; bit < 32; ++bit)
+		{
+			code |= uint64_t((tileX >> bit) & 1) << (2 * bit) | uint64_t((tileY >> bit) & 1) << (2 * bit + 1);
+		}
+		return code;
+		} };
+
+	m_TileOrder.resize(GetBlockCount(m_TileSize));
+	std::iota(m_TileOrder.begin(), m_TileOrder.end(), 0u);
+	std::sort(m_TileOrder.begin(), m_TileOrder.end(), [&](uint32_t left, uint32_t right) { return getMortonCode(left) < getMortonCode(right); });
+}
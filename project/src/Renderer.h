@@ -1,7 +1,16 @@
 #pragma once
 #include "Maths.h"
+#include "CpuDispatch.h"
+#include "DataTypes.h"
+#include "ImageExporter.h"
+#include "Presenter.h"
+#include "ThreadPool.h"
 
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -13,20 +22,83 @@ namespace dae
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		//Final shades with the exact std math, Preview with the FastMath approximations
+		enum class RenderQuality
+		{
+			Final,
+			Preview
+		};
+
+		/**
+		 * \param backBufferCount Frames that can be resolved ahead of the window, 2 or 3, see Presenter
+		 */
+		Renderer(SDL_Window* pWindow, uint32_t backBufferCount = 2);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix &cameraToWorld, const Vector3 &cameraOrigin) const;
-		bool SaveBufferToImage() const;
+		//traces and shades the frame into the float buffer, then presents it
+		void Render(Scene* pScene);
+		//traces and shades the frame into the back float buffer, which becomes the one Present shows
+		void Trace(Scene* pScene);
+		/**
+		 * \brief Starts Trace on the renderer's frame thread and returns right away, for pipelining the frames.
+		 * Until EndTrace returns the scene must not change, and neither may the renderer except through Present.
+		 */
+		void BeginTrace(Scene* pScene);
+		//waits for the frame BeginTrace started, does nothing if none is in flight
+		void EndTrace();
+		//resolves the last traced frame into a back buffer and hands it to the present thread, may overlap the trace of the next frame
+		void Present();
+		/**
+		 * \brief Renders one tile of the frame into the float buffer, one BlockSize x BlockSize block after the other
+		 * \param tileIndex Row major index of the tile, tiles on the right and bottom edge are cut off by the screen
+		 */
+		void RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
+		//the next Present exports its frame in the export format, see ImageExporter
+		void CaptureFrame() { m_IsCaptureRequested = true; }
+		//exports every presented frame until toggled off
+		void ToggleContinuousCapture() { m_IsCapturingContinuously = !m_IsCapturingContinuously; }
+		bool IsCapturingContinuously() const { return m_IsCapturingContinuously; }
+		//BMP, then PNG and PFM
+		void CycleExportFormat();
+		ImageFormat GetExportFormat() const { return m_ExportFormat; }
+		//files the export thread wrote and captures it had to skip since the previous call
+		ExportStats TakeExportStats() { return m_Exporter.TakeStats(); }
 
 		void CycleLightingMode();
 		void ToggleShadows();
+		//single rays, then 2x2, 4x4 and 8x8 packets within every tile
+		void CyclePacketSize();
+		uint32_t GetPacketSize() const { return m_PacketSize; }
+		//side of the square tiles the threads render, rounded up to whole blocks
+		void SetTileSize(uint32_t tileSize);
+		uint32_t GetTileSize() const { return m_TileSize; }
+		uint32_t GetThreadCount() const { return m_ThreadPool.GetThreadCount(); }
+		//busy and idle time of every render thread while it rendered the tiles of the last frame
+		const std::vector<ThreadStats>& GetFrameThreadStats() const { return m_FrameThreadStats; }
+		//Queue, then Drop
+		void CycleLatencyPolicy();
+		Presenter::LatencyPolicy GetLatencyPolicy() const { return m_Presenter.GetLatencyPolicy(); }
+		uint32_t GetBackBufferCount() const { return m_Presenter.GetBackBufferCount(); }
+		//time the present thread spent on the window and the frames it showed or dropped since the previous call
+		PresentStats TakePresentStats() { return m_Presenter.TakeStats(); }
+		void ToggleRenderQuality();
+		RenderQuality GetRenderQuality() const { return m_RenderQuality; }
+		//MaxToOne, then Reinhard and ACES
+		void CycleToneMapping();
+		const ResolveSettings& GetResolveSettings() const { return m_ResolveSettings; }
+		void SetResolveSettings(const ResolveSettings& settings) { m_ResolveSettings = settings; }
+
+		/**
+		 * \brief Traces the primary rays of one frame without shading
+		 * \param packetSize Side of the pixel blocks traced together, 1 traces single rays
+		 * \return Primary ray throughput in millions of rays per second
+		 */
+		float MeasurePrimaryRays(Scene* pScene, uint32_t packetSize);
 
 	private:
 		enum class LightMode
@@ -37,15 +109,75 @@ namespace dae
 			Combined //ObservedArea*Radiance*BRDF
 		};
 
+		//an 8x8 block fills a whole packet and a whole ShadingBatch
+		static constexpr uint32_t BlockSize{ 8 };
+		static constexpr uint32_t BlockPixelCount{ BlockSize * BlockSize };
+
 		LightMode m_CurrentLightMode{ LightMode::Combined };
 		bool m_ShadowsEnabled{ true };
+		uint32_t m_PacketSize{ 1 };
+		uint32_t m_TileSize{ 32 };
+		RenderQuality m_RenderQuality{ RenderQuality::Final };
 
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pBuffer{};
-		uint32_t* m_pBufferPixels{};
+		PixelFormat m_PixelFormat{};
+		//copies the resolved frames to the window on its own thread
+		Presenter m_Presenter;
+		//writes the captured frames to disk on its own thread
+		ImageExporter m_Exporter{};
+		ImageFormat m_ExportFormat{ ImageFormat::Png };
+		bool m_IsCaptureRequested{};
+		bool m_IsCapturingContinuously{};
+
+		//linear colors of a frame, one plane per channel so the resolve loads whole registers
+		struct HdrFrame
+		{
+			std::vector<float> red{};
+			std::vector<float> green{};
+			std::vector<float> blue{};
+		};
+		//the frame being traced and the last traced one, so the resolve of one frame can overlap the trace of the next
+		HdrFrame m_HdrFrames[2]{};
+		uint32_t m_TraceFrameIdx{};
+		uint32_t m_ResolveFrameIdx{ 1 };
+		ResolveSettings m_ResolveSettings{};
+
+		//renders the tiles, lives as long as the renderer so no frame pays for starting threads
+		ThreadPool m_ThreadPool{};
+		//row major tile indices along a Morton curve, so the consecutive tiles a thread renders share BVH nodes and cache lines
+		std::vector<uint32_t> m_TileOrder{};
+		std::vector<ThreadStats> m_FrameThreadStats{};
+
+		//runs the traces BeginTrace hands it, started by the first one
+		std::thread m_FrameThread{};
+		std::mutex m_FrameMutex{};
+		std::condition_variable m_TraceStarted{};
+		std::condition_variable m_TraceFinished{};
+		Scene* m_pTraceScene{}; //the scene of the trace in flight, cleared by the frame thread once it is done
+		bool m_IsStopping{};
+		bool m_IsTraceInFlight{}; //only touched by the thread calling BeginTrace and EndTrace
 
 		int m_Width{};
 		int m_Height{};
+
+		//exposure, tone mapping, gamma and quantization of the last traced frame into pPixels, see ResolveSettings
+		void Resolve(uint32_t* pPixels);
+		Ray GetPrimaryRay(uint32_t px, uint32_t py, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin) const;
+		//traces the primary rays of one block, shades them and writes the colors into the float buffer
+		void RenderBlock(Scene* pScene, uint32_t startX, uint32_t startY, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
+		/**
+		 * \brief Adds the light of every light of the scene to the pixels of one block
+		 * \param viewRays, closestHits Primary ray and its hit of every pixel
+		 * \param colors Receives the color of every pixel, initialized black by the caller
+		 */
+		void ShadeBlock(Scene* pScene, const Ray* viewRays, const HitRecord* closestHits, uint32_t pixelCount, ColorRGB* colors) const;
+		uint32_t GetBlockCount(uint32_t packetSize) const;
+		void UpdateTileOrder();
+		//Trace without making the frame the one Present shows
+		void TraceFrame(Scene* pScene);
+		void SwapHdrFrames();
+		void FrameLoop();
 	};
 }
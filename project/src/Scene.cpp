@@ -12,6 +12,7 @@ namespace dae {
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
 		m_TriangleMeshGeometries.reserve(32);
+		m_MeshInstances.reserve(32);
 		m_Lights.reserve(32);
 	}
 
@@ -32,15 +33,7 @@ namespace dae {
 		HitRecord tempHitRecord{};
 		closestHit.t = ray.max;
 
-		for (int sphereIdx{}; sphereIdx < m_SphereGeometries.size(); ++sphereIdx )
-		{
-			GeometryUtils::HitTest_Sphere(m_SphereGeometries[sphereIdx], ray, tempHitRecord);
-			if (tempHitRecord.t < closestHit.t && tempHitRecord.didHit)
-			{
-				closestHit = tempHitRecord;
-			}
-		}
-
+		//unbounded planes are not part of the hierarchy
 		for (int planeIdx{}; planeIdx < m_PlaneGeometries.size(); ++planeIdx)
 		{
 			GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIdx], ray, tempHitRecord);
@@ -50,34 +43,91 @@ namespace dae {
 			}
 		}
 
-		for (int triangleIdx{}; triangleIdx < m_TriangleMeshGeometries.size(); ++triangleIdx)
+		//bounded geometry through the top-level structure, nothing behind the closest plane needs testing
+		if (m_pAccelerator) m_pAccelerator->IntersectClosest(ray, closestHit);
+	}
+
+	void Scene::GetClosestHits(RayPacket& packet, HitRecord* hitRecords) const
+	{
+		for (uint32_t lane{}; lane < packet.rayCount; ++lane)
 		{
-			GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[triangleIdx], ray, tempHitRecord);
-			if (tempHitRecord.t < closestHit.t && tempHitRecord.didHit)
+			const Ray ray{ packet.GetRay(lane) };
+			hitRecords[lane] = HitRecord{};
+			hitRecords[lane].t = ray.max;
+
+			for (const Plane& plane : m_PlaneGeometries)
 			{
-				closestHit = tempHitRecord;
+				HitRecord planeHit{};
+				if (GeometryUtils::HitTest_Plane(plane, ray, planeHit) && planeHit.t < hitRecords[lane].t) hitRecords[lane] = planeHit;
 			}
 		}
+
+		if (m_pAccelerator) m_pAccelerator->IntersectClosestPacket(packet, hitRecords);
 	}
 
 	bool Scene::DoesHit(const Ray& ray) const
 	{
 		//done in week 2
-		for (int sphereIdx{}; sphereIdx < m_SphereGeometries.size(); ++sphereIdx)
+		for (int planeIdx{}; planeIdx < m_PlaneGeometries.size(); ++planeIdx)
 		{
-			if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[sphereIdx], ray)) return true;
+			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIdx], ray)) return true;
 		}
 
-		for (int planeIdx{}; planeIdx < m_PlaneGeometries.size(); ++planeIdx)
+		return m_pAccelerator && m_pAccelerator->IntersectAny(ray);
+	}
+
+	void Scene::SetAccelerator(AcceleratorType type)
+	{
+		m_AcceleratorType = type;
+		if (m_pAccelerator) BuildAccelerationStructure();
+	}
+
+	AcceleratorStats Scene::GetAcceleratorStats() const
+	{
+		if (!m_pAccelerator) return { Accelerator::GetName(m_AcceleratorType) };
+		return m_pAccelerator->GetStats();
+	}
+
+	void Scene::BuildAccelerationStructure()
+	{
+		m_pAccelerator = Accelerator::Create(m_AcceleratorType);
+		m_pAccelerator->Build({ &m_SphereGeometries, &m_TriangleMeshGeometries, &m_MeshInstances });
+	}
+
+	void Scene::RefitAccelerationStructure()
+	{
+		if (m_pAccelerator) m_pAccelerator->Refit();
+	}
+
+	void Scene::SyncDynamicState(const Scene& source)
+	{
+		m_Camera = source.m_Camera;
+		m_Lights = source.m_Lights;
+		m_SphereGeometries = source.m_SphereGeometries;
+
+		for (size_t meshIdx{}; meshIdx < m_TriangleMeshGeometries.size(); ++meshIdx)
 		{
-			if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIdx], ray)) return true;
+			m_TriangleMeshGeometries[meshIdx].CopyTransformedState(source.m_TriangleMeshGeometries[meshIdx]);
+		}
+
+		//the instances keep pointing at this scene's own copy of their mesh
+		for (size_t instanceIdx{}; instanceIdx < m_MeshInstances.size(); ++instanceIdx)
+		{
+			const MeshInstance& sourceInstance{ source.m_MeshInstances[instanceIdx] };
+			m_MeshInstances[instanceIdx].transform = sourceInstance.transform;
+			m_MeshInstances[instanceIdx].inverseTransform = sourceInstance.inverseTransform;
+			m_MeshInstances[instanceIdx].transformedMinAABB = sourceInstance.transformedMinAABB;
+			m_MeshInstances[instanceIdx].transformedMaxAABB = sourceInstance.transformedMaxAABB;
 		}
 
-		for (int triangleIdx{}; triangleIdx < m_TriangleMeshGeometries.size(); ++triangleIdx)
+		//source already refitted its top-level structure over the same geometry, so it is copied instead of refitted again
+		if (!source.m_pAccelerator) m_pAccelerator.reset();
+		else
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[triangleIdx], ray)) return true;
+			if (!m_pAccelerator || m_AcceleratorType != source.m_AcceleratorType) m_pAccelerator = Accelerator::Create(source.m_AcceleratorType);
+			m_pAccelerator->CopyFrom(*source.m_pAccelerator, { &m_SphereGeometries, &m_TriangleMeshGeometries, &m_MeshInstances });
 		}
-		return false;
+		m_AcceleratorType = source.m_AcceleratorType;
 	}
 
 #pragma region Scene Helpers
@@ -113,6 +163,12 @@ namespace dae {
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	MeshInstance* Scene::AddMeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, const Matrix& transform, unsigned char materialIndex)
+	{
+		m_MeshInstances.emplace_back(pMesh, transform, materialIndex);
+		return &m_MeshInstances.back();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -317,16 +373,19 @@ namespace dae {
 
 		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
 		m_Meshes[0]->AppendTriangle(baseTriangle, true);
+		m_Meshes[0]->UpdateAABB();
 		m_Meshes[0]->Translate({ -1.75f, 4.5f, 0.f });
 		m_Meshes[0]->UpdateTransforms();
 
 		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_Meshes[1]->AppendTriangle(baseTriangle, true);
+		m_Meshes[1]->UpdateAABB();
 		m_Meshes[1]->Translate({ 0.f, 4.5f, 0.f });
 		m_Meshes[1]->UpdateTransforms();
 
 		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
 		m_Meshes[2]->AppendTriangle(baseTriangle, true);
+		m_Meshes[2]->UpdateAABB();
 		m_Meshes[2]->Translate({ 1.75f, 4.5f, 0.f });
 		m_Meshes[2]->UpdateTransforms();
 
@@ -349,6 +408,8 @@ namespace dae {
 			m->UpdateAABB();
 			m->UpdateTransforms();
 		}
+
+		RefitAccelerationStructure();
 	}
 #pragma endregion
 
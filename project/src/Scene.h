@@ -1,9 +1,11 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "Maths.h"
 #include "DataTypes.h"
+#include "Accelerator.h"
 #include "Camera.h"
 
 namespace dae
@@ -36,6 +38,24 @@ namespace dae
 		Camera& GetCamera() { return m_Camera; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
+		//GetClosestHit for every ray in the packet, hitRecords holds one record per lane
+		void GetClosestHits(RayPacket& packet, HitRecord* hitRecords) const;
+
+		//structure used for the bounded geometry, rebuilds right away when the scene was already built
+		void SetAccelerator(AcceleratorType type);
+		AcceleratorType GetAccelerator() const { return m_AcceleratorType; }
+		AcceleratorStats GetAcceleratorStats() const;
+
+		//(re)builds the top-level hierarchy, call after adding spheres and meshes
+		void BuildAccelerationStructure();
+		//refits the top-level hierarchy to moved spheres and meshes, rebuilds only when it degraded too much
+		void RefitAccelerationStructure();
+		/**
+		 * \brief Makes this scene a snapshot of source for one frame: camera, lights, moved geometry and the updated mesh
+		 * hierarchies are copied over, and so is the top-level structure source refitted or rebuilt during its update.
+		 * Both scenes have to be the same type and initialized the same way, the static geometry and materials are not copied.
+		 */
+		void SyncDynamicState(const Scene& source);
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
@@ -48,14 +68,20 @@ namespace dae
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		std::vector<MeshInstance> m_MeshInstances{};
 		std::vector<Light> m_Lights{};
 		std::vector<Material*> m_Materials{};
 
+		//top-level structure over the bounded geometry (spheres, then meshes, then instances), planes are tested separately
+		std::unique_ptr<Accelerator> m_pAccelerator{};
+		AcceleratorType m_AcceleratorType{ AcceleratorType::BVH };
+
 		Camera m_Camera{};
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		MeshInstance* AddMeshInstance(const std::shared_ptr<const TriangleMesh>& pMesh, const Matrix& transform, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+#include "Maths.h"
+
+namespace dae
+{
+	//Up to MaxSize hit points lit by one light and sharing one material, stored as structure of arrays so the
+	//BRDF is evaluated for 4 (SSE), 8 (AVX2) or 16 (AVX-512) hit points at once.
+	//Lanes past count keep old values, the kernels shade whole registers and the caller ignores them.
+	struct alignas(64) ShadingBatch
+	{
+		static constexpr uint32_t MaxSize{ 64 };
+
+		float normalX[MaxSize]{};
+		float normalY[MaxSize]{};
+		float normalZ[MaxSize]{};
+		float lightX[MaxSize]{}; //l, normalized direction from the hit point to the light
+		float lightY[MaxSize]{};
+		float lightZ[MaxSize]{};
+		float viewX[MaxSize]{}; //v, normalized direction from the hit point to the viewer
+		float viewY[MaxSize]{};
+		float viewZ[MaxSize]{};
+
+		uint32_t count{};
+
+		void Clear()
+		{
+			count = 0;
+		}
+
+		void AddSample(const Vector3& normal, const Vector3& l, const Vector3& v)
+		{
+			const uint32_t lane{ count++ };
+			normalX[lane] = normal.x;
+			normalY[lane] = normal.y;
+			normalZ[lane] = normal.z;
+			lightX[lane] = l.x;
+			lightY[lane] = l.y;
+			lightZ[lane] = l.z;
+			viewX[lane] = v.x;
+			viewY[lane] = v.y;
+			viewZ[lane] = v.z;
+		}
+	};
+
+	//material parameters the batched BRDF kernels need, see Material_LambertPhong and Material_CookTorrence
+	struct LambertPhongParameters
+	{
+		ColorRGB diffuseColor{};
+		float diffuseReflectance{}; //kd
+		float specularReflectance{}; //ks
+		float phongExponent{};
+	};
+
+	struct CookTorranceParameters
+	{
+		ColorRGB albedo{};
+		float metalness{};
+		float roughness{};
+	};
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+//Every instruction set the translation unit is compiled for gets its own namespace. The dispatched kernels are compiled
+//once per ISA (SimdKernels_*.cpp), and in an unoptimized build every inline function they call is emitted as a weak
+//symbol in each of those objects. The linker keeps one copy, which could be an AVX copy called from the SSE kernels.
+//So every function the kernels call lives in this namespace, the lanes, the kernels and FastMath, and the kernels call
+//no std or math type functions.
+#if defined(__AVX512F__)
+#define SIMD_ISA_NAMESPACE Avx512
+#elif defined(__AVX2__)
+#define SIMD_ISA_NAMESPACE Avx2
+#elif defined(__AVX__)
+#define SIMD_ISA_NAMESPACE Avx
+#else
+#define SIMD_ISA_NAMESPACE Sse
+#endif
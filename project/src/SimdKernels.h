@@ -0,0 +1,602 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "CpuDispatch.h"
+#include "DataTypes.h"
+#include "FastMath.h"
+#include "RayPacket.h"
+#include "ShadingBatch.h"
+#include "SimdLanes.h"
+#include "TriangleBlock.h"
+
+namespace dae
+{
+	//Kernel templates behind the dispatch table. Only the SimdKernels_*.cpp files include this header, each instantiates the
+	//kernels with the lanes of its instruction set. They live in the ISA namespace of SimdLanes.h, so every copy stays separate.
+	namespace SimdKernels
+	{
+	inline namespace SIMD_ISA_NAMESPACE
+	{
+#pragma region Scalar
+		//stand-ins for std::min, std::max, std::clamp and std::countr_zero, see SimdIsa.h
+		template<typename T>
+		T Min(T a, T b) { return b < a ? b : a; }
+		template<typename T>
+		T Max(T a, T b) { return a < b ? b : a; }
+		inline float Clamp(float value, float low, float high) { return value < low ? low : (high < value ? high : value); }
+
+		//index of the lowest set bit, mask must not be 0
+		inline uint32_t CountTrailingZeros(uint32_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index{};
+			_BitScanForward(&index, mask);
+			return index;
+#else
+			return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+		}
+#pragma endregion
+
+#pragma region Spheres
+		/**
+		 * \brief Sphere test of Lanes::Count slots starting at firstSlot, same math as GeometryUtils::HitTest_Sphere
+		 * \param distances Receives the hit distance of every lane
+		 * \return Bitmask of the lanes hit within [tMin, tMax]
+		 */
+		template<typename Lanes>
+		inline int IntersectSphereLanes(const SphereSlots& spheres, uint32_t firstSlot, const Ray& ray, float tMin, float tMax, float* distances)
+		{
+			using Type = typename Lanes::Type;
+
+			const Type dirX{ Lanes::Set(ray.direction.x) }, dirY{ Lanes::Set(ray.direction.y) }, dirZ{ Lanes::Set(ray.direction.z) };
+
+			//L = origin - center
+			const Type lX{ Lanes::Sub(Lanes::Set(ray.origin.x), Lanes::LoadUnaligned(spheres.pX + firstSlot)) };
+			const Type lY{ Lanes::Sub(Lanes::Set(ray.origin.y), Lanes::LoadUnaligned(spheres.pY + firstSlot)) };
+			const Type lZ{ Lanes::Sub(Lanes::Set(ray.origin.z), Lanes::LoadUnaligned(spheres.pZ + firstSlot)) };
+			const Type b{ Lanes::Add(Lanes::Add(Lanes::Mul(dirX, lX), Lanes::Mul(dirY, lY)), Lanes::Mul(dirZ, lZ)) };
+
+			//r^2 - |L - B*d|^2
+			const Type offsetX{ Lanes::Sub(lX, Lanes::Mul(b, dirX)) };
+			const Type offsetY{ Lanes::Sub(lY, Lanes::Mul(b, dirY)) };
+			const Type offsetZ{ Lanes::Sub(lZ, Lanes::Mul(b, dirZ)) };
+			const Type discriminant{ Lanes::Sub(Lanes::LoadUnaligned(spheres.pRadiusSquared + firstSlot),
+				Lanes::Add(Lanes::Add(Lanes::Mul(offsetX, offsetX), Lanes::Mul(offsetY, offsetY)), Lanes::Mul(offsetZ, offsetZ))) };
+
+			Type valid{ Lanes::GreaterEqual(discriminant, Lanes::Set(0.f)) };
+			if (Lanes::MoveMask(valid) == 0) return 0;
+
+			//nearest root in front of ray.min, the far one when the origin is inside the sphere
+			const Type sqrtDiscriminant{ Lanes::Sqrt(Lanes::Abs(discriminant)) };
+			const Type minusB{ Lanes::Sub(Lanes::Set(0.f), b) };
+			const Type nearT{ Lanes::Sub(minusB, sqrtDiscriminant) };
+			const Type farT{ Lanes::Add(minusB, sqrtDiscriminant) };
+			const Type t{ Lanes::Select(Lanes::GreaterEqual(nearT, Lanes::Set(tMin)), nearT, farT) };
+
+			valid = Lanes::And(valid, Lanes::And(Lanes::GreaterEqual(t, Lanes::Set(tMin)), Lanes::LessEqual(t, Lanes::Set(tMax))));
+
+			Lanes::Store(distances, t);
+			return Lanes::MoveMask(valid);
+		}
+
+		template<typename Lanes>
+		bool IntersectSpheres(const SphereSlots& spheres, uint32_t firstSlot, uint32_t slotCount, const Ray& ray, float& t, uint32_t& slot)
+		{
+			float tMax{ ray.max };
+			bool didHit{};
+
+			alignas(64) float distances[Lanes::Count];
+			for (uint32_t laneStart{ firstSlot }; laneStart < firstSlot + slotCount; laneStart += Lanes::Count)
+			{
+				//lanes past the range belong to other leaves or cells
+				const uint32_t laneCount{ Min(firstSlot + slotCount - laneStart, static_cast<uint32_t>(Lanes::Count)) };
+				uint32_t hitMask{ static_cast<uint32_t>(IntersectSphereLanes<Lanes>(spheres, laneStart, ray, ray.min, tMax, distances)) };
+				hitMask &= (1u << laneCount) - 1;
+
+				while (hitMask)
+				{
+					const uint32_t lane{ CountTrailingZeros(hitMask) };
+					hitMask &= hitMask - 1;
+
+					if (distances[lane] <= tMax)
+					{
+						tMax = distances[lane];
+						slot = laneStart + lane;
+						didHit = true;
+					}
+				}
+			}
+
+			if (didHit) t = tMax;
+			return didHit;
+		}
+
+		template<typename Lanes>
+		bool OccludedSpheres(const SphereSlots& spheres, uint32_t firstSlot, uint32_t slotCount, const Ray& ray)
+		{
+			alignas(64) float distances[Lanes::Count];
+			for (uint32_t laneStart{ firstSlot }; laneStart < firstSlot + slotCount; laneStart += Lanes::Count)
+			{
+				const uint32_t laneCount{ Min(firstSlot + slotCount - laneStart, static_cast<uint32_t>(Lanes::Count)) };
+				const uint32_t hitMask{ static_cast<uint32_t>(IntersectSphereLanes<Lanes>(spheres, laneStart, ray, ray.min, ray.max, distances)) };
+				if (hitMask & ((1u << laneCount) - 1)) return true;
+			}
+			return false;
+		}
+#pragma endregion
+
+#pragma region Triangles
+		//lanes [offset, offset + lane count) of the block, same operation order as GeometryUtils::Intersect_TriangleRecord
+		template<typename Lanes, int Width>
+		inline int IntersectTriangleLanes(const TriangleBlock<Width>& block, int offset, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances)
+		{
+			using Type = typename Lanes::Type;
+
+			const Type dirX{ Lanes::Set(direction.x) }, dirY{ Lanes::Set(direction.y) }, dirZ{ Lanes::Set(direction.z) };
+			const Type edge1X{ Lanes::Load(block.edge1X + offset) }, edge1Y{ Lanes::Load(block.edge1Y + offset) }, edge1Z{ Lanes::Load(block.edge1Z + offset) };
+			const Type edge2X{ Lanes::Load(block.edge2X + offset) }, edge2Y{ Lanes::Load(block.edge2Y + offset) }, edge2Z{ Lanes::Load(block.edge2Z + offset) };
+
+			//culling on the stored normal
+			const Type planeIntersection{ Lanes::Add(Lanes::Add(
+				Lanes::Mul(Lanes::Load(block.normalX + offset), dirX),
+				Lanes::Mul(Lanes::Load(block.normalY + offset), dirY)),
+				Lanes::Mul(Lanes::Load(block.normalZ + offset), dirZ)) };
+			Type valid{ Lanes::LessEqual(Lanes::Mul(planeIntersection, Lanes::Set(cullSign)), Lanes::Set(0.f)) };
+
+			//p = direction x edge2
+			const Type pX{ Lanes::Sub(Lanes::Mul(dirY, edge2Z), Lanes::Mul(dirZ, edge2Y)) };
+			const Type pY{ Lanes::Sub(Lanes::Mul(dirZ, edge2X), Lanes::Mul(dirX, edge2Z)) };
+			const Type pZ{ Lanes::Sub(Lanes::Mul(dirX, edge2Y), Lanes::Mul(dirY, edge2X)) };
+
+			const Type determinant{ Lanes::Add(Lanes::Add(Lanes::Mul(edge1X, pX), Lanes::Mul(edge1Y, pY)), Lanes::Mul(edge1Z, pZ)) };
+			//parallel test against the stored per-triangle threshold, same as GeometryUtils::Intersect_TriangleRecord
+			valid = Lanes::And(valid, Lanes::Greater(Lanes::Abs(determinant), Lanes::Load(block.minDeterminant + offset)));
+			if (Lanes::MoveMask(valid) == 0) return 0;
+
+			const Type invDeterminant{ Lanes::Div(Lanes::Set(1.f), determinant) };
+			const Type toOriginX{ Lanes::Sub(Lanes::Set(origin.x), Lanes::Load(block.v0X + offset)) };
+			const Type toOriginY{ Lanes::Sub(Lanes::Set(origin.y), Lanes::Load(block.v0Y + offset)) };
+			const Type toOriginZ{ Lanes::Sub(Lanes::Set(origin.z), Lanes::Load(block.v0Z + offset)) };
+
+			const Type u{ Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(toOriginX, pX), Lanes::Mul(toOriginY, pY)), Lanes::Mul(toOriginZ, pZ)), invDeterminant) };
+			valid = Lanes::And(valid, Lanes::And(Lanes::GreaterEqual(u, Lanes::Set(0.f)), Lanes::LessEqual(u, Lanes::Set(1.f))));
+
+			//q = toOrigin x edge1
+			const Type qX{ Lanes::Sub(Lanes::Mul(toOriginY, edge1Z), Lanes::Mul(toOriginZ, edge1Y)) };
+			const Type qY{ Lanes::Sub(Lanes::Mul(toOriginZ, edge1X), Lanes::Mul(toOriginX, edge1Z)) };
+			const Type qZ{ Lanes::Sub(Lanes::Mul(toOriginX, edge1Y), Lanes::Mul(toOriginY, edge1X)) };
+
+			const Type v{ Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(dirX, qX), Lanes::Mul(dirY, qY)), Lanes::Mul(dirZ, qZ)), invDeterminant) };
+			valid = Lanes::And(valid, Lanes::And(Lanes::GreaterEqual(v, Lanes::Set(0.f)), Lanes::LessEqual(Lanes::Add(u, v), Lanes::Set(1.f))));
+
+			const Type t{ Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(edge2X, qX), Lanes::Mul(edge2Y, qY)), Lanes::Mul(edge2Z, qZ)), invDeterminant) };
+			valid = Lanes::And(valid, Lanes::And(Lanes::GreaterEqual(t, Lanes::Set(tMin)), Lanes::LessEqual(t, Lanes::Set(tMax))));
+
+			Lanes::Store(distances + offset, t);
+			return Lanes::MoveMask(valid) << offset;
+		}
+
+		//the whole block in Width / Lanes::Count passes
+		template<typename Lanes, int Width>
+		int IntersectTriangleBlock(const TriangleBlock<Width>& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances)
+		{
+			static_assert(Width % Lanes::Count == 0, "a block has to fill whole registers");
+
+			int hitMask{};
+			for (int offset{}; offset < Width; offset += Lanes::Count)
+			{
+				hitMask |= IntersectTriangleLanes<Lanes>(block, offset, origin, direction, tMin, tMax, cullSign, distances);
+			}
+			return hitMask & ((1 << block.count) - 1);
+		}
+#pragma endregion
+
+#pragma region Ray Packets
+		//same logic as GeometryUtils::SlabTest_BVHNode for Lanes::Count rays at a time
+		template<typename Lanes>
+		uint64_t IntersectPacketBox(const RayPacket& packet, const Vector3& boxMin, const Vector3& boxMax, uint64_t rayMask)
+		{
+			using Type = typename Lanes::Type;
+			constexpr uint64_t LaneGroupMask{ (uint64_t{ 1 } << Lanes::Count) - 1 };
+
+			const Type minX{ Lanes::Set(boxMin.x) }, minY{ Lanes::Set(boxMin.y) }, minZ{ Lanes::Set(boxMin.z) };
+			const Type maxX{ Lanes::Set(boxMax.x) }, maxY{ Lanes::Set(boxMax.y) }, maxZ{ Lanes::Set(boxMax.z) };
+
+			uint64_t hitMask{};
+			for (uint32_t lane{}; lane < packet.rayCount; lane += Lanes::Count)
+			{
+				//skip groups without a single ray left
+				if (((rayMask >> lane) & LaneGroupMask) == 0) continue;
+
+				const Type originX{ Lanes::Load(packet.originX + lane) }, originY{ Lanes::Load(packet.originY + lane) }, originZ{ Lanes::Load(packet.originZ + lane) };
+				const Type invX{ Lanes::Load(packet.invDirectionX + lane) }, invY{ Lanes::Load(packet.invDirectionY + lane) }, invZ{ Lanes::Load(packet.invDirectionZ + lane) };
+
+				const Type tx1{ Lanes::Mul(Lanes::Sub(minX, originX), invX) };
+				const Type tx2{ Lanes::Mul(Lanes::Sub(maxX, originX), invX) };
+				const Type ty1{ Lanes::Mul(Lanes::Sub(minY, originY), invY) };
+				const Type ty2{ Lanes::Mul(Lanes::Sub(maxY, originY), invY) };
+				const Type tz1{ Lanes::Mul(Lanes::Sub(minZ, originZ), invZ) };
+				const Type tz2{ Lanes::Mul(Lanes::Sub(maxZ, originZ), invZ) };
+
+				const Type entry{ Lanes::Max(Lanes::Max(Lanes::Min(tx1, tx2), Lanes::Min(ty1, ty2)), Lanes::Min(tz1, tz2)) };
+				const Type exit{ Lanes::Min(Lanes::Min(Lanes::Max(tx1, tx2), Lanes::Max(ty1, ty2)), Lanes::Max(tz1, tz2)) };
+				const Type hit{ Lanes::And(Lanes::And(Lanes::LessEqual(entry, exit), Lanes::GreaterEqual(exit, Lanes::Load(packet.min + lane))),
+					Lanes::LessEqual(entry, Lanes::Load(packet.max + lane))) };
+
+				hitMask |= static_cast<uint64_t>(static_cast<uint32_t>(Lanes::MoveMask(hit))) << lane;
+			}
+			return hitMask & rayMask;
+		}
+#pragma endregion
+
+#pragma region Fast Math
+		//FastMath::RSqrt for whole registers
+		template<typename Lanes>
+		inline typename Lanes::Type FastRSqrt(typename Lanes::Type x)
+		{
+			using Type = typename Lanes::Type;
+			const Type estimate{ Lanes::RSqrt(x) };
+			return Lanes::Mul(estimate, Lanes::Sub(Lanes::Set(1.5f), Lanes::Mul(Lanes::Mul(Lanes::Mul(Lanes::Set(0.5f), x), estimate), estimate)));
+		}
+
+		//FastMath::Log2 for whole registers
+		template<typename Lanes>
+		inline typename Lanes::Type FastLog2(typename Lanes::Type x)
+		{
+			using Type = typename Lanes::Type;
+			using IntType = typename Lanes::IntType;
+
+			const IntType bits{ Lanes::AsInt(x) };
+			const IntType exponent{ Lanes::ShiftRightArithmeticInt(Lanes::SubInt(bits, Lanes::SetInt(FastMath::SqrtHalfBits)), 23) };
+			const Type m{ Lanes::AsFloat(Lanes::SubInt(bits, Lanes::ShiftLeftInt(exponent, 23))) };
+
+			const Type one{ Lanes::Set(1.f) };
+			const Type t{ Lanes::Div(Lanes::Sub(m, one), Lanes::Add(m, one)) };
+			const Type tSquared{ Lanes::Mul(t, t) };
+			Type series{ Lanes::Set(FastMath::Log2Coefficients[4]) };
+			for (int coefficientIdx{ 3 }; coefficientIdx >= 0; --coefficientIdx)
+			{
+				series = Lanes::Add(Lanes::Mul(series, tSquared), Lanes::Set(FastMath::Log2Coefficients[coefficientIdx]));
+			}
+			return Lanes::Add(Lanes::Mul(t, series), Lanes::ConvertToFloat(exponent));
+		}
+
+		//FastMath::Exp2 for whole registers
+		template<typename Lanes>
+		inline typename Lanes::Type FastExp2(typename Lanes::Type x)
+		{
+			using Type = typename Lanes::Type;
+			using IntType = typename Lanes::IntType;
+
+			x = Lanes::Min(Lanes::Max(x, Lanes::Set(-126.f)), Lanes::Set(127.f));
+
+			const IntType n{ Lanes::RoundToInt(x) };
+			const Type f{ Lanes::Sub(x, Lanes::ConvertToFloat(n)) };
+			Type series{ Lanes::Set(FastMath::Exp2Coefficients[6]) };
+			for (int coefficientIdx{ 5 }; coefficientIdx >= 0; --coefficientIdx)
+			{
+				series = Lanes::Add(Lanes::Mul(series, f), Lanes::Set(FastMath::Exp2Coefficients[coefficientIdx]));
+			}
+			return Lanes::AsFloat(Lanes::AddInt(Lanes::AsInt(series), Lanes::ShiftLeftInt(n, 23)));
+		}
+
+		//FastMath::Pow for whole registers, 0 where x <= 0
+		template<typename Lanes>
+		inline typename Lanes::Type FastPow(typename Lanes::Type x, float y)
+		{
+			using Type = typename Lanes::Type;
+			const Type zero{ Lanes::Set(0.f) };
+			const Type power{ FastExp2<Lanes>(Lanes::Mul(Lanes::Set(y), FastLog2<Lanes>(x))) };
+			return Lanes::Select(Lanes::LessEqual(x, zero), zero, power);
+		}
+#pragma endregion
+
+#pragma region Pixels
+		//Narkowicz's ACES fit, clamped to [0, 1] by the caller
+		inline float ToneMapAces(float value)
+		{
+			return (value * (2.51f * value + 0.03f)) / (value * (2.43f * value + 0.59f) + 0.14f);
+		}
+
+		//one pixel of ResolvePixels, for the pixels past the last full register. MaxToOne then SDL_MapRGB of the truncated
+		//8-bit channels with the default settings, the way Renderer used to write every pixel
+		inline uint32_t ResolvePixel(float red, float green, float blue, const ResolveSettings& settings, const PixelFormat& format)
+		{
+			red *= settings.exposure;
+			green *= settings.exposure;
+			blue *= settings.exposure;
+
+			switch (settings.toneMapping)
+			{
+			case ToneMapping::Reinhard:
+				red = red / (1.f + red);
+				green = green / (1.f + green);
+				blue = blue / (1.f + blue);
+				break;
+			case ToneMapping::Aces:
+				red = ToneMapAces(red);
+				green = ToneMapAces(green);
+				blue = ToneMapAces(blue);
+				break;
+			default:
+			{
+				const float maxValue{ Max(red, Max(green, blue)) };
+				if (maxValue > 1.f)
+				{
+					red /= maxValue;
+					green /= maxValue;
+					blue /= maxValue;
+				}
+				break;
+			}
+			}
+
+			//8-bit output hides the error of the fast pow
+			if (settings.gamma != 1.f)
+			{
+				const float invGamma{ 1.f / settings.gamma };
+				red = FastMath::Pow(red, invGamma);
+				green = FastMath::Pow(green, invGamma);
+				blue = FastMath::Pow(blue, invGamma);
+			}
+
+			red = Clamp(red, 0.f, 1.f);
+			green = Clamp(green, 0.f, 1.f);
+			blue = Clamp(blue, 0.f, 1.f);
+
+			return (static_cast<uint32_t>(static_cast<uint8_t>(red * 255)) >> format.redLoss << format.redShift)
+				| (static_cast<uint32_t>(static_cast<uint8_t>(green * 255)) >> format.greenLoss << format.greenShift)
+				| (static_cast<uint32_t>(static_cast<uint8_t>(blue * 255)) >> format.blueLoss << format.blueShift)
+				| format.alphaMask;
+		}
+
+		template<typename Lanes>
+		inline typename Lanes::Type ToneMapAces(typename Lanes::Type value)
+		{
+			using Type = typename Lanes::Type;
+			const Type numerator{ Lanes::Mul(value, Lanes::Add(Lanes::Mul(Lanes::Set(2.51f), value), Lanes::Set(0.03f))) };
+			const Type denominator{ Lanes::Add(Lanes::Mul(value, Lanes::Add(Lanes::Mul(Lanes::Set(2.43f), value), Lanes::Set(0.59f))), Lanes::Set(0.14f)) };
+			return Lanes::Div(numerator, denominator);
+		}
+
+		//ResolvePixel for Lanes::Count pixels at a time, in the same operation order
+		template<typename Lanes>
+		void ResolvePixels(const float* pRed, const float* pGreen, const float* pBlue, uint32_t count, const ResolveSettings& settings, const PixelFormat& format, uint32_t* pPixels)
+		{
+			using Type = typename Lanes::Type;
+			using IntType = typename Lanes::IntType;
+
+			const Type zero{ Lanes::Set(0.f) }, one{ Lanes::Set(1.f) }, scale{ Lanes::Set(255.f) }, exposure{ Lanes::Set(settings.exposure) };
+			const bool hasGamma{ settings.gamma != 1.f };
+			const float invGamma{ 1.f / settings.gamma };
+			const IntType alphaMask{ Lanes::SetInt(format.alphaMask) };
+
+			uint32_t pixelIdx{};
+			for (; pixelIdx + Lanes::Count <= count; pixelIdx += Lanes::Count)
+			{
+				Type red{ Lanes::Mul(Lanes::LoadUnaligned(pRed + pixelIdx), exposure) };
+				Type green{ Lanes::Mul(Lanes::LoadUnaligned(pGreen + pixelIdx), exposure) };
+				Type blue{ Lanes::Mul(Lanes::LoadUnaligned(pBlue + pixelIdx), exposure) };
+
+				switch (settings.toneMapping)
+				{
+				case ToneMapping::Reinhard:
+					red = Lanes::Div(red, Lanes::Add(one, red));
+					green = Lanes::Div(green, Lanes::Add(one, green));
+					blue = Lanes::Div(blue, Lanes::Add(one, blue));
+					break;
+				case ToneMapping::Aces:
+					red = ToneMapAces<Lanes>(red);
+					green = ToneMapAces<Lanes>(green);
+					blue = ToneMapAces<Lanes>(blue);
+					break;
+				default:
+				{
+					//MaxToOne divides, so the rounding matches the scalar clamp
+					const Type maxValue{ Lanes::Max(red, Lanes::Max(green, blue)) };
+					const Type inRange{ Lanes::LessEqual(maxValue, one) };
+					red = Lanes::Select(inRange, red, Lanes::Div(red, maxValue));
+					green = Lanes::Select(inRange, green, Lanes::Div(green, maxValue));
+					blue = Lanes::Select(inRange, blue, Lanes::Div(blue, maxValue));
+					break;
+				}
+				}
+
+				if (hasGamma)
+				{
+					red = FastPow<Lanes>(red, invGamma);
+					green = FastPow<Lanes>(green, invGamma);
+					blue = FastPow<Lanes>(blue, invGamma);
+				}
+
+				red = Lanes::Min(Lanes::Max(red, zero), one);
+				green = Lanes::Min(Lanes::Max(green, zero), one);
+				blue = Lanes::Min(Lanes::Max(blue, zero), one);
+
+				const IntType redBits{ Lanes::ShiftLeftInt(Lanes::ShiftRightInt(Lanes::TruncateToInt(Lanes::Mul(red, scale)), format.redLoss), format.redShift) };
+				const IntType greenBits{ Lanes::ShiftLeftInt(Lanes::ShiftRightInt(Lanes::TruncateToInt(Lanes::Mul(green, scale)), format.greenLoss), format.greenShift) };
+				const IntType blueBits{ Lanes::ShiftLeftInt(Lanes::ShiftRightInt(Lanes::TruncateToInt(Lanes::Mul(blue, scale)), format.blueLoss), format.blueShift) };
+				Lanes::StoreInt(pPixels + pixelIdx, Lanes::OrInt(Lanes::OrInt(redBits, greenBits), Lanes::OrInt(blueBits, alphaMask)));
+			}
+
+			for (; pixelIdx < count; ++pixelIdx)
+			{
+				pPixels[pixelIdx] = ResolvePixel(pRed[pixelIdx], pGreen[pixelIdx], pBlue[pixelIdx], settings, format);
+			}
+		}
+#pragma endregion
+
+#pragma region Shading
+		template<typename Lanes>
+		inline typename Lanes::Type Dot(typename Lanes::Type aX, typename Lanes::Type aY, typename Lanes::Type aZ,
+			typename Lanes::Type bX, typename Lanes::Type bY, typename Lanes::Type bZ)
+		{
+			return Lanes::Add(Lanes::Add(Lanes::Mul(aX, bX), Lanes::Mul(aY, bY)), Lanes::Mul(aZ, bZ));
+		}
+
+		//Material_LambertPhong::Shade for every sample, Lambert plus BRDF::Phong in the same operation order
+		template<typename Lanes, MathTier Tier>
+		void ShadeLambertPhongTier(const ShadingBatch& batch, const LambertPhongParameters& parameters, float* pRed, float* pGreen, float* pBlue)
+		{
+			using Type = typename Lanes::Type;
+
+			//per channel instead of through ColorRGB's operators, see SimdIsa.h
+			const float diffuseRed{ parameters.diffuseColor.r * parameters.diffuseReflectance / PI };
+			const float diffuseGreen{ parameters.diffuseColor.g * parameters.diffuseReflectance / PI };
+			const float diffuseBlue{ parameters.diffuseColor.b * parameters.diffuseReflectance / PI };
+			const Type two{ Lanes::Set(2.f) }, specularReflectance{ Lanes::Set(parameters.specularReflectance) };
+
+			alignas(64) float cosAngles[Lanes::Count];
+			for (uint32_t lane{}; lane < batch.count; lane += Lanes::Count)
+			{
+				const Type nX{ Lanes::Load(batch.normalX + lane) }, nY{ Lanes::Load(batch.normalY + lane) }, nZ{ Lanes::Load(batch.normalZ + lane) };
+				const Type lX{ Lanes::Load(batch.lightX + lane) }, lY{ Lanes::Load(batch.lightY + lane) }, lZ{ Lanes::Load(batch.lightZ + lane) };
+				const Type vX{ Lanes::Load(batch.viewX + lane) }, vY{ Lanes::Load(batch.viewY + lane) }, vZ{ Lanes::Load(batch.viewZ + lane) };
+
+				//reflect = l - 2 * (l . n) * n, compared against the view ray direction -v
+				const Type scale{ Lanes::Mul(two, Dot<Lanes>(lX, lY, lZ, nX, nY, nZ)) };
+				const Type reflectX{ Lanes::Sub(lX, Lanes::Mul(scale, nX)) };
+				const Type reflectY{ Lanes::Sub(lY, Lanes::Mul(scale, nY)) };
+				const Type reflectZ{ Lanes::Sub(lZ, Lanes::Mul(scale, nZ)) };
+				const Type zero{ Lanes::Set(0.f) };
+				const Type cosAngle{ Dot<Lanes>(reflectX, reflectY, reflectZ, Lanes::Sub(zero, vX), Lanes::Sub(zero, vY), Lanes::Sub(zero, vZ)) };
+
+				Type phong{};
+				if constexpr (Tier == MathTier::Fast)
+				{
+					phong = Lanes::Mul(specularReflectance, FastPow<Lanes>(cosAngle, parameters.phongExponent));
+				}
+				else
+				{
+					//no exact vector pow, the exponent is any float and negative bases have to match powf
+					Lanes::Store(cosAngles, cosAngle);
+					for (int laneIdx{}; laneIdx < Lanes::Count; ++laneIdx) cosAngles[laneIdx] = powf(cosAngles[laneIdx], parameters.phongExponent);
+					phong = Lanes::Mul(specularReflectance, Lanes::Load(cosAngles));
+				}
+
+				Lanes::Store(pRed + lane, Lanes::Add(Lanes::Set(diffuseRed), phong));
+				Lanes::Store(pGreen + lane, Lanes::Add(Lanes::Set(diffuseGreen), phong));
+				Lanes::Store(pBlue + lane, Lanes::Add(Lanes::Set(diffuseBlue), phong));
+			}
+		}
+
+		//Material_CookTorrence::Shade for every sample, same operation order as the BRDF functions it calls
+		template<typename Lanes, MathTier Tier>
+		void ShadeCookTorranceTier(const ShadingBatch& batch, const CookTorranceParameters& parameters, float* pRed, float* pGreen, float* pBlue)
+		{
+			using Type = typename Lanes::Type;
+
+			const bool isMetal{ parameters.metalness != 0.f };
+			const ColorRGB f0{ isMetal ? parameters.albedo : ColorRGB{ 0.04f, 0.04f, 0.04f } };
+			const float a{ parameters.roughness * parameters.roughness };
+			const float k{ (a + 1.f) * (a + 1.f) / 8.f };
+
+			const Type one{ Lanes::Set(1.f) };
+			const Type f0Red{ Lanes::Set(f0.r) }, f0Green{ Lanes::Set(f0.g) }, f0Blue{ Lanes::Set(f0.b) };
+			const Type aSquared{ Lanes::Set(a * a) }, aSquaredMinusOne{ Lanes::Set(a * a - 1.f) }, pi{ Lanes::Set(PI) };
+			const Type kValue{ Lanes::Set(k) }, oneMinusK{ Lanes::Set(1.f - k) }, four{ Lanes::Set(4.f) };
+
+			for (uint32_t lane{}; lane < batch.count; lane += Lanes::Count)
+			{
+				const Type nX{ Lanes::Load(batch.normalX + lane) }, nY{ Lanes::Load(batch.normalY + lane) }, nZ{ Lanes::Load(batch.normalZ + lane) };
+				const Type lX{ Lanes::Load(batch.lightX + lane) }, lY{ Lanes::Load(batch.lightY + lane) }, lZ{ Lanes::Load(batch.lightZ + lane) };
+				const Type vX{ Lanes::Load(batch.viewX + lane) }, vY{ Lanes::Load(batch.viewY + lane) }, vZ{ Lanes::Load(batch.viewZ + lane) };
+
+				//half vector
+				const Type sumX{ Lanes::Add(vX, lX) }, sumY{ Lanes::Add(vY, lY) }, sumZ{ Lanes::Add(vZ, lZ) };
+				const Type sqrLength{ Dot<Lanes>(sumX, sumY, sumZ, sumX, sumY, sumZ) };
+				Type hX{}, hY{}, hZ{};
+				if constexpr (Tier == MathTier::Fast)
+				{
+					const Type invLength{ FastRSqrt<Lanes>(sqrLength) };
+					hX = Lanes::Mul(sumX, invLength);
+					hY = Lanes::Mul(sumY, invLength);
+					hZ = Lanes::Mul(sumZ, invLength);
+				}
+				else
+				{
+					const Type length{ Lanes::Sqrt(sqrLength) };
+					hX = Lanes::Div(sumX, length);
+					hY = Lanes::Div(sumY, length);
+					hZ = Lanes::Div(sumZ, length);
+				}
+
+				//Schlick, (1 - h.v)^5 as multiplies
+				const Type base{ Lanes::Sub(one, Dot<Lanes>(hX, hY, hZ, vX, vY, vZ)) };
+				const Type baseSquared{ Lanes::Mul(base, base) };
+				const Type fresnelFactor{ Lanes::Mul(Lanes::Mul(baseSquared, baseSquared), base) };
+				const Type fresnelRed{ Lanes::Add(f0Red, Lanes::Mul(Lanes::Sub(one, f0Red), fresnelFactor)) };
+				const Type fresnelGreen{ Lanes::Add(f0Green, Lanes::Mul(Lanes::Sub(one, f0Green), fresnelFactor)) };
+				const Type fresnelBlue{ Lanes::Add(f0Blue, Lanes::Mul(Lanes::Sub(one, f0Blue), fresnelFactor)) };
+
+				//Trowbridge-Reitz GGX
+				const Type dotNh{ Dot<Lanes>(nX, nY, nZ, hX, hY, hZ) };
+				const Type denominatorRoot{ Lanes::Add(Lanes::Mul(Lanes::Mul(dotNh, dotNh), aSquaredMinusOne), one) };
+				const Type normalDistribution{ Lanes::Div(aSquared, Lanes::Mul(pi, Lanes::Mul(denominatorRoot, denominatorRoot))) };
+
+				//Smith with Schlick-GGX
+				const Type dotNv{ Dot<Lanes>(nX, nY, nZ, vX, vY, vZ) };
+				const Type dotNl{ Dot<Lanes>(nX, nY, nZ, lX, lY, lZ) };
+				const Type geometryView{ Lanes::Div(dotNv, Lanes::Add(Lanes::Mul(dotNv, oneMinusK), kValue)) };
+				const Type geometryLight{ Lanes::Div(dotNl, Lanes::Add(Lanes::Mul(dotNl, oneMinusK), kValue)) };
+				const Type geometry{ Lanes::Mul(geometryView, geometryLight) };
+
+				const Type specularDenominator{ Lanes::Mul(Lanes::Mul(four, dotNv), dotNl) };
+
+				//metals have no diffuse part, otherwise kd = 1 - F
+				const auto shadeChannel{ [&](Type fresnel, float albedo, float* pChannel)
+					{
+						const Type specular{ Lanes::Div(Lanes::Mul(Lanes::Mul(fresnel, normalDistribution), geometry), specularDenominator) };
+						const Type diffuse{ isMetal ? Lanes::Set(0.f) : Lanes::Div(Lanes::Mul(Lanes::Set(albedo), Lanes::Sub(one, fresnel)), pi) };
+						Lanes::Store(pChannel + lane, Lanes::Add(diffuse, specular));
+					} };
+				shadeChannel(fresnelRed, parameters.albedo.r, pRed);
+				shadeChannel(fresnelGreen, parameters.albedo.g, pGreen);
+				shadeChannel(fresnelBlue, parameters.albedo.b, pBlue);
+			}
+		}
+
+		template<typename Lanes>
+		void ShadeLambertPhong(const ShadingBatch& batch, const LambertPhongParameters& parameters, MathTier tier, float* pRed, float* pGreen, float* pBlue)
+		{
+			if (tier == MathTier::Fast) ShadeLambertPhongTier<Lanes, MathTier::Fast>(batch, parameters, pRed, pGreen, pBlue);
+			else ShadeLambertPhongTier<Lanes, MathTier::Exact>(batch, parameters, pRed, pGreen, pBlue);
+		}
+
+		template<typename Lanes>
+		void ShadeCookTorrance(const ShadingBatch& batch, const CookTorranceParameters& parameters, MathTier tier, float* pRed, float* pGreen, float* pBlue)
+		{
+			if (tier == MathTier::Fast) ShadeCookTorranceTier<Lanes, MathTier::Fast>(batch, parameters, pRed, pGreen, pBlue);
+			else ShadeCookTorranceTier<Lanes, MathTier::Exact>(batch, parameters, pRed, pGreen, pBlue);
+		}
+#pragma endregion
+
+		/**
+		 * \brief Fills a dispatch table with the kernel instantiations of one instruction set
+		 * \tparam WideLanes Widest lanes of the set, used by the sphere, packet and pixel kernels
+		 * \tparam BlockLanes Lanes of the 8-wide triangle blocks, at most 8
+		 */
+		template<typename WideLanes, typename BlockLanes>
+		KernelTable CreateKernelTable(IsaLevel isaLevel)
+		{
+			KernelTable table{};
+			table.isaLevel = isaLevel;
+			table.intersectSpheres = &IntersectSpheres<WideLanes>;
+			table.occludedSpheres = &OccludedSpheres<WideLanes>;
+			table.intersectTriangleBlock4 = &IntersectTriangleBlock<Simd::Lanes4, 4>;
+			table.intersectTriangleBlock8 = &IntersectTriangleBlock<BlockLanes, 8>;
+			table.intersectPacketBox = &IntersectPacketBox<WideLanes>;
+			table.resolvePixels = &ResolvePixels<WideLanes>;
+			table.shadeLambertPhong = &ShadeLambertPhong<WideLanes>;
+			table.shadeCookTorrance = &ShadeCookTorrance<WideLanes>;
+			return table;
+		}
+	}
+	}
+}
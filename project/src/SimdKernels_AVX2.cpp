@@ -0,0 +1,15 @@
+#include "SimdKernels.h"
+
+//Compiled with AVX2 and FMA enabled (see CMakeLists.txt), only called once CPUID reported support
+#if !defined(__AVX2__)
+#error "SimdKernels_AVX2.cpp has to be compiled with AVX2 enabled"
+#endif
+
+namespace dae::SimdKernels
+{
+	const KernelTable& GetKernelTable_AVX2()
+	{
+		static const KernelTable table{ CreateKernelTable<Simd::Lanes8, Simd::Lanes8>(IsaLevel::AVX2) };
+		return table;
+	}
+}
@@ -0,0 +1,16 @@
+#include "SimdKernels.h"
+
+//Compiled with AVX-512F enabled (see CMakeLists.txt), only called once CPUID reported support
+#if !defined(__AVX512F__)
+#error "SimdKernels_AVX512.cpp has to be compiled with AVX-512 enabled"
+#endif
+
+namespace dae::SimdKernels
+{
+	//8-wide triangle blocks don't fill a 16-wide register, they keep the AVX2 width
+	const KernelTable& GetKernelTable_AVX512()
+	{
+		static const KernelTable table{ CreateKernelTable<Simd::Lanes16, Simd::Lanes8>(IsaLevel::AVX512) };
+		return table;
+	}
+}
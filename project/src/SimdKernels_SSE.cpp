@@ -0,0 +1,11 @@
+#include "SimdKernels.h"
+
+//Baseline kernels, compiled with the flags of the rest of the program
+namespace dae::SimdKernels
+{
+	const KernelTable& GetKernelTable_SSE()
+	{
+		static const KernelTable table{ CreateKernelTable<Simd::Lanes4, Simd::Lanes4>(IsaLevel::SSE) };
+		return table;
+	}
+}
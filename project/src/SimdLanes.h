@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <immintrin.h>
+
+#include "SimdIsa.h"
+
+namespace dae
+{
+	//Thin wrappers over SSE, AVX and AVX-512 registers so one kernel template can be instantiated for 4, 8 and 16 lanes.
+	//Lanes8 only exists when the compiler targets AVX, 8-wide data is processed as two Lanes4 halves otherwise.
+	//Lanes16 only exists when the compiler targets AVX-512.
+	namespace Simd
+	{
+	inline namespace SIMD_ISA_NAMESPACE
+	{
+		struct Lanes4
+		{
+			using Type = __m128;
+			using IntType = __m128i;
+			static constexpr int Count{ 4 };
+
+			static Type Load(const float* pValues) { return _mm_load_ps(pValues); }
+			static Type LoadUnaligned(const float* pValues) { return _mm_loadu_ps(pValues); }
+			static Type Set(float value) { return _mm_set1_ps(value); }
+			static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+			static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+			static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+			static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+			static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+			//12-bit estimate of 1 / sqrt(a)
+			static Type RSqrt(Type a) { return _mm_rsqrt_ps(a); }
+			static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+			static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+			static Type And(Type a, Type b) { return _mm_and_ps(a, b); }
+			static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+			//picks a where mask is set, b elsewhere
+			static Type Select(Type mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+			static Type Greater(Type a, Type b) { return _mm_cmpgt_ps(a, b); }
+			static Type GreaterEqual(Type a, Type b) { return _mm_cmpge_ps(a, b); }
+			static Type LessEqual(Type a, Type b) { return _mm_cmple_ps(a, b); }
+			static void Store(float* pValues, Type a) { _mm_storeu_ps(pValues, a); }
+			static int MoveMask(Type a) { return _mm_movemask_ps(a); }
+
+			//32-bit integer lanes, for packing pixels and the fast math bit tricks
+			static IntType TruncateToInt(Type a) { return _mm_cvttps_epi32(a); }
+			static IntType RoundToInt(Type a) { return _mm_cvtps_epi32(a); }
+			static Type ConvertToFloat(IntType a) { return _mm_cvtepi32_ps(a); }
+			static IntType AsInt(Type a) { return _mm_castps_si128(a); }
+			static Type AsFloat(IntType a) { return _mm_castsi128_ps(a); }
+			static IntType SetInt(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+			static IntType AddInt(IntType a, IntType b) { return _mm_add_epi32(a, b); }
+			static IntType SubInt(IntType a, IntType b) { return _mm_sub_epi32(a, b); }
+			static IntType OrInt(IntType a, IntType b) { return _mm_or_si128(a, b); }
+			static IntType ShiftLeftInt(IntType a, int count) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			static IntType ShiftRightInt(IntType a, int count) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+			//shifts the sign in
+			static IntType ShiftRightArithmeticInt(IntType a, int count) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(count)); }
+			static void StoreInt(uint32_t* pValues, IntType a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues), a); }
+		};
+
+#if defined(__AVX__)
+		struct Lanes8
+		{
+			using Type = __m256;
+			using IntType = __m256i;
+			static constexpr int Count{ 8 };
+
+			static Type Load(const float* pValues) { return _mm256_load_ps(pValues); }
+			static Type LoadUnaligned(const float* pValues) { return _mm256_loadu_ps(pValues); }
+			static Type Set(float value) { return _mm256_set1_ps(value); }
+			static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+			static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+			static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+			static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+			static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+			static Type RSqrt(Type a) { return _mm256_rsqrt_ps(a); }
+			static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+			static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+			static Type And(Type a, Type b) { return _mm256_and_ps(a, b); }
+			static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+			static Type Select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+			static Type Greater(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static Type GreaterEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+			static Type LessEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+			static void Store(float* pValues, Type a) { _mm256_storeu_ps(pValues, a); }
+			static int MoveMask(Type a) { return _mm256_movemask_ps(a); }
+
+#if defined(__AVX2__)
+			static IntType TruncateToInt(Type a) { return _mm256_cvttps_epi32(a); }
+			static IntType RoundToInt(Type a) { return _mm256_cvtps_epi32(a); }
+			static Type ConvertToFloat(IntType a) { return _mm256_cvtepi32_ps(a); }
+			static IntType AsInt(Type a) { return _mm256_castps_si256(a); }
+			static Type AsFloat(IntType a) { return _mm256_castsi256_ps(a); }
+			static IntType SetInt(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+			static IntType AddInt(IntType a, IntType b) { return _mm256_add_epi32(a, b); }
+			static IntType SubInt(IntType a, IntType b) { return _mm256_sub_epi32(a, b); }
+			static IntType OrInt(IntType a, IntType b) { return _mm256_or_si256(a, b); }
+			static IntType ShiftLeftInt(IntType a, int count) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			static IntType ShiftRightInt(IntType a, int count) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+			static IntType ShiftRightArithmeticInt(IntType a, int count) { return _mm256_sra_epi32(a, _mm_cvtsi32_si128(count)); }
+			static void StoreInt(uint32_t* pValues, IntType a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pValues), a); }
+#endif
+		};
+#endif
+
+#if defined(__AVX512F__)
+		//comparisons return full lane masks like the narrower lanes instead of AVX-512 mask registers, so the kernels stay shared
+		struct Lanes16
+		{
+			using Type = __m512;
+			using IntType = __m512i;
+			static constexpr int Count{ 16 };
+
+			static Type Load(const float* pValues) { return _mm512_load_ps(pValues); }
+			static Type LoadUnaligned(const float* pValues) { return _mm512_loadu_ps(pValues); }
+			static Type Set(float value) { return _mm512_set1_ps(value); }
+			static Type Add(Type a, Type b) { return _mm512_add_ps(a, b); }
+			static Type Sub(Type a, Type b) { return _mm512_sub_ps(a, b); }
+			static Type Mul(Type a, Type b) { return _mm512_mul_ps(a, b); }
+			static Type Div(Type a, Type b) { return _mm512_div_ps(a, b); }
+			static Type Sqrt(Type a) { return _mm512_sqrt_ps(a); }
+			//14-bit estimate
+			static Type RSqrt(Type a) { return _mm512_rsqrt14_ps(a); }
+			static Type Min(Type a, Type b) { return _mm512_min_ps(a, b); }
+			static Type Max(Type a, Type b) { return _mm512_max_ps(a, b); }
+			static Type And(Type a, Type b) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b))); }
+			static Type Abs(Type a) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff))); }
+			static Type Select(Type mask, Type a, Type b) { return _mm512_mask_blend_ps(static_cast<__mmask16>(MoveMask(mask)), b, a); }
+			static Type Greater(Type a, Type b) { return ToLaneMask(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)); }
+			static Type GreaterEqual(Type a, Type b) { return ToLaneMask(_mm512_cmp_ps_mask(a, b, _CMP_GE_OQ)); }
+			static Type LessEqual(Type a, Type b) { return ToLaneMask(_mm512_cmp_ps_mask(a, b, _CMP_LE_OQ)); }
+			static void Store(float* pValues, Type a) { _mm512_storeu_ps(pValues, a); }
+			static int MoveMask(Type a) { return _mm512_cmplt_epi32_mask(_mm512_castps_si512(a), _mm512_setzero_si512()); }
+
+			static IntType TruncateToInt(Type a) { return _mm512_cvttps_epi32(a); }
+			static IntType RoundToInt(Type a) { return _mm512_cvtps_epi32(a); }
+			static Type ConvertToFloat(IntType a) { return _mm512_cvtepi32_ps(a); }
+			static IntType AsInt(Type a) { return _mm512_castps_si512(a); }
+			static Type AsFloat(IntType a) { return _mm512_castsi512_ps(a); }
+			static IntType SetInt(uint32_t value) { return _mm512_set1_epi32(static_cast<int>(value)); }
+			static IntType AddInt(IntType a, IntType b) { return _mm512_add_epi32(a, b); }
+			static IntType SubInt(IntType a, IntType b) { return _mm512_sub_epi32(a, b); }
+			static IntType OrInt(IntType a, IntType b) { return _mm512_or_si512(a, b); }
+			static IntType ShiftLeftInt(IntType a, int count) { return _mm512_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			static IntType ShiftRightInt(IntType a, int count) { return _mm512_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+			static IntType ShiftRightArithmeticInt(IntType a, int count) { return _mm512_sra_epi32(a, _mm_cvtsi32_si128(count)); }
+			static void StoreInt(uint32_t* pValues, IntType a) { _mm512_storeu_si512(pValues, a); }
+
+		private:
+			static Type ToLaneMask(__mmask16 mask) { return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(mask, -1)); }
+		};
+#endif
+
+		//widest lanes the compiler targets for code that isn't dispatched at runtime
+#if defined(__AVX__)
+		using WideLanes = Lanes8;
+#else
+		using WideLanes = Lanes4;
+#endif
+	}
+	}
+}
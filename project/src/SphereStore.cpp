@@ -0,0 +1,93 @@
+#include "SphereStore.h"
+#include "CpuDispatch.h"
+
+namespace dae
+{
+	namespace
+	{
+		//padding past the last slot so a full register (up to 16 lanes) can always be loaded from any slot
+		constexpr uint32_t SlotPadding{ 16 };
+	}
+
+	void SphereStore::Build(const std::vector<Sphere>& spheres)
+	{
+		Resize(static_cast<uint32_t>(spheres.size()));
+		for (uint32_t sphereIdx{}; sphereIdx < spheres.size(); ++sphereIdx)
+		{
+			SetSlot(sphereIdx, spheres[sphereIdx], sphereIdx);
+		}
+		m_HasEmptySlots = false;
+	}
+
+	void SphereStore::Build(const std::vector<Sphere>& spheres, const std::vector<uint32_t>& primitiveIndices)
+	{
+		Resize(static_cast<uint32_t>(primitiveIndices.size()));
+		for (uint32_t slot{}; slot < primitiveIndices.size(); ++slot)
+		{
+			const uint32_t primitiveIdx{ primitiveIndices[slot] };
+			if (primitiveIdx < spheres.size()) SetSlot(slot, spheres[primitiveIdx], primitiveIdx);
+			else m_HasEmptySlots = true;
+		}
+	}
+
+	void SphereStore::Clear()
+	{
+		m_X.clear();
+		m_Y.clear();
+		m_Z.clear();
+		m_RadiusSquared.clear();
+		m_MaterialIndices.clear();
+		m_SphereIndices.clear();
+		m_SlotCount = 0;
+		m_HasEmptySlots = false;
+	}
+
+	bool SphereStore::IntersectNearest(uint32_t firstSlot, uint32_t slotCount, const Ray& ray, float& t, uint32_t& slot) const
+	{
+		return Dispatch::GetKernels().intersectSpheres(GetSlots(), firstSlot, slotCount, ray, t, slot);
+	}
+
+	bool SphereStore::HitTest(uint32_t firstSlot, uint32_t slotCount, Ray& ray, HitRecord& hitRecord) const
+	{
+		float t{};
+		uint32_t slot{};
+		if (!IntersectNearest(firstSlot, slotCount, ray, t, slot)) return false;
+
+		ray.max = t;
+
+		hitRecord.t = t;
+		hitRecord.didHit = true;
+		hitRecord.materialIndex = m_MaterialIndices[slot];
+		hitRecord.origin = ray.origin + (t * ray.direction);
+		hitRecord.normal = (hitRecord.origin - Vector3{ m_X[slot], m_Y[slot], m_Z[slot] }).Normalized();
+		return true;
+	}
+
+	bool SphereStore::Occluded(uint32_t firstSlot, uint32_t slotCount, const Ray& ray) const
+	{
+		return Dispatch::GetKernels().occludedSpheres(GetSlots(), firstSlot, slotCount, ray);
+	}
+
+	void SphereStore::Resize(uint32_t slotCount)
+	{
+		//empty slots sit at the origin with a negative radius, their discriminant is always negative
+		m_SlotCount = slotCount;
+		m_X.assign(slotCount + SlotPadding, 0.f);
+		m_Y.assign(slotCount + SlotPadding, 0.f);
+		m_Z.assign(slotCount + SlotPadding, 0.f);
+		m_RadiusSquared.assign(slotCount + SlotPadding, -1.f);
+		m_MaterialIndices.assign(slotCount, 0);
+		m_SphereIndices.assign(slotCount, 0);
+		m_HasEmptySlots = false;
+	}
+
+	void SphereStore::SetSlot(uint32_t slot, const Sphere& sphere, uint32_t sphereIdx)
+	{
+		m_X[slot] = sphere.origin.x;
+		m_Y[slot] = sphere.origin.y;
+		m_Z[slot] = sphere.origin.z;
+		m_RadiusSquared[slot] = sphere.radius * sphere.radius;
+		m_MaterialIndices[slot] = sphere.materialIndex;
+		m_SphereIndices[slot] = sphereIdx;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "CpuDispatch.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Structure of arrays copy of the scene spheres, so one ray is tested against 4 (SSE), 8 (AVX2) or 16 (AVX-512) spheres per instruction.
+	//Slots can follow the primitive order of an acceleration structure, a leaf or cell range then maps straight onto a slot range.
+	//Slots that hold other primitives are empty and never hit.
+	class SphereStore final
+	{
+	public:
+		void Build(const std::vector<Sphere>& spheres);
+		/**
+		 * \brief Lays the spheres out in primitive order
+		 * \param primitiveIndices Slot i holds spheres[primitiveIndices[i]], indices past the sphere count leave the slot empty
+		 */
+		void Build(const std::vector<Sphere>& spheres, const std::vector<uint32_t>& primitiveIndices);
+		void Clear();
+
+		uint32_t GetSlotCount() const { return m_SlotCount; }
+		uint32_t GetSphereIdx(uint32_t slot) const { return m_SphereIndices[slot]; }
+		bool HasEmptySlots() const { return m_HasEmptySlots; }
+
+		/**
+		 * \brief Nearest sphere hit among slots [firstSlot, firstSlot + slotCount)
+		 * \param t Distance of the nearest hit within [ray.min, ray.max]
+		 * \param slot Slot of the nearest hit
+		 * \return true if any sphere in the range was hit
+		 */
+		bool IntersectNearest(uint32_t firstSlot, uint32_t slotCount, const Ray& ray, float& t, uint32_t& slot) const;
+		//IntersectNearest that fills in the hit record (normal and hit point only for the winner) and shrinks ray.max
+		bool HitTest(uint32_t firstSlot, uint32_t slotCount, Ray& ray, HitRecord& hitRecord) const;
+		//any sphere in the range within [ray.min, ray.max]
+		bool Occluded(uint32_t firstSlot, uint32_t slotCount, const Ray& ray) const;
+
+	private:
+		std::vector<float> m_X{};
+		std::vector<float> m_Y{};
+		std::vector<float> m_Z{};
+		std::vector<float> m_RadiusSquared{}; //negative for empty slots
+		std::vector<unsigned char> m_MaterialIndices{};
+		std::vector<uint32_t> m_SphereIndices{};
+
+		uint32_t m_SlotCount{};
+		bool m_HasEmptySlots{};
+
+		SphereSlots GetSlots() const { return { m_X.data(), m_Y.data(), m_Z.data(), m_RadiusSquared.data() }; }
+		void Resize(uint32_t slotCount);
+		void SetSlot(uint32_t slot, const Sphere& sphere, uint32_t sphereIdx);
+	};
+}
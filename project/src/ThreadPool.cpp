@@ -0,0 +1,160 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	namespace
+	{
+		uint64_t PackTasks(uint32_t front, uint32_t back)
+		{
+			return front | static_cast<uint64_t>(back) << 32;
+		}
+	}
+
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+		m_pQueues = std::make_unique<TaskQueue[]>(threadCount);
+		m_JobStats.resize(threadCount);
+
+		//the thread calling ParallelFor is thread 0
+		m_Workers.reserve(threadCount - 1);
+		for (uint32_t workerIdx{ 1 }; workerIdx < threadCount; ++workerIdx)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, workerIdx);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_JobStarted.notify_all();
+
+		for (std::thread& worker : m_Workers) worker.join();
+	}
+
+	void ThreadPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task)
+	{
+		if (taskCount == 0) return;
+
+		const uint32_t threadCount{ GetThreadCount() };
+		const auto startTime{ std::chrono::steady_clock::now() };
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pTask = &task;
+			for (uint32_t threadIdx{}; threadIdx < threadCount; ++threadIdx)
+			{
+				const uint64_t front{ uint64_t(taskCount) * threadIdx / threadCount }, back{ uint64_t(taskCount) * (threadIdx + 1) / threadCount };
+				m_pQueues[threadIdx].tasks.store(PackTasks(uint32_t(front), uint32_t(back)), std::memory_order_relaxed);
+				m_pQueues[threadIdx].stats = {};
+			}
+			m_BusyWorkers = static_cast<uint32_t>(m_Workers.size());
+			++m_JobIdx;
+		}
+		m_JobStarted.notify_all();
+
+		RunTasks(0);
+
+		//every worker has to check in, even the ones that found no task left, before the next job may overwrite this one
+		std::unique_lock lock{ m_Mutex };
+		m_JobFinished.wait(lock, [this] { return m_BusyWorkers == 0; });
+		m_pTask = nullptr;
+
+		const float jobTime{ std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+		for (uint32_t threadIdx{}; threadIdx < threadCount; ++threadIdx)
+		{
+			m_JobStats[threadIdx] = m_pQueues[threadIdx].stats;
+			m_JobStats[threadIdx].idleTime = std::max(jobTime - m_JobStats[threadIdx].busyTime, 0.f);
+		}
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t threadIdx)
+	{
+		uint32_t lastJobIdx{};
+		while (true)
+		{
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_JobStarted.wait(lock, [&] { return m_IsStopping || m_JobIdx != lastJobIdx; });
+				if (m_IsStopping) return;
+				lastJobIdx = m_JobIdx;
+			}
+
+			RunTasks(threadIdx);
+
+			std::lock_guard lock{ m_Mutex };
+			if (--m_BusyWorkers == 0) m_JobFinished.notify_one();
+		}
+	}
+
+	void ThreadPool::RunTasks(uint32_t threadIdx)
+	{
+		const std::function<void(uint32_t)>& task{ *m_pTask };
+		TaskQueue& queue{ m_pQueues[threadIdx] };
+
+		uint32_t taskIdx{};
+		while (true)
+		{
+			if (!PopFront(queue, taskIdx))
+			{
+				//a thief may empty the stolen range again before this thread gets to it
+				if (Steal(threadIdx)) continue;
+				return;
+			}
+
+			const auto startTime{ std::chrono::steady_clock::now() };
+			task(taskIdx);
+			queue.stats.busyTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+			++queue.stats.taskCount;
+		}
+	}
+
+	bool ThreadPool::PopFront(TaskQueue& queue, uint32_t& taskIdx)
+	{
+		//the indices are the only data the queues share, the job itself was published under the mutex
+		uint64_t tasks{ queue.tasks.load(std::memory_order_relaxed) };
+		while (true)
+		{
+			const uint32_t front{ uint32_t(tasks) }, back{ uint32_t(tasks >> 32) };
+			if (front >= back) return false;
+
+			if (queue.tasks.compare_exchange_weak(tasks, PackTasks(front + 1, back), std::memory_order_relaxed))
+			{
+				taskIdx = front;
+				return true;
+			}
+		}
+	}
+
+	bool ThreadPool::Steal(uint32_t threadIdx)
+	{
+		const uint32_t threadCount{ GetThreadCount() };
+		for (uint32_t offset{ 1 }; offset < threadCount; ++offset)
+		{
+			TaskQueue& victim{ m_pQueues[(threadIdx + offset) % threadCount] };
+			uint64_t tasks{ victim.tasks.load(std::memory_order_relaxed) };
+			while (true)
+			{
+				const uint32_t front{ uint32_t(tasks) }, back{ uint32_t(tasks >> 32) };
+				if (front >= back) break;
+
+				//the back half is the farthest from what the owner works on, the last task goes to whoever gets it first
+				const uint32_t newBack{ back - (back - front + 1) / 2 };
+				if (victim.tasks.compare_exchange_weak(tasks, PackTasks(front, newBack), std::memory_order_relaxed))
+				{
+					//the own queue is empty, the other thieves leave it alone until this store
+					TaskQueue& queue{ m_pQueues[threadIdx] };
+					queue.tasks.store(PackTasks(newBack, back), std::memory_order_relaxed);
+					queue.stats.stolenTaskCount += back - newBack;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+}
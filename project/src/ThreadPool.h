@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//What one thread of the pool did during a job
+	struct ThreadStats
+	{
+		float busyTime{}; //milliseconds spent running tasks
+		float idleTime{}; //milliseconds of the job the thread spent waking up, stealing or waiting for the others
+		uint32_t taskCount{};
+		uint32_t stolenTaskCount{}; //tasks taken from the queues of other threads, included in taskCount
+	};
+
+	//Worker threads that live as long as the pool and sleep between jobs. A job is a range of task indices that is split
+	//into one contiguous queue per thread, the calling thread included. Every thread runs its own queue front to back, a
+	//thread that runs dry steals the back half of another queue, so cheap and expensive tasks even out at the end of a job
+	//while each thread keeps working on neighbouring indices.
+	class ThreadPool final
+	{
+	public:
+		/**
+		 * \param threadCount Threads running every job, the calling thread included. 0 uses one per hardware thread
+		 */
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Runs task(index) once for every index in [0, taskCount) and returns when all of them are done.
+		 * Only one thread at a time may call it, tasks must not call it themselves.
+		 */
+		void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task);
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+		//one entry per thread of the last job, the calling thread first
+		const std::vector<ThreadStats>& GetJobStats() const { return m_JobStats; }
+
+	private:
+		//the task indices a thread has left, its own cache line so the threads don't fight over each other's queues
+		struct alignas(64) TaskQueue
+		{
+			std::atomic<uint64_t> tasks{}; //[front, back) packed as front | back << 32, so one compare exchange pops or steals
+			ThreadStats stats{};
+		};
+
+		std::vector<std::thread> m_Workers{};
+		std::unique_ptr<TaskQueue[]> m_pQueues{};
+		std::vector<ThreadStats> m_JobStats{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_JobStarted{};
+		std::condition_variable m_JobFinished{};
+
+		//the current job, written under the mutex before the workers are woken
+		const std::function<void(uint32_t)>* m_pTask{};
+		uint32_t m_JobIdx{}; //bumped by every job, so a waking worker knows it hasn't run this one yet
+		uint32_t m_BusyWorkers{};
+		bool m_IsStopping{};
+
+		void WorkerLoop(uint32_t threadIdx);
+		//runs the queue of the thread, then steals from the others until every queue is empty
+		void RunTasks(uint32_t threadIdx);
+		bool PopFront(TaskQueue& queue, uint32_t& taskIdx);
+		//moves the back half of the first non-empty queue after the thread's own into it
+		bool Steal(uint32_t threadIdx);
+	};
+}
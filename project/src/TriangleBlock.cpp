@@ -0,0 +1,61 @@
+#include "TriangleBlock.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	template<int Width>
+	void TriangleBlocks<Width>::Build(const BVH& bvh, const std::vector<TriangleRecord>& triangleRecords)
+	{
+		Clear();
+		if (bvh.IsEmpty()) return;
+
+		const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+		const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+		m_LeafFirstBlock.resize(primitiveIndices.size());
+
+		for (const BVHNode& node : nodes)
+		{
+			if (!node.IsLeaf()) continue;
+
+			m_LeafFirstBlock[node.leftFirst] = static_cast<uint32_t>(m_Blocks.size());
+			for (uint32_t blockStart{}; blockStart < node.primitiveCount; blockStart += Width)
+			{
+				//zeroed lanes have no edges, so their determinant fails the parallel test
+				TriangleBlock<Width>& block{ m_Blocks.emplace_back(TriangleBlock<Width>{}) };
+				block.count = std::min(node.primitiveCount - blockStart, static_cast<uint32_t>(Width));
+
+				for (uint32_t lane{}; lane < block.count; ++lane)
+				{
+					const uint32_t triangleIdx{ primitiveIndices[node.leftFirst + blockStart + lane] };
+					const TriangleRecord& record{ triangleRecords[triangleIdx] };
+
+					block.v0X[lane] = record.v0.x;
+					block.v0Y[lane] = record.v0.y;
+					block.v0Z[lane] = record.v0.z;
+					block.edge1X[lane] = record.edge1.x;
+					block.edge1Y[lane] = record.edge1.y;
+					block.edge1Z[lane] = record.edge1.z;
+					block.edge2X[lane] = record.edge2.x;
+					block.edge2Y[lane] = record.edge2.y;
+					block.edge2Z[lane] = record.edge2.z;
+					block.normalX[lane] = record.normal.x;
+					block.normalY[lane] = record.normal.y;
+					block.normalZ[lane] = record.normal.z;
+					block.minDeterminant[lane] = record.minDeterminant;
+					block.triangleIdx[lane] = triangleIdx;
+				}
+			}
+		}
+	}
+
+	template<int Width>
+	void TriangleBlocks<Width>::Clear()
+	{
+		m_Blocks.clear();
+		m_LeafFirstBlock.clear();
+	}
+
+	template class TriangleBlocks<4>;
+	template class TriangleBlocks<8>;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "BVH.h"
+#include "CpuDispatch.h"
+
+namespace dae
+{
+	//Intersection-ready copy of a transformed mesh triangle, laid out so the kernel reads one contiguous record
+	//instead of gathering three positions through the index buffer and rebuilding the edges per ray.
+	struct TriangleRecord
+	{
+		Vector3 v0{};
+		Vector3 edge1{}; //v1 - v0
+		Vector3 edge2{}; //v2 - v0
+		Vector3 normal{}; //normalized, drives culling and shading
+		float minDeterminant{}; //determinants at or below this count as parallel, FLT_EPSILON * |edge1| * |edge2|
+
+		static TriangleRecord Create(const Vector3& v0, const Vector3& edge1, const Vector3& edge2, const Vector3& normal)
+		{
+			return TriangleRecord{ v0, edge1, edge2, normal, FLT_EPSILON * std::sqrt(edge1.SqrMagnitude() * edge2.SqrMagnitude()) };
+		}
+	};
+
+	enum class TriangleLayout
+	{
+		Single, //one TriangleRecord per test
+		Block4, //BVH leaves packed into blocks of four triangles, tested with one SSE pass
+		Block8 //blocks of eight triangles, tested with one AVX2 pass (two SSE passes on older CPUs)
+	};
+
+	//Width triangles stored as structure of arrays so one ray is tested against all of them at once.
+	//Lanes past count hold zeroed (degenerate) triangles that never hit.
+	template<int Width>
+	struct alignas(32) TriangleBlock
+	{
+		float v0X[Width];
+		float v0Y[Width];
+		float v0Z[Width];
+		float edge1X[Width];
+		float edge1Y[Width];
+		float edge1Z[Width];
+		float edge2X[Width];
+		float edge2Y[Width];
+		float edge2Z[Width];
+		float normalX[Width];
+		float normalY[Width];
+		float normalZ[Width];
+		float minDeterminant[Width]; //TriangleRecord::minDeterminant, zero in the padded lanes
+
+		uint32_t triangleIdx[Width];
+		uint32_t count;
+	};
+
+	//Triangles of every BVH leaf packed into consecutive blocks, so leaves hold blocks instead of single triangles.
+	//Leaves are looked up by their first primitive index, which wide hierarchies collapsed from the same BVH share.
+	template<int Width>
+	class TriangleBlocks final
+	{
+	public:
+		static_assert(Width == 4 || Width == 8, "TriangleBlocks only supports 4 and 8 wide blocks");
+
+		void Build(const BVH& bvh, const std::vector<TriangleRecord>& triangleRecords);
+		void Clear();
+
+		bool IsEmpty() const { return m_Blocks.empty(); }
+		const std::vector<TriangleBlock<Width>>& GetBlocks() const { return m_Blocks; }
+		uint32_t GetLeafFirstBlock(uint32_t firstPrimitive) const { return m_LeafFirstBlock[firstPrimitive]; }
+		static uint32_t GetBlockCount(uint32_t primitiveCount) { return (primitiveCount + Width - 1) / Width; }
+
+		/**
+		 * \brief Moller-Trumbore test of one ray against every triangle of a block
+		 * \param cullSign Lanes whose normal dot direction has this sign are culled: 1 culls back faces, -1 front faces, 0 nothing
+		 * \param distances Receives the hit distance of every lane, only valid for lanes in the returned mask
+		 * \return Bitmask of the triangles hit within [tMin, tMax]
+		 */
+		static int Intersect(const TriangleBlock<Width>& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances);
+
+	private:
+		std::vector<TriangleBlock<Width>> m_Blocks{};
+		std::vector<uint32_t> m_LeafFirstBlock{};
+	};
+
+	template<int Width>
+	inline int TriangleBlocks<Width>::Intersect(const TriangleBlock<Width>& block, const Vector3& origin, const Vector3& direction, float tMin, float tMax, float cullSign, float* distances)
+	{
+		if constexpr (Width == 4) return Dispatch::GetKernels().intersectTriangleBlock4(block, origin, direction, tMin, tMax, cullSign, distances);
+		else return Dispatch::GetKernels().intersectTriangleBlock8(block, origin, direction, tMin, tMax, cullSign, distances);
+	}
+}
\ No newline at end of file
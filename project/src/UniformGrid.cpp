@@ -0,0 +1,87 @@
+#include "UniformGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace dae
+{
+	void UniformGrid::Build(const std::vector<AABB>& primitiveBounds)
+	{
+		const auto startTime{ std::chrono::high_resolution_clock::now() };
+
+		Clear();
+		if (primitiveBounds.empty()) return;
+
+		for (const AABB& bounds : primitiveBounds)
+		{
+			m_Bounds.Grow(bounds);
+		}
+
+		//pick a cubic cell size that gives about m_CellsPerPrimitive cells per primitive over the grid volume,
+		//flat axes get a small thickness so the volume never collapses to zero
+		const Vector3 extent{ m_Bounds.max - m_Bounds.min };
+		const float maxExtent{ std::max({ extent.x, extent.y, extent.z, FLT_MIN }) };
+		const Vector3 paddedExtent{ std::max(extent.x, maxExtent * 1e-3f), std::max(extent.y, maxExtent * 1e-3f), std::max(extent.z, maxExtent * 1e-3f) };
+
+		const float volume{ paddedExtent.x * paddedExtent.y * paddedExtent.z };
+		const float cellsPerUnit{ std::cbrt(m_CellsPerPrimitive * primitiveBounds.size() / volume) };
+
+		for (int axis{}; axis < 3; ++axis)
+		{
+			m_Resolution[axis] = std::clamp(static_cast<int>(std::ceil(paddedExtent[axis] * cellsPerUnit)), 1, MaxResolution);
+			m_CellSize[axis] = paddedExtent[axis] / m_Resolution[axis];
+			m_InvCellSize[axis] = 1.f / m_CellSize[axis];
+		}
+		m_Bounds.max = m_Bounds.min + paddedExtent;
+
+		//count the primitives per cell first, then turn the counts into offsets and fill them in
+		const size_t cellCount{ static_cast<size_t>(m_Resolution[0]) * m_Resolution[1] * m_Resolution[2] };
+		m_CellStarts.assign(cellCount + 1, 0);
+
+		int minCell[3]{}, maxCell[3]{};
+		for (const AABB& bounds : primitiveBounds)
+		{
+			GetCellRange(bounds, minCell, maxCell);
+			for (int z{ minCell[2] }; z <= maxCell[2]; ++z)
+				for (int y{ minCell[1] }; y <= maxCell[1]; ++y)
+					for (int x{ minCell[0] }; x <= maxCell[0]; ++x)
+						++m_CellStarts[GetCellIndex(x, y, z) + 1];
+		}
+
+		for (size_t cellIdx{}; cellIdx < cellCount; ++cellIdx)
+		{
+			m_CellStarts[cellIdx + 1] += m_CellStarts[cellIdx];
+		}
+
+		m_PrimitiveIndices.resize(m_CellStarts[cellCount]);
+		std::vector<uint32_t> cellFill(m_CellStarts.begin(), m_CellStarts.end() - 1);
+		for (uint32_t primitiveIdx{}; primitiveIdx < primitiveBounds.size(); ++primitiveIdx)
+		{
+			GetCellRange(primitiveBounds[primitiveIdx], minCell, maxCell);
+			for (int z{ minCell[2] }; z <= maxCell[2]; ++z)
+				for (int y{ minCell[1] }; y <= maxCell[1]; ++y)
+					for (int x{ minCell[0] }; x <= maxCell[0]; ++x)
+						m_PrimitiveIndices[cellFill[GetCellIndex(x, y, z)]++] = primitiveIdx;
+		}
+
+		m_BuildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void UniformGrid::Clear()
+	{
+		m_Bounds = AABB{};
+		m_Resolution[0] = m_Resolution[1] = m_Resolution[2] = 0;
+		m_CellStarts.clear();
+		m_PrimitiveIndices.clear();
+	}
+
+	void UniformGrid::GetCellRange(const AABB& bounds, int minCell[3], int maxCell[3]) const
+	{
+		for (int axis{}; axis < 3; ++axis)
+		{
+			minCell[axis] = std::clamp(static_cast<int>((bounds.min[axis] - m_Bounds.min[axis]) * m_InvCellSize[axis]), 0, m_Resolution[axis] - 1);
+			maxCell[axis] = std::clamp(static_cast<int>((bounds.max[axis] - m_Bounds.min[axis]) * m_InvCellSize[axis]), 0, m_Resolution[axis] - 1);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BVH.h"
+
+namespace dae
+{
+	//Uniform grid over a list of primitive bounds, every cell lists the primitives whose bounds overlap it.
+	//Cells are stored compressed: the primitives of cell i are m_PrimitiveIndices[m_CellStarts[i], m_CellStarts[i + 1]).
+	//Suits many small primitives of similar size (particles, point clouds), traversal (3D-DDA) lives in Utils.h.
+	class UniformGrid final
+	{
+	public:
+		//resolution is picked so the grid has about this many cells per primitive (Wald et al. 2006)
+		static constexpr float DefaultCellsPerPrimitive{ 3.f };
+		static constexpr int MaxResolution{ 256 };
+
+		void Build(const std::vector<AABB>& primitiveBounds);
+		void Clear();
+
+		void SetCellsPerPrimitive(float cellsPerPrimitive) { m_CellsPerPrimitive = cellsPerPrimitive; }
+
+		bool IsEmpty() const { return m_CellStarts.empty(); }
+		const AABB& GetBounds() const { return m_Bounds; }
+		const int* GetResolution() const { return m_Resolution; }
+		const Vector3& GetCellSize() const { return m_CellSize; }
+		const Vector3& GetInvCellSize() const { return m_InvCellSize; }
+
+		uint32_t GetCellIndex(int x, int y, int z) const { return static_cast<uint32_t>((z * m_Resolution[1] + y) * m_Resolution[0] + x); }
+		const std::vector<uint32_t>& GetCellStarts() const { return m_CellStarts; }
+		const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+		//bytes used by the cell and primitive lists
+		size_t GetMemoryUsage() const { return (m_CellStarts.capacity() + m_PrimitiveIndices.capacity()) * sizeof(uint32_t); }
+		//wall clock time of the last build in milliseconds
+		float GetBuildTime() const { return m_BuildTime; }
+
+	private:
+		void GetCellRange(const AABB& bounds, int minCell[3], int maxCell[3]) const;
+
+		AABB m_Bounds{};
+		int m_Resolution[3]{};
+		Vector3 m_CellSize{};
+		Vector3 m_InvCellSize{};
+
+		std::vector<uint32_t> m_CellStarts{};
+		std::vector<uint32_t> m_PrimitiveIndices{};
+
+		float m_CellsPerPrimitive{ DefaultCellsPerPrimitive };
+		float m_BuildTime{};
+	};
+}
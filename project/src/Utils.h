@@ -1,7 +1,10 @@
 #pragma once
+#include <bit>
 #include <fstream>
 #include "Maths.h"
 #include "DataTypes.h"
+#include "RayPacket.h"
+#include "UniformGrid.h"
 
 namespace dae
 {
@@ -14,10 +17,10 @@ namespace dae
 			//done week 1
 			const Vector3 L{ ray.origin - sphere.origin };
 			const float B{ Vector3::Dot((ray.direction), L) };
-			const float C{ (Vector3::Dot(L, L)) - (sphere.radius * sphere.radius) };
 
-			//calculate discriminant
-			const float discriminant{ Square(B) - C };
+			//calculate discriminant, r^2 - |L - B*d|^2 equals B^2 - C but does not cancel catastrophically far from the sphere
+			const Vector3 closestOffset{ L - B * ray.direction };
+			const float discriminant{ sphere.radius * sphere.radius - Vector3::Dot(closestOffset, closestOffset) };
 
 			if (discriminant < 0) return false;
 
@@ -148,6 +151,670 @@ namespace dae
 			return HitTest_Triangle(triangle, ray, temp, true);
 		}
 #pragma endregion
+#pragma region BVH Traversal
+		/**
+		 * \brief Slab test of a ray against the bounds of a BVH node
+		 * \param invDirection Component-wise inverse of the ray direction
+		 * \return Entry distance along the ray, FLT_MAX when the node is missed or lies outside [ray.min, ray.max]
+		 */
+		inline float SlabTest_BVHNode(const BVHNode& node, const Ray& ray, const Vector3& invDirection)
+		{
+			// X
+			const float tx1 = (node.minAABB.x - ray.origin.x) * invDirection.x;
+			const float tx2 = (node.maxAABB.x - ray.origin.x) * invDirection.x;
+
+			float tmin = std::min(tx1, tx2);
+			float tmax = std::max(tx1, tx2);
+
+			// Y
+			const float ty1 = (node.minAABB.y - ray.origin.y) * invDirection.y;
+			const float ty2 = (node.maxAABB.y - ray.origin.y) * invDirection.y;
+
+			tmin = std::max(tmin, std::min(ty1, ty2));
+			tmax = std::min(tmax, std::max(ty1, ty2));
+
+			// Z
+			const float tz1 = (node.minAABB.z - ray.origin.z) * invDirection.z;
+			const float tz2 = (node.maxAABB.z - ray.origin.z) * invDirection.z;
+
+			tmin = std::max(tmin, std::min(tz1, tz2));
+			tmax = std::min(tmax, std::max(tz1, tz2));
+
+			if (tmax >= tmin && tmax >= ray.min && tmin <= ray.max) return tmin;
+			return FLT_MAX;
+		}
+
+		/**
+		 * \brief Walks a BVH front-to-back and hands every visited leaf to intersectLeaf
+		 * \param ray Ray to trace, intersectLeaf shrinks ray.max when it finds a closer hit
+		 * \param intersectLeaf bool(uint32_t firstPrimitive, uint32_t primitiveCount, Ray& ray), the leaf covers that range of bvh.GetPrimitiveIndices()
+		 * \param anyHit Stop at the first hit instead of searching for the closest one
+		 * \param pStats Optional counters for visited nodes and tested primitives
+		 * \return true if any leaf reported a hit
+		 */
+		template<typename IntersectLeaf>
+		inline bool TraverseBVHLeaves(const BVH& bvh, Ray& ray, IntersectLeaf&& intersectLeaf, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+			if (nodes.empty()) return false;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			if (SlabTest_BVHNode(nodes[0], ray, invDirection) == FLT_MAX) return false;
+
+			//nodes still to visit, with their entry distance so they can be skipped once a closer hit is known
+			uint32_t nodeStack[BVH::MaxDepth];
+			float distanceStack[BVH::MaxDepth];
+			uint32_t stackSize{};
+
+			uint32_t nodeIdx{};
+			bool didHit{};
+			while (true)
+			{
+				const BVHNode& node{ nodes[nodeIdx] };
+				if (pStats) ++pStats->nodeVisits;
+
+				if (node.IsLeaf())
+				{
+					if (pStats) pStats->primitiveTests += node.primitiveCount;
+
+					if (intersectLeaf(node.leftFirst, node.primitiveCount, ray))
+					{
+						didHit = true;
+						if (anyHit) return true;
+					}
+				}
+				else
+				{
+					uint32_t nearIdx{ node.leftFirst };
+					uint32_t farIdx{ node.leftFirst + 1 };
+					float nearDistance{ SlabTest_BVHNode(nodes[nearIdx], ray, invDirection) };
+					float farDistance{ SlabTest_BVHNode(nodes[farIdx], ray, invDirection) };
+
+					if (farDistance < nearDistance)
+					{
+						std::swap(nearIdx, farIdx);
+						std::swap(nearDistance, farDistance);
+					}
+
+					if (nearDistance != FLT_MAX)
+					{
+						if (farDistance != FLT_MAX)
+						{
+							nodeStack[stackSize] = farIdx;
+							distanceStack[stackSize] = farDistance;
+							++stackSize;
+						}
+
+						nodeIdx = nearIdx;
+						continue;
+					}
+				}
+
+				//pop the next node that still starts in front of the closest hit
+				bool foundNode{};
+				while (stackSize > 0)
+				{
+					--stackSize;
+					if (distanceStack[stackSize] <= ray.max)
+					{
+						nodeIdx = nodeStack[stackSize];
+						foundNode = true;
+						break;
+					}
+				}
+
+				if (!foundNode) break;
+			}
+
+			return didHit;
+		}
+
+		//hands a leaf range of primitive indices to intersectPrimitive one by one
+		template<typename IntersectPrimitive>
+		inline bool IntersectPrimitives(const std::vector<uint32_t>& primitiveIndices, uint32_t firstPrimitive, uint32_t primitiveCount, Ray& ray, IntersectPrimitive& intersectPrimitive, bool anyHit)
+		{
+			bool didHit{};
+			for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+			{
+				if (intersectPrimitive(primitiveIndices[idx], ray))
+				{
+					didHit = true;
+					if (anyHit) break;
+				}
+			}
+			return didHit;
+		}
+
+		/**
+		 * \brief Walks a BVH front-to-back and hands every primitive in a visited leaf to intersectPrimitive
+		 * \param ray Ray to trace, intersectPrimitive shrinks ray.max when it finds a closer hit
+		 * \param intersectPrimitive bool(uint32_t primitiveIdx, Ray& ray), returns true on a hit
+		 * \param anyHit Stop at the first hit instead of searching for the closest one
+		 * \param pStats Optional counters for visited nodes and tested primitives
+		 * \return true if any primitive was hit
+		 */
+		template<typename IntersectPrimitive>
+		inline bool TraverseBVH(const BVH& bvh, Ray& ray, IntersectPrimitive&& intersectPrimitive, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+			return TraverseBVHLeaves(bvh, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& currentRay)
+				{
+					return IntersectPrimitives(primitiveIndices, firstPrimitive, primitiveCount, currentRay, intersectPrimitive, anyHit);
+				}, anyHit, pStats);
+		}
+
+		/**
+		 * \brief TraverseBVHLeaves for collapsed 4/8-wide hierarchies, all children of a node are slab tested at once
+		 * \param intersectLeaf bool(uint32_t firstPrimitive, uint32_t primitiveCount, Ray& ray), returns true on a hit
+		 * \return true if any leaf reported a hit
+		 */
+		template<int Width, typename IntersectLeaf>
+		inline bool TraverseWideBVHLeaves(const WideBVH<Width>& bvh, Ray& ray, IntersectLeaf&& intersectLeaf, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<WideBVHNode<Width>>& nodes{ bvh.GetNodes() };
+			if (nodes.empty()) return false;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			uint32_t nodeStack[WideBVH<Width>::StackSize];
+			float distanceStack[WideBVH<Width>::StackSize];
+			uint32_t stackSize{};
+
+			uint32_t nodeIdx{};
+			bool didHit{};
+			while (true)
+			{
+				const WideBVHNode<Width>& node{ nodes[nodeIdx] };
+				if (pStats) ++pStats->nodeVisits;
+
+				alignas(32) float distances[Width];
+				int hitMask{ WideBVH<Width>::IntersectChildren(node, ray.origin, invDirection, ray.min, ray.max, distances) };
+
+				//sort the hit children near to far
+				uint32_t order[Width];
+				uint32_t hitCount{};
+				while (hitMask)
+				{
+					const uint32_t slot{ static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(hitMask))) };
+					hitMask &= hitMask - 1;
+
+					uint32_t insertIdx{ hitCount++ };
+					while (insertIdx > 0 && distances[order[insertIdx - 1]] > distances[slot])
+					{
+						order[insertIdx] = order[insertIdx - 1];
+						--insertIdx;
+					}
+					order[insertIdx] = slot;
+				}
+
+				//leaves are intersected right away, front-to-back so ray.max shrinks as early as possible
+				for (uint32_t orderIdx{}; orderIdx < hitCount; ++orderIdx)
+				{
+					const uint32_t slot{ order[orderIdx] };
+					if (node.primitiveCount[slot] == 0 || distances[slot] > ray.max) continue;
+					if (pStats) pStats->primitiveTests += node.primitiveCount[slot];
+
+					if (intersectLeaf(node.child[slot], node.primitiveCount[slot], ray))
+					{
+						didHit = true;
+						if (anyHit) return true;
+					}
+				}
+
+				//interior children are pushed far to near so the nearest one is popped first
+				for (uint32_t orderIdx{ hitCount }; orderIdx > 0; --orderIdx)
+				{
+					const uint32_t slot{ order[orderIdx - 1] };
+					if (node.primitiveCount[slot] != 0) continue;
+
+					nodeStack[stackSize] = node.child[slot];
+					distanceStack[stackSize] = distances[slot];
+					++stackSize;
+				}
+
+				//pop the next node that still starts in front of the closest hit
+				bool foundNode{};
+				while (stackSize > 0)
+				{
+					--stackSize;
+					if (distanceStack[stackSize] <= ray.max)
+					{
+						nodeIdx = nodeStack[stackSize];
+						foundNode = true;
+						break;
+					}
+				}
+
+				if (!foundNode) break;
+			}
+
+			return didHit;
+		}
+
+		/**
+		 * \brief TraverseBVH for collapsed 4/8-wide hierarchies, all children of a node are slab tested at once
+		 * \param intersectPrimitive bool(uint32_t primitiveIdx, Ray& ray), returns true on a hit
+		 * \return true if any primitive was hit
+		 */
+		template<int Width, typename IntersectPrimitive>
+		inline bool TraverseWideBVH(const WideBVH<Width>& bvh, Ray& ray, IntersectPrimitive&& intersectPrimitive, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+			return TraverseWideBVHLeaves(bvh, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& currentRay)
+				{
+					return IntersectPrimitives(primitiveIndices, firstPrimitive, primitiveCount, currentRay, intersectPrimitive, anyHit);
+				}, anyHit, pStats);
+		}
+
+		/**
+		 * \brief Any-hit walk of a BVH for shadow rays, children are visited in any order and the walk stops at the first occluder
+		 * \param occludedLeaf bool(uint32_t firstPrimitive, uint32_t primitiveCount), returns true if anything in the leaf blocks the ray
+		 * \param pStats Optional counters for visited nodes and tested primitives
+		 * \return true if any leaf blocks the ray
+		 */
+		template<typename OccludedLeaf>
+		inline bool OccludedBVHLeaves(const BVH& bvh, const Ray& ray, OccludedLeaf&& occludedLeaf, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+			if (nodes.empty()) return false;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			if (SlabTest_BVHNode(nodes[0], ray, invDirection) == FLT_MAX) return false;
+
+			//ray.max never shrinks, so there is no need to order children or remember their distance
+			uint32_t nodeStack[BVH::MaxDepth + 1];
+			uint32_t stackSize{};
+			nodeStack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ nodes[nodeStack[--stackSize]] };
+				if (pStats) ++pStats->nodeVisits;
+
+				if (node.IsLeaf())
+				{
+					if (pStats) pStats->primitiveTests += node.primitiveCount;
+					if (occludedLeaf(node.leftFirst, node.primitiveCount)) return true;
+					continue;
+				}
+
+				for (uint32_t childIdx{ node.leftFirst }; childIdx < node.leftFirst + 2; ++childIdx)
+				{
+					if (SlabTest_BVHNode(nodes[childIdx], ray, invDirection) != FLT_MAX) nodeStack[stackSize++] = childIdx;
+				}
+			}
+
+			return false;
+		}
+
+		//any-hit counterpart of IntersectPrimitives
+		template<typename OccludedPrimitive>
+		inline bool OccludedPrimitives(const std::vector<uint32_t>& primitiveIndices, uint32_t firstPrimitive, uint32_t primitiveCount, OccludedPrimitive& occludedPrimitive)
+		{
+			for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+			{
+				if (occludedPrimitive(primitiveIndices[idx])) return true;
+			}
+			return false;
+		}
+
+		/**
+		 * \brief Any-hit walk of a BVH for shadow rays, children are visited in any order and the walk stops at the first occluder
+		 * \param occludedPrimitive bool(uint32_t primitiveIdx), returns true if the primitive blocks the ray
+		 * \param pStats Optional counters for visited nodes and tested primitives
+		 * \return true if any primitive blocks the ray
+		 */
+		template<typename OccludedPrimitive>
+		inline bool OccludedBVH(const BVH& bvh, const Ray& ray, OccludedPrimitive&& occludedPrimitive, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+			return OccludedBVHLeaves(bvh, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount)
+				{
+					return OccludedPrimitives(primitiveIndices, firstPrimitive, primitiveCount, occludedPrimitive);
+				}, pStats);
+		}
+
+		//OccludedBVHLeaves for collapsed 4/8-wide hierarchies
+		template<int Width, typename OccludedLeaf>
+		inline bool OccludedWideBVHLeaves(const WideBVH<Width>& bvh, const Ray& ray, OccludedLeaf&& occludedLeaf, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<WideBVHNode<Width>>& nodes{ bvh.GetNodes() };
+			if (nodes.empty()) return false;
+
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			uint32_t nodeStack[WideBVH<Width>::StackSize];
+			uint32_t stackSize{};
+			nodeStack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const WideBVHNode<Width>& node{ nodes[nodeStack[--stackSize]] };
+				if (pStats) ++pStats->nodeVisits;
+
+				alignas(32) float distances[Width];
+				int hitMask{ WideBVH<Width>::IntersectChildren(node, ray.origin, invDirection, ray.min, ray.max, distances) };
+				while (hitMask)
+				{
+					const uint32_t slot{ static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(hitMask))) };
+					hitMask &= hitMask - 1;
+
+					if (node.primitiveCount[slot] == 0)
+					{
+						nodeStack[stackSize++] = node.child[slot];
+						continue;
+					}
+
+					if (pStats) pStats->primitiveTests += node.primitiveCount[slot];
+					if (occludedLeaf(node.child[slot], node.primitiveCount[slot])) return true;
+				}
+			}
+
+			return false;
+		}
+
+		//OccludedBVH for collapsed 4/8-wide hierarchies
+		template<int Width, typename OccludedPrimitive>
+		inline bool OccludedWideBVH(const WideBVH<Width>& bvh, const Ray& ray, OccludedPrimitive&& occludedPrimitive, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ bvh.GetPrimitiveIndices() };
+			return OccludedWideBVHLeaves(bvh, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount)
+				{
+					return OccludedPrimitives(primitiveIndices, firstPrimitive, primitiveCount, occludedPrimitive);
+				}, pStats);
+		}
+#pragma endregion
+#pragma region Grid Traversal
+		/**
+		 * \brief Walks the cells of a uniform grid along the ray (3D-DDA) and hands every visited cell to intersectCell
+		 * \param ray Ray to trace, intersectCell shrinks ray.max when it finds a closer hit
+		 * \param intersectCell bool(uint32_t firstPrimitive, uint32_t primitiveCount, Ray& ray), the cell covers that range of grid.GetPrimitiveIndices()
+		 * \param anyHit Stop at the first hit instead of searching for the closest one
+		 * \param pStats Optional counters, every visited cell counts as a node visit
+		 * \return true if any cell reported a hit
+		 */
+		template<typename IntersectCell>
+		inline bool TraverseGridCells(const UniformGrid& grid, Ray& ray, IntersectCell&& intersectCell, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			if (grid.IsEmpty()) return false;
+
+			const AABB& bounds{ grid.GetBounds() };
+			const int* resolution{ grid.GetResolution() };
+			const Vector3& cellSize{ grid.GetCellSize() };
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			//clip the ray against the grid bounds
+			float tEnter{ ray.min };
+			float tExit{ ray.max };
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float t1{ (bounds.min[axis] - ray.origin[axis]) * invDirection[axis] };
+				const float t2{ (bounds.max[axis] - ray.origin[axis]) * invDirection[axis] };
+				tEnter = std::max(tEnter, std::min(t1, t2));
+				tExit = std::min(tExit, std::max(t1, t2));
+			}
+			if (tEnter > tExit) return false;
+
+			//start cell, step direction and distance to the next cell border on every axis
+			const Vector3 entryPoint{ ray.origin + ray.direction * tEnter };
+			int cell[3]{}, step[3]{}, end[3]{};
+			float tNext[3]{}, tDelta[3]{};
+			for (int axis{}; axis < 3; ++axis)
+			{
+				cell[axis] = std::clamp(static_cast<int>((entryPoint[axis] - bounds.min[axis]) * grid.GetInvCellSize()[axis]), 0, resolution[axis] - 1);
+
+				if (ray.direction[axis] > 0.f)
+				{
+					step[axis] = 1;
+					end[axis] = resolution[axis];
+					tNext[axis] = (bounds.min[axis] + (cell[axis] + 1) * cellSize[axis] - ray.origin[axis]) * invDirection[axis];
+					tDelta[axis] = cellSize[axis] * invDirection[axis];
+				}
+				else if (ray.direction[axis] < 0.f)
+				{
+					step[axis] = -1;
+					end[axis] = -1;
+					tNext[axis] = (bounds.min[axis] + cell[axis] * cellSize[axis] - ray.origin[axis]) * invDirection[axis];
+					tDelta[axis] = -cellSize[axis] * invDirection[axis];
+				}
+				else
+				{
+					end[axis] = -1;
+					tNext[axis] = FLT_MAX;
+					tDelta[axis] = FLT_MAX;
+				}
+			}
+
+			const std::vector<uint32_t>& cellStarts{ grid.GetCellStarts() };
+
+			bool didHit{};
+			while (true)
+			{
+				const int axis{ tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2) };
+				const float cellExit{ tNext[axis] };
+
+				const uint32_t cellIdx{ grid.GetCellIndex(cell[0], cell[1], cell[2]) };
+				if (pStats)
+				{
+					++pStats->nodeVisits;
+					pStats->primitiveTests += cellStarts[cellIdx + 1] - cellStarts[cellIdx];
+				}
+
+				const uint32_t primitiveCount{ cellStarts[cellIdx + 1] - cellStarts[cellIdx] };
+				if (primitiveCount > 0 && intersectCell(cellStarts[cellIdx], primitiveCount, ray))
+				{
+					didHit = true;
+					if (anyHit) return true;
+				}
+
+				//a hit always lies inside the bounds of its primitive, so no cell further along can hold a closer one
+				if (ray.max <= cellExit || cellExit >= tExit) break;
+
+				cell[axis] += step[axis];
+				if (cell[axis] == end[axis]) break;
+				tNext[axis] += tDelta[axis];
+			}
+
+			return didHit;
+		}
+
+		/**
+		 * \brief Walks the cells of a uniform grid along the ray (3D-DDA) and hands every primitive in a visited cell to intersectPrimitive
+		 * \param ray Ray to trace, intersectPrimitive shrinks ray.max when it finds a closer hit
+		 * \param intersectPrimitive bool(uint32_t primitiveIdx, Ray& ray), returns true on a hit
+		 * \param anyHit Stop at the first hit instead of searching for the closest one
+		 * \param pStats Optional counters, every visited cell counts as a node visit
+		 * \return true if any primitive was hit
+		 */
+		template<typename IntersectPrimitive>
+		inline bool TraverseGrid(const UniformGrid& grid, Ray& ray, IntersectPrimitive&& intersectPrimitive, bool anyHit = false, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ grid.GetPrimitiveIndices() };
+			return TraverseGridCells(grid, ray, [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& currentRay)
+				{
+					return IntersectPrimitives(primitiveIndices, firstPrimitive, primitiveCount, currentRay, intersectPrimitive, anyHit);
+				}, anyHit, pStats);
+		}
+#pragma endregion
+#pragma region TriangleRecord HitTest
+		/**
+		 * \brief Moller-Trumbore distance to a precomputed triangle, culling is left to the caller
+		 * \param t Distance along the ray, only valid when true is returned
+		 * \return true if the ray crosses the triangle within [ray.min, ray.max]
+		 */
+		inline bool Intersect_TriangleRecord(const TriangleRecord& triangle, const Ray& ray, float& t)
+		{
+			const Vector3 p{ Vector3::Cross(ray.direction, triangle.edge2) };
+			const float determinant{ Vector3::Dot(triangle.edge1, p) };
+
+			//ray is parallel to triangle, relative to the edge lengths so small triangles still get hit
+			if (std::abs(determinant) <= triangle.minDeterminant) return false;
+
+			const float invDeterminant{ 1.f / determinant };
+			const Vector3 toOrigin{ ray.origin - triangle.v0 };
+
+			const float u{ Vector3::Dot(toOrigin, p) * invDeterminant };
+			if (u < 0.f || u > 1.f) return false;
+
+			const Vector3 q{ Vector3::Cross(toOrigin, triangle.edge1) };
+			const float v{ Vector3::Dot(ray.direction, q) * invDeterminant };
+			if (v < 0.f || u + v > 1.f) return false;
+
+			t = Vector3::Dot(triangle.edge2, q) * invDeterminant;
+			return t >= ray.min && t <= ray.max;
+		}
+
+		inline bool HitTest_Triangle(const TriangleRecord& triangle, TriangleCullMode cullMode, unsigned char materialIndex, const Ray& ray, HitRecord& hitRecord)
+		{
+			const float planeIntersection{ Vector3::Dot(triangle.normal, ray.direction) };
+			if ((planeIntersection > 0 && cullMode == TriangleCullMode::BackFaceCulling) ||
+				(planeIntersection < 0 && cullMode == TriangleCullMode::FrontFaceCulling))
+				return false;
+
+			float t{};
+			if (!Intersect_TriangleRecord(triangle, ray, t)) return false;
+
+			hitRecord.t = t;
+			hitRecord.didHit = true;
+			hitRecord.normal = triangle.normal;
+			hitRecord.materialIndex = materialIndex;
+			hitRecord.origin = ray.origin + (ray.direction * t);
+			return true;
+		}
+
+		//sign for TriangleBlocks::Intersect that culls the same faces as HitTest_Triangle, shadow rays use the negated sign
+		inline float GetCullSign(TriangleCullMode cullMode)
+		{
+			switch (cullMode)
+			{
+			case TriangleCullMode::BackFaceCulling:
+				return 1.f;
+			case TriangleCullMode::FrontFaceCulling:
+				return -1.f;
+			default:
+				return 0.f;
+			}
+		}
+
+		/**
+		 * \brief Closest hit among the triangles of one BVH leaf, tested a block at a time
+		 * \param ray ray.max shrinks to every closer hit
+		 * \return true if a closer hit was written to hitRecord
+		 */
+		template<int Width>
+		inline bool HitTest_TriangleBlocks(const TriangleBlocks<Width>& blocks, uint32_t firstPrimitive, uint32_t primitiveCount, float cullSign, unsigned char materialIndex, Ray& ray, HitRecord& hitRecord)
+		{
+			const std::vector<TriangleBlock<Width>>& leafBlocks{ blocks.GetBlocks() };
+			const uint32_t firstBlock{ blocks.GetLeafFirstBlock(firstPrimitive) };
+
+			bool didHit{};
+			for (uint32_t blockIdx{ firstBlock }; blockIdx < firstBlock + TriangleBlocks<Width>::GetBlockCount(primitiveCount); ++blockIdx)
+			{
+				const TriangleBlock<Width>& block{ leafBlocks[blockIdx] };
+
+				alignas(32) float distances[Width];
+				int hitMask{ TriangleBlocks<Width>::Intersect(block, ray.origin, ray.direction, ray.min, ray.max, cullSign, distances) };
+				if (hitMask == 0) continue;
+
+				uint32_t closestLane{ static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(hitMask))) };
+				for (hitMask &= hitMask - 1; hitMask; hitMask &= hitMask - 1)
+				{
+					const uint32_t lane{ static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(hitMask))) };
+					if (distances[lane] < distances[closestLane]) closestLane = lane;
+				}
+
+				const float t{ distances[closestLane] };
+				ray.max = t;
+
+				hitRecord.t = t;
+				hitRecord.didHit = true;
+				hitRecord.normal = Vector3{ block.normalX[closestLane], block.normalY[closestLane], block.normalZ[closestLane] };
+				hitRecord.materialIndex = materialIndex;
+				hitRecord.origin = ray.origin + (ray.direction * t);
+				didHit = true;
+			}
+			return didHit;
+		}
+
+		//any-hit counterpart of HitTest_TriangleBlocks, pass the negated cull sign for shadow rays
+		template<int Width>
+		inline bool Occluded_TriangleBlocks(const TriangleBlocks<Width>& blocks, uint32_t firstPrimitive, uint32_t primitiveCount, float cullSign, const Ray& ray)
+		{
+			const std::vector<TriangleBlock<Width>>& leafBlocks{ blocks.GetBlocks() };
+			const uint32_t firstBlock{ blocks.GetLeafFirstBlock(firstPrimitive) };
+
+			for (uint32_t blockIdx{ firstBlock }; blockIdx < firstBlock + TriangleBlocks<Width>::GetBlockCount(primitiveCount); ++blockIdx)
+			{
+				alignas(32) float distances[Width];
+				if (TriangleBlocks<Width>::Intersect(leafBlocks[blockIdx], ray.origin, ray.direction, ray.min, ray.max, cullSign, distances) != 0) return true;
+			}
+			return false;
+		}
+#pragma endregion
+#pragma region Occlusion
+		/**
+		 * \brief Shadow ray test of a single triangle (Moller-Trumbore), no hit record work at all
+		 * \return true if the triangle blocks the ray within [ray.min, ray.max]
+		 */
+		inline bool Occluded_Triangle(const TriangleRecord& triangle, TriangleCullMode cullMode, const Ray& ray)
+		{
+			//shadow rays leave the shaded surface, so culling is mirrored like the ignoreHitRecord path of HitTest_Triangle
+			const float planeIntersection{ Vector3::Dot(triangle.normal, ray.direction) };
+			if ((planeIntersection < 0 && cullMode == TriangleCullMode::BackFaceCulling) ||
+				(planeIntersection > 0 && cullMode == TriangleCullMode::FrontFaceCulling))
+				return false;
+
+			float t{};
+			return Intersect_TriangleRecord(triangle, ray, t);
+		}
+
+		inline bool Occluded_Triangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Vector3& normal, TriangleCullMode cullMode, const Ray& ray)
+		{
+			return Occluded_Triangle(TriangleRecord::Create(v0, v1 - v0, v2 - v0, normal), cullMode, ray);
+		}
+
+		inline bool Occluded_Triangle(const Triangle& triangle, const Ray& ray)
+		{
+			return Occluded_Triangle(triangle.v0, triangle.v1, triangle.v2, triangle.normal, triangle.cullMode, ray);
+		}
+
+		inline bool Occluded_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			const std::vector<uint32_t>& primitiveIndices{ mesh.bvh.GetPrimitiveIndices() };
+			const float cullSign{ -GetCullSign(mesh.cullMode) };
+
+			const auto occludedTriangle{ [&](uint32_t triangleIdx)
+				{
+					return Occluded_Triangle(mesh.triangleRecords[triangleIdx], mesh.cullMode, ray);
+				} };
+
+			//wide hierarchies keep the leaf ranges of mesh.bvh, so the blocks fit every layout
+			const auto occludedLeaf{ [&](uint32_t firstPrimitive, uint32_t primitiveCount)
+				{
+					switch (mesh.triangleLayout)
+					{
+					case TriangleLayout::Block4:
+						return Occluded_TriangleBlocks(mesh.triangleBlocks4, firstPrimitive, primitiveCount, cullSign, ray);
+					case TriangleLayout::Block8:
+						return Occluded_TriangleBlocks(mesh.triangleBlocks8, firstPrimitive, primitiveCount, cullSign, ray);
+					default:
+						return OccludedPrimitives(primitiveIndices, firstPrimitive, primitiveCount, occludedTriangle);
+					}
+				} };
+
+			switch (mesh.bvhLayout)
+			{
+			case BVHLayout::Wide4:
+				return OccludedWideBVHLeaves(mesh.wideBVH4, ray, occludedLeaf);
+			case BVHLayout::Wide8:
+				return OccludedWideBVHLeaves(mesh.wideBVH8, ray, occludedLeaf);
+			default:
+				return OccludedBVHLeaves(mesh.bvh, ray, occludedLeaf);
+			}
+		}
+#pragma endregion
 #pragma region TriangleMesh HitTest
 		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
@@ -178,34 +845,198 @@ namespace dae
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
 			//done in week 5
-			//slab test
-			if (!SlabTest_TriangleMesh(mesh, ray)) return false;
+			//shadow rays only need to know whether anything is in the way
+			if (ignoreHitRecord) return Occluded_TriangleMesh(mesh, ray);
+
+			//only hits in front of the current record are of interest, this also prunes the traversal
+			Ray meshRay{ ray };
+			meshRay.max = std::min(ray.max, hitRecord.t);
 
-			bool returnState{};
 			HitRecord closestHit{};
+			const auto intersectTriangle{ [&](uint32_t triangleIdx, Ray& currentRay)
+				{
+					if (!HitTest_Triangle(mesh.triangleRecords[triangleIdx], mesh.cullMode, mesh.materialIndex, currentRay, closestHit)) return false;
 
-			for (int indicesIdx{}; indicesIdx < mesh.indices.size(); indicesIdx += 3)
+					//shrink the ray so farther triangles and nodes get skipped
+					currentRay.max = closestHit.t;
+					return true;
+				} };
+
+			//wide hierarchies keep the leaf ranges of mesh.bvh, so the blocks fit every layout
+			const std::vector<uint32_t>& primitiveIndices{ mesh.bvh.GetPrimitiveIndices() };
+			const float cullSign{ GetCullSign(mesh.cullMode) };
+			const auto intersectLeaf{ [&](uint32_t firstPrimitive, uint32_t primitiveCount, Ray& currentRay)
+				{
+					switch (mesh.triangleLayout)
+					{
+					case TriangleLayout::Block4:
+						return HitTest_TriangleBlocks(mesh.triangleBlocks4, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, currentRay, closestHit);
+					case TriangleLayout::Block8:
+						return HitTest_TriangleBlocks(mesh.triangleBlocks8, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, currentRay, closestHit);
+					default:
+						return IntersectPrimitives(primitiveIndices, firstPrimitive, primitiveCount, currentRay, intersectTriangle, false);
+					}
+				} };
+
+			bool didHit{};
+			switch (mesh.bvhLayout)
 			{
-				//adding all verteces individually
-				const Vector3 v0{ mesh.transformedPositions[mesh.indices[indicesIdx]] };
-				const Vector3 v1{ mesh.transformedPositions[mesh.indices[indicesIdx + 1]] };
-				const Vector3 v2{ mesh.transformedPositions[mesh.indices[indicesIdx + 2]] };
-
-				//making new triangle with verteces and setting cullmode and materialindex of new triangle to mesh values
-				Triangle triangle{ v0, v1, v2, mesh.transformedNormals[indicesIdx / 3] };
-				triangle.cullMode = mesh.cullMode;
-				triangle.materialIndex = mesh.materialIndex;
-
-				if (HitTest_Triangle(triangle, ray, closestHit, ignoreHitRecord)) returnState = true;
-				if (closestHit.t < hitRecord.t and closestHit.didHit) hitRecord = closestHit;
+			case BVHLayout::Wide4:
+				didHit = TraverseWideBVHLeaves(mesh.wideBVH4, meshRay, intersectLeaf);
+				break;
+			case BVHLayout::Wide8:
+				didHit = TraverseWideBVHLeaves(mesh.wideBVH8, meshRay, intersectLeaf);
+				break;
+			default:
+				didHit = TraverseBVHLeaves(mesh.bvh, meshRay, intersectLeaf);
+				break;
 			}
-			return returnState;
+
+			if (didHit) hitRecord = closestHit;
+			return didHit;
 		}
 
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			return Occluded_TriangleMesh(mesh, ray);
+		}
+#pragma endregion
+#pragma region MeshInstance HitTest
+		inline bool HitTest_MeshInstance(const MeshInstance& instance, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			//move the ray into object space, the direction is not renormalized so t means the same in both spaces
+			Ray objectRay{ instance.inverseTransform.TransformPoint(ray.origin), instance.inverseTransform.TransformVector(ray.direction) };
+			objectRay.min = ray.min;
+			objectRay.max = ray.max;
+
+			if (ignoreHitRecord) return Occluded_TriangleMesh(*instance.pMesh, objectRay);
+
+			HitRecord objectHit{};
+			objectHit.t = hitRecord.t;
+			if (!HitTest_TriangleMesh(*instance.pMesh, objectRay, objectHit)) return false;
+
+			hitRecord.t = objectHit.t;
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = instance.materialIndex;
+			hitRecord.origin = ray.origin + (objectHit.t * ray.direction);
+			hitRecord.normal = instance.TransformNormal(objectHit.normal);
+			return true;
+		}
+
+		inline bool Occluded_MeshInstance(const MeshInstance& instance, const Ray& ray)
+		{
+			Ray objectRay{ instance.inverseTransform.TransformPoint(ray.origin), instance.inverseTransform.TransformVector(ray.direction) };
+			objectRay.min = ray.min;
+			objectRay.max = ray.max;
+
+			return Occluded_TriangleMesh(*instance.pMesh, objectRay);
+		}
+
+		inline bool HitTest_MeshInstance(const MeshInstance& instance, const Ray& ray)
+		{
+			return Occluded_MeshInstance(instance, ray);
+		}
+#pragma endregion
+#pragma region Packet Traversal
+		/**
+		 * \brief Walks a binary BVH with the rays of a packet together, sharing one traversal stack
+		 * \param rayMask Lanes of the packet to trace, the packet has to be coherent
+		 * \param intersectLeaf void(uint32_t firstPrimitive, uint32_t primitiveCount, uint64_t rayMask), tests the rays that reach the leaf and shrinks packet.max on closer hits
+		 * \param pStats Optional counters, a node visit counts once for the whole packet
+		 */
+		template<typename IntersectLeaf>
+		inline void TraversePacketBVHLeaves(const BVH& bvh, RayPacket& packet, uint64_t rayMask, IntersectLeaf&& intersectLeaf, TraversalStats* pStats = nullptr)
+		{
+			const std::vector<BVHNode>& nodes{ bvh.GetNodes() };
+			if (nodes.empty() || rayMask == 0) return;
+
+			//the whole packet shares an octant, so the first ray decides the near-to-far order for everyone
+			const uint32_t firstLane{ static_cast<uint32_t>(std::countr_zero(rayMask)) };
+			const Vector3 direction{ packet.directionX[firstLane], packet.directionY[firstLane], packet.directionZ[firstLane] };
+
+			//nodes are tested when popped, so they see the hits found since they were pushed
+			uint32_t nodeStack[BVH::MaxDepth + 1];
+			uint64_t maskStack[BVH::MaxDepth + 1];
+			nodeStack[0] = 0;
+			maskStack[0] = rayMask;
+			uint32_t stackSize{ 1 };
+
+			while (stackSize > 0)
+			{
+				--stackSize;
+				const BVHNode& node{ nodes[nodeStack[stackSize]] };
+				if (pStats) ++pStats->nodeVisits;
+
+				const uint64_t nodeMask{ packet.IntersectBox(node.minAABB, node.maxAABB, maskStack[stackSize]) };
+				if (nodeMask == 0) continue;
+
+				if (node.IsLeaf())
+				{
+					if (pStats) pStats->primitiveTests += static_cast<uint64_t>(node.primitiveCount) * std::popcount(nodeMask);
+					intersectLeaf(node.leftFirst, node.primitiveCount, nodeMask);
+					continue;
+				}
+
+				//far child goes first so the near one is popped next
+				const BVHNode& left{ nodes[node.leftFirst] };
+				const BVHNode& right{ nodes[node.leftFirst + 1] };
+				const bool leftIsNear{ Vector3::Dot((left.minAABB + left.maxAABB) - (right.minAABB + right.maxAABB), direction) <= 0.f };
+
+				nodeStack[stackSize] = leftIsNear ? node.leftFirst + 1 : node.leftFirst;
+				maskStack[stackSize] = nodeMask;
+				nodeStack[stackSize + 1] = leftIsNear ? node.leftFirst : node.leftFirst + 1;
+				maskStack[stackSize + 1] = nodeMask;
+				stackSize += 2;
+			}
+		}
+
+		/**
+		 * \brief Closest hits of the rays in rayMask against a mesh
+		 * \param hitRecords One record per packet lane, only overwritten by closer hits, packet.max follows them
+		 */
+		inline void HitTest_TriangleMesh(const TriangleMesh& mesh, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			//only binary hierarchies have a packet traversal, and a lone or diverged ray is faster on its own
+			if (mesh.bvhLayout != BVHLayout::Binary || !packet.isCoherent || std::popcount(rayMask) == 1)
+			{
+				for (; rayMask; rayMask &= rayMask - 1)
+				{
+					const uint32_t lane{ static_cast<uint32_t>(std::countr_zero(rayMask)) };
+					if (HitTest_TriangleMesh(mesh, packet.GetRay(lane), hitRecords[lane])) packet.max[lane] = hitRecords[lane].t;
+				}
+				return;
+			}
+
+			const std::vector<uint32_t>& primitiveIndices{ mesh.bvh.GetPrimitiveIndices() };
+			const float cullSign{ GetCullSign(mesh.cullMode) };
+			TraversePacketBVHLeaves(mesh.bvh, packet, rayMask, [&](uint32_t firstPrimitive, uint32_t primitiveCount, uint64_t leafMask)
+				{
+					//rays leave the packet at the leaves, the triangle kernels are single-ray
+					for (; leafMask; leafMask &= leafMask - 1)
+					{
+						const uint32_t lane{ static_cast<uint32_t>(std::countr_zero(leafMask)) };
+						Ray ray{ packet.GetRay(lane) };
+						HitRecord& closestHit{ hitRecords[lane] };
+
+						switch (mesh.triangleLayout)
+						{
+						case TriangleLayout::Block4:
+							HitTest_TriangleBlocks(mesh.triangleBlocks4, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, ray, closestHit);
+							break;
+						case TriangleLayout::Block8:
+							HitTest_TriangleBlocks(mesh.triangleBlocks8, firstPrimitive, primitiveCount, cullSign, mesh.materialIndex, ray, closestHit);
+							break;
+						default:
+							for (uint32_t idx{ firstPrimitive }; idx < firstPrimitive + primitiveCount; ++idx)
+							{
+								if (HitTest_Triangle(mesh.triangleRecords[primitiveIndices[idx]], mesh.cullMode, mesh.materialIndex, ray, closestHit)) ray.max = closestHit.t;
+							}
+							break;
+						}
+
+						packet.max[lane] = ray.max;
+					}
+				});
 		}
 #pragma endregion
 	}
@@ -234,7 +1065,7 @@ namespace dae
 			//done in week 3
 			if (light.type == LightType::Point)
 			{
-				float irradiance{ light.intensity / ((light.origin - target).Magnitude() * (light.origin - target).Magnitude()) };
+				float irradiance{ light.intensity / (light.origin - target).SqrMagnitude() };
 				ColorRGB lightColor{ light.color * irradiance };
 
 				return lightColor;
@@ -1,50 +1,81 @@
 #pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#if defined(SIMD_MATH)
+#include <immintrin.h>
+#endif
+
+#include "MathHelpers.h"
+
+//Everything is defined inline in this header so the hot paths (ray setup, intersection, shading) inline across translation units.
+//The scalar build also makes the arithmetic constexpr, the SSE intrinsics of the SIMD_MATH build can't be evaluated at compile time.
+#if defined(SIMD_MATH)
+#define VECTOR3_CONSTEXPR inline
+#else
+#define VECTOR3_CONSTEXPR constexpr
+#endif
 
 namespace dae
 {
 	struct Vector4;
+
+	//Built with SIMD_MATH (CMake option USE_SIMD_MATH) the vector fills one 16-byte aligned SSE register,
+	//the operations below are then written with SSE intrinsics and compile to packed instructions.
+#if defined(SIMD_MATH)
+	struct alignas(16) Vector3
+#else
 	struct Vector3
+#endif
 	{
 		float x{};
 		float y{};
 		float z{};
+#if defined(SIMD_MATH)
+		float w{}; //padding lane, never part of the result
+#endif
 
 		Vector3() = default;
-		Vector3(float _x, float _y, float _z);
-		Vector3(const Vector3& from, const Vector3& to);
-		Vector3(const Vector4& v);
+		constexpr Vector3(float _x, float _y, float _z);
+		VECTOR3_CONSTEXPR Vector3(const Vector3& from, const Vector3& to);
+		constexpr Vector3(const Vector4& v);
+#if defined(SIMD_MATH)
+		explicit Vector3(__m128 values) { _mm_store_ps(&x, values); }
+		__m128 Load() const { return _mm_load_ps(&x); }
+#endif
 
 		float Magnitude() const;
-		float SqrMagnitude() const;
+		VECTOR3_CONSTEXPR float SqrMagnitude() const;
 		float Normalize();
 		Vector3 Normalized() const;
 
-		static float Dot(const Vector3& v1, const Vector3& v2);
-		static Vector3 Cross(const Vector3& v1, const Vector3& v2);
-		static Vector3 Project(const Vector3& v1, const Vector3& v2);
-		static Vector3 Reject(const Vector3& v1, const Vector3& v2);
-		static Vector3 Reflect(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static float Dot(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Cross(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Project(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Reject(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Reflect(const Vector3& v1, const Vector3& v2);
 		static Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3);
 
-		static Vector3 Max(const Vector3& v1, const Vector3& v2);
-		static Vector3 Min(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Max(const Vector3& v1, const Vector3& v2);
+		VECTOR3_CONSTEXPR static Vector3 Min(const Vector3& v1, const Vector3& v2);
 
-		Vector4 ToPoint4() const;
-		Vector4 ToVector4() const;
+		//defined in Vector4.h, once Vector4 is complete
+		constexpr Vector4 ToPoint4() const;
+		constexpr Vector4 ToVector4() const;
 
 		//Member Operators
-		Vector3 operator*(float scale) const;
-		Vector3 operator/(float scale) const;
-		Vector3 operator+(const Vector3& v) const;
-		Vector3 operator-(const Vector3& v) const;
-		Vector3 operator-() const;
+		VECTOR3_CONSTEXPR Vector3 operator*(float scale) const;
+		VECTOR3_CONSTEXPR Vector3 operator/(float scale) const;
+		VECTOR3_CONSTEXPR Vector3 operator+(const Vector3& v) const;
+		VECTOR3_CONSTEXPR Vector3 operator-(const Vector3& v) const;
+		VECTOR3_CONSTEXPR Vector3 operator-() const;
 		//Vector3& operator-();
-		Vector3& operator+=(const Vector3& v);
-		Vector3& operator-=(const Vector3& v);
-		Vector3& operator/=(float scale);
-		Vector3& operator*=(float scale);
-		float& operator[](int index);
-		float operator[](int index) const;
+		VECTOR3_CONSTEXPR Vector3& operator+=(const Vector3& v);
+		VECTOR3_CONSTEXPR Vector3& operator-=(const Vector3& v);
+		VECTOR3_CONSTEXPR Vector3& operator/=(float scale);
+		VECTOR3_CONSTEXPR Vector3& operator*=(float scale);
+		constexpr float& operator[](int index);
+		constexpr float operator[](int index) const;
 		bool operator==(const Vector3& v) const;
 
 		static const Vector3 UnitX;
@@ -54,8 +85,316 @@ namespace dae
 	};
 
 	//Global Operators
-	inline Vector3 operator*(float scale, const Vector3& v)
+	VECTOR3_CONSTEXPR Vector3 operator*(float scale, const Vector3& v)
 	{
+#if defined(SIMD_MATH)
+		return Vector3{ _mm_mul_ps(v.Load(), _mm_set1_ps(scale)) };
+#else
 		return { v.x * scale, v.y * scale, v.z * scale };
+#endif
+	}
+
+	constexpr Vector3::Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+
+	inline constexpr Vector3 Vector3::UnitX{ 1, 0, 0 };
+	inline constexpr Vector3 Vector3::UnitY{ 0, 1, 0 };
+	inline constexpr Vector3 Vector3::UnitZ{ 0, 0, 1 };
+	inline constexpr Vector3 Vector3::Zero{ 0, 0, 0 };
+
+	constexpr float& Vector3::operator[](int index)
+	{
+		assert(index <= 2 && index >= 0);
+
+		if (index == 0) return x;
+		if (index == 1) return y;
+		return z;
 	}
+
+	constexpr float Vector3::operator[](int index) const
+	{
+		assert(index <= 2 && index >= 0);
+
+		if (index == 0) return x;
+		if (index == 1) return y;
+		return z;
+	}
+
+	inline bool Vector3::operator==(const Vector3& v) const
+	{
+		return AreEqual(x, v.x) && AreEqual(y, v.y) && AreEqual(z, v.z);
+	}
+
+#if defined(SIMD_MATH)
+#pragma region SIMD Implementation
+	namespace Vector3Simd
+	{
+		//keeps x, y and z, clears the padding lane
+		inline __m128 MaskXYZ(__m128 values)
+		{
+			return _mm_and_ps(values, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		}
+
+		//sum of x, y and z broadcast to every lane
+		inline __m128 HorizontalSum(__m128 values)
+		{
+			values = MaskXYZ(values);
+			values = _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+		}
+	}
+
+	inline Vector3::Vector3(const Vector3& from, const Vector3& to)
+	{
+		_mm_store_ps(&x, _mm_sub_ps(to.Load(), from.Load()));
+	}
+
+	inline float Vector3::Magnitude() const
+	{
+		return _mm_cvtss_f32(_mm_sqrt_ss(Vector3Simd::HorizontalSum(_mm_mul_ps(Load(), Load()))));
+	}
+
+	inline float Vector3::Normalize()
+	{
+		const __m128 magnitude{ _mm_sqrt_ps(Vector3Simd::HorizontalSum(_mm_mul_ps(Load(), Load()))) };
+		_mm_store_ps(&x, _mm_div_ps(Load(), magnitude));
+		w = 0.f;
+		return _mm_cvtss_f32(magnitude);
+	}
+
+	inline Vector3 Vector3::Normalized() const
+	{
+		const __m128 magnitude{ _mm_sqrt_ps(Vector3Simd::HorizontalSum(_mm_mul_ps(Load(), Load()))) };
+		return Vector3{ Vector3Simd::MaskXYZ(_mm_div_ps(Load(), magnitude)) };
+	}
+
+	inline float Vector3::Dot(const Vector3& v1, const Vector3& v2)
+	{
+		return _mm_cvtss_f32(Vector3Simd::HorizontalSum(_mm_mul_ps(v1.Load(), v2.Load())));
+	}
+
+	inline float Vector3::SqrMagnitude() const
+	{
+		return Dot(*this, *this);
+	}
+
+	inline Vector3 Vector3::Cross(const Vector3& v1, const Vector3& v2)
+	{
+		//v1.yzx * v2.zxy - v1.zxy * v2.yzx
+		const __m128 a{ v1.Load() }, b{ v2.Load() };
+		const __m128 aYZX{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)) };
+		const __m128 bYZX{ _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)) };
+		const __m128 crossZXY{ _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b)) };
+		return Vector3{ _mm_shuffle_ps(crossZXY, crossZXY, _MM_SHUFFLE(3, 0, 2, 1)) };
+	}
+
+	inline Vector3 Vector3::Max(const Vector3& v1, const Vector3& v2)
+	{
+		return Vector3{ _mm_max_ps(v1.Load(), v2.Load()) };
+	}
+
+	inline Vector3 Vector3::Min(const Vector3& v1, const Vector3& v2)
+	{
+		return Vector3{ _mm_min_ps(v1.Load(), v2.Load()) };
+	}
+
+	inline Vector3 Vector3::operator*(float scale) const
+	{
+		return Vector3{ _mm_mul_ps(Load(), _mm_set1_ps(scale)) };
+	}
+
+	inline Vector3 Vector3::operator/(float scale) const
+	{
+		return Vector3{ _mm_div_ps(Load(), _mm_set1_ps(scale)) };
+	}
+
+	inline Vector3 Vector3::operator+(const Vector3& v) const
+	{
+		return Vector3{ _mm_add_ps(Load(), v.Load()) };
+	}
+
+	inline Vector3 Vector3::operator-(const Vector3& v) const
+	{
+		return Vector3{ _mm_sub_ps(Load(), v.Load()) };
+	}
+
+	inline Vector3 Vector3::operator-() const
+	{
+		return Vector3{ _mm_xor_ps(Load(), _mm_set1_ps(-0.f)) };
+	}
+
+	inline Vector3& Vector3::operator*=(float scale)
+	{
+		_mm_store_ps(&x, _mm_mul_ps(Load(), _mm_set1_ps(scale)));
+		return *this;
+	}
+
+	inline Vector3& Vector3::operator/=(float scale)
+	{
+		_mm_store_ps(&x, _mm_div_ps(Load(), _mm_set1_ps(scale)));
+		return *this;
+	}
+
+	inline Vector3& Vector3::operator-=(const Vector3& v)
+	{
+		_mm_store_ps(&x, _mm_sub_ps(Load(), v.Load()));
+		return *this;
+	}
+
+	inline Vector3& Vector3::operator+=(const Vector3& v)
+	{
+		_mm_store_ps(&x, _mm_add_ps(Load(), v.Load()));
+		return *this;
+	}
+
+	inline Vector3 Vector3::Project(const Vector3& v1, const Vector3& v2)
+	{
+		return (v2 * (Dot(v1, v2) / Dot(v2, v2)));
+	}
+
+	inline Vector3 Vector3::Reject(const Vector3& v1, const Vector3& v2)
+	{
+		return (v1 - v2 * (Dot(v1, v2) / Dot(v2, v2)));
+	}
+
+	inline Vector3 Vector3::Reflect(const Vector3& v1, const Vector3& v2)
+	{
+		return v1 - (2.f * Vector3::Dot(v1, v2) * v2);
+	}
+#pragma endregion
+#else
+#pragma region Scalar Implementation
+	constexpr Vector3::Vector3(const Vector3& from, const Vector3& to) : x(to.x - from.x), y(to.y - from.y), z(to.z - from.z) {}
+
+	inline float Vector3::Magnitude() const
+	{
+		return std::sqrt(x * x + y * y + z * z);
+	}
+
+	constexpr float Vector3::SqrMagnitude() const
+	{
+		return x * x + y * y + z * z;
+	}
+
+	inline float Vector3::Normalize()
+	{
+		const float m = Magnitude();
+		x /= m;
+		y /= m;
+		z /= m;
+
+		return m;
+	}
+
+	inline Vector3 Vector3::Normalized() const
+	{
+		const float m = Magnitude();
+		return { x / m, y / m, z / m };
+	}
+
+	constexpr float Vector3::Dot(const Vector3& v1, const Vector3& v2)
+	{
+		//done in week 1
+		return { v1.x * v2.x + v1.y * v2.y + v1.z * v2.z };
+	}
+
+	constexpr Vector3 Vector3::Cross(const Vector3& v1, const Vector3& v2)
+	{
+		//done in week 1
+		return {v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x};
+	}
+
+	constexpr Vector3 Vector3::Project(const Vector3& v1, const Vector3& v2)
+	{
+		return (v2 * (Dot(v1, v2) / Dot(v2, v2)));
+	}
+
+	constexpr Vector3 Vector3::Reject(const Vector3& v1, const Vector3& v2)
+	{
+		return (v1 - v2 * (Dot(v1, v2) / Dot(v2, v2)));
+	}
+
+	constexpr Vector3 Vector3::Reflect(const Vector3& v1, const Vector3& v2)
+	{
+		return v1 - (2.f * Vector3::Dot(v1, v2) * v2);
+	}
+
+	constexpr Vector3 Vector3::Max(const Vector3& v1, const Vector3& v2)
+	{
+		return{
+			std::max(v1.x, v2.x),
+			std::max(v1.y, v2.y),
+			std::max(v1.z, v2.z)
+		};
+	}
+
+	constexpr Vector3 Vector3::Min(const Vector3& v1, const Vector3& v2)
+	{
+		return{
+			std::min(v1.x, v2.x),
+			std::min(v1.y, v2.y),
+			std::min(v1.z, v2.z)
+		};
+	}
+
+	constexpr Vector3 Vector3::operator*(float scale) const
+	{
+		return { x * scale, y * scale, z * scale };
+	}
+
+	constexpr Vector3 Vector3::operator/(float scale) const
+	{
+		return { x / scale, y / scale, z / scale };
+	}
+
+	constexpr Vector3 Vector3::operator+(const Vector3& v) const
+	{
+		return { x + v.x, y + v.y, z + v.z };
+	}
+
+	constexpr Vector3 Vector3::operator-(const Vector3& v) const
+	{
+		return { x - v.x, y - v.y, z - v.z };
+	}
+
+	constexpr Vector3 Vector3::operator-() const
+	{
+		return { -x ,-y,-z };
+	}
+
+	constexpr Vector3& Vector3::operator*=(float scale)
+	{
+		x *= scale;
+		y *= scale;
+		z *= scale;
+		return *this;
+	}
+
+	constexpr Vector3& Vector3::operator/=(float scale)
+	{
+		x /= scale;
+		y /= scale;
+		z /= scale;
+		return *this;
+	}
+
+	constexpr Vector3& Vector3::operator-=(const Vector3& v)
+	{
+		x -= v.x;
+		y -= v.y;
+		z -= v.z;
+		return *this;
+	}
+
+	constexpr Vector3& Vector3::operator+=(const Vector3& v)
+	{
+		x += v.x;
+		y += v.y;
+		z += v.z;
+		return *this;
+	}
+#pragma endregion
+#endif
 }
+
+//Vector4 needs the complete Vector3, the conversions between the two are defined at its end
+#include "Vector4.h"
@@ -0,0 +1,115 @@
+#include "WideBVH.h"
+
+namespace dae
+{
+	template<int Width>
+	void WideBVH<Width>::Build(const BVH& bvh)
+	{
+		Clear();
+		if (bvh.IsEmpty()) return;
+
+		const std::vector<BVHNode>& binaryNodes{ bvh.GetNodes() };
+		m_PrimitiveIndices = bvh.GetPrimitiveIndices();
+
+		//every wide node is created from a binary node, remembered here until its children are filled in
+		struct CollapseTask
+		{
+			uint32_t wideIdx;
+			uint32_t binaryIdx;
+		};
+
+		m_Nodes.reserve(binaryNodes.size() / 2 + 1);
+		m_Nodes.emplace_back();
+		std::vector<CollapseTask> tasks{ { 0, 0 } };
+
+		while (!tasks.empty())
+		{
+			const CollapseTask task{ tasks.back() };
+			tasks.pop_back();
+
+			//start from the two children and keep opening the biggest interior child until the node is full
+			uint32_t children[Width]{};
+			uint32_t childCount{};
+
+			const BVHNode& binaryNode{ binaryNodes[task.binaryIdx] };
+			if (binaryNode.IsLeaf())
+			{
+				children[childCount++] = task.binaryIdx;
+			}
+			else
+			{
+				children[childCount++] = binaryNode.leftFirst;
+				children[childCount++] = binaryNode.leftFirst + 1;
+			}
+
+			while (childCount < Width)
+			{
+				int largestChild{ -1 };
+				float largestArea{ -1.f };
+				for (uint32_t childIdx{}; childIdx < childCount; ++childIdx)
+				{
+					const BVHNode& child{ binaryNodes[children[childIdx]] };
+					if (child.IsLeaf()) continue;
+
+					const float area{ AABB{ child.minAABB, child.maxAABB }.GetSurfaceArea() };
+					if (area > largestArea)
+					{
+						largestArea = area;
+						largestChild = static_cast<int>(childIdx);
+					}
+				}
+
+				if (largestChild < 0) break;
+
+				const uint32_t openedIdx{ children[largestChild] };
+				children[largestChild] = binaryNodes[openedIdx].leftFirst;
+				children[childCount++] = binaryNodes[openedIdx].leftFirst + 1;
+			}
+
+			//fill the slots, empty slots are masked out by childCount
+			WideBVHNode<Width> node{};
+			node.childCount = childCount;
+			for (uint32_t slot{}; slot < Width; ++slot)
+			{
+				if (slot >= childCount)
+				{
+					node.minX[slot] = node.minY[slot] = node.minZ[slot] = FLT_MAX;
+					node.maxX[slot] = node.maxY[slot] = node.maxZ[slot] = -FLT_MAX;
+					continue;
+				}
+
+				const BVHNode& child{ binaryNodes[children[slot]] };
+				node.minX[slot] = child.minAABB.x;
+				node.minY[slot] = child.minAABB.y;
+				node.minZ[slot] = child.minAABB.z;
+				node.maxX[slot] = child.maxAABB.x;
+				node.maxY[slot] = child.maxAABB.y;
+				node.maxZ[slot] = child.maxAABB.z;
+
+				if (child.IsLeaf())
+				{
+					node.child[slot] = child.leftFirst;
+					node.primitiveCount[slot] = child.primitiveCount;
+				}
+				else
+				{
+					node.child[slot] = static_cast<uint32_t>(m_Nodes.size());
+					m_Nodes.emplace_back();
+					tasks.push_back({ node.child[slot], children[slot] });
+				}
+			}
+
+			m_Nodes[task.wideIdx] = node;
+		}
+	}
+
+	template<int Width>
+	void WideBVH<Width>::Clear()
+	{
+		m_Nodes.clear();
+		m_PrimitiveIndices.clear();
+	}
+
+	template class WideBVH<4>;
+	template class WideBVH<8>;
+}
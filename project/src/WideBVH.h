@@ -0,0 +1,166 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <immintrin.h>
+
+#include "BVH.h"
+
+namespace dae
+{
+	enum class BVHLayout
+	{
+		Binary, //regular two-child nodes
+		Wide4, //four children per node, tested with one SSE operation
+		Wide8 //eight children per node, tested with one AVX operation (two SSE operations without AVX)
+	};
+
+	//Node with the bounds of all its children stored as structure of arrays so they load straight into SIMD registers.
+	//Children fill the first childCount slots, a slot with a non-zero primitiveCount is a leaf.
+	template<int Width>
+	struct alignas(32) WideBVHNode
+	{
+		float minX[Width];
+		float minY[Width];
+		float minZ[Width];
+		float maxX[Width];
+		float maxY[Width];
+		float maxZ[Width];
+
+		uint32_t child[Width]; //wide node index for interior children, first primitive index for leaves
+		uint32_t primitiveCount[Width];
+		uint32_t childCount;
+	};
+
+	//Wide BVH made by collapsing a binary BVH, leaves keep the primitive ranges of the binary tree
+	template<int Width>
+	class WideBVH final
+	{
+	public:
+		static_assert(Width == 4 || Width == 8, "WideBVH only supports 4 and 8 wide nodes");
+
+		//every level of the binary tree pushes at most Width entries on the traversal stack
+		static constexpr uint32_t StackSize{ BVH::MaxDepth * Width };
+
+		void Build(const BVH& bvh);
+		void Clear();
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		const std::vector<WideBVHNode<Width>>& GetNodes() const { return m_Nodes; }
+		const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+		/**
+		 * \brief Slab test of a ray against all children of a node at once
+		 * \param invDirection Component-wise inverse of the ray direction
+		 * \param distances Receives the entry distance of every child
+		 * \return Bitmask of the children that overlap [tMin, tMax] along the ray
+		 */
+		static int IntersectChildren(const WideBVHNode<Width>& node, const Vector3& origin, const Vector3& invDirection, float tMin, float tMax, float* distances);
+		//scalar reference of IntersectChildren, same slab logic as GeometryUtils::SlabTest_TriangleMesh
+		static int IntersectChildren_Scalar(const WideBVHNode<Width>& node, const Vector3& origin, const Vector3& invDirection, float tMin, float tMax, float* distances);
+
+	private:
+		std::vector<WideBVHNode<Width>> m_Nodes{};
+		std::vector<uint32_t> m_PrimitiveIndices{};
+	};
+
+#pragma region Node Intersection
+	namespace WideBVHKernels
+	{
+		//slab test of four children, lanes [offset, offset + 4) of the node
+		template<int Width>
+		inline __m128 IntersectChildren4(const WideBVHNode<Width>& node, int offset, __m128 origin[3], __m128 invDirection[3], __m128 tMin, __m128 tMax, __m128& entry)
+		{
+			const __m128 tx1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX + offset), origin[0]), invDirection[0]) };
+			const __m128 tx2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX + offset), origin[0]), invDirection[0]) };
+			const __m128 ty1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY + offset), origin[1]), invDirection[1]) };
+			const __m128 ty2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY + offset), origin[1]), invDirection[1]) };
+			const __m128 tz1{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ + offset), origin[2]), invDirection[2]) };
+			const __m128 tz2{ _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ + offset), origin[2]), invDirection[2]) };
+
+			entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+			const __m128 exit{ _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2)) };
+
+			return _mm_and_ps(_mm_and_ps(_mm_cmple_ps(entry, exit), _mm_cmpge_ps(exit, tMin)), _mm_cmple_ps(entry, tMax));
+		}
+	}
+
+	template<int Width>
+	inline int WideBVH<Width>::IntersectChildren(const WideBVHNode<Width>& node, const Vector3& origin, const Vector3& invDirection, float tMin, float tMax, float* distances)
+	{
+		const int validMask{ (1 << node.childCount) - 1 };
+
+#if defined(__AVX__)
+		if constexpr (Width == 8)
+		{
+			const __m256 originX{ _mm256_set1_ps(origin.x) }, originY{ _mm256_set1_ps(origin.y) }, originZ{ _mm256_set1_ps(origin.z) };
+			const __m256 invX{ _mm256_set1_ps(invDirection.x) }, invY{ _mm256_set1_ps(invDirection.y) }, invZ{ _mm256_set1_ps(invDirection.z) };
+
+			const __m256 tx1{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minX), originX), invX) };
+			const __m256 tx2{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxX), originX), invX) };
+			const __m256 ty1{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minY), originY), invY) };
+			const __m256 ty2{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxY), originY), invY) };
+			const __m256 tz1{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minZ), originZ), invZ) };
+			const __m256 tz2{ _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxZ), originZ), invZ) };
+
+			const __m256 entry{ _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx1, tx2), _mm256_min_ps(ty1, ty2)), _mm256_min_ps(tz1, tz2)) };
+			const __m256 exit{ _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx1, tx2), _mm256_max_ps(ty1, ty2)), _mm256_max_ps(tz1, tz2)) };
+			const __m256 hit{ _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ), _mm256_cmp_ps(exit, _mm256_set1_ps(tMin), _CMP_GE_OQ)),
+				_mm256_cmp_ps(entry, _mm256_set1_ps(tMax), _CMP_LE_OQ)) };
+
+			_mm256_storeu_ps(distances, entry);
+			return _mm256_movemask_ps(hit) & validMask;
+		}
+#endif
+
+		__m128 origin4[3]{ _mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z) };
+		__m128 invDirection4[3]{ _mm_set1_ps(invDirection.x), _mm_set1_ps(invDirection.y), _mm_set1_ps(invDirection.z) };
+		const __m128 tMin4{ _mm_set1_ps(tMin) };
+		const __m128 tMax4{ _mm_set1_ps(tMax) };
+
+		int hitMask{};
+		for (int offset{}; offset < Width; offset += 4)
+		{
+			__m128 entry{};
+			const __m128 hit{ WideBVHKernels::IntersectChildren4(node, offset, origin4, invDirection4, tMin4, tMax4, entry) };
+
+			_mm_storeu_ps(distances + offset, entry);
+			hitMask |= _mm_movemask_ps(hit) << offset;
+		}
+		return hitMask & validMask;
+	}
+
+	template<int Width>
+	inline int WideBVH<Width>::IntersectChildren_Scalar(const WideBVHNode<Width>& node, const Vector3& origin, const Vector3& invDirection, float tMin, float tMax, float* distances)
+	{
+		int hitMask{};
+		for (uint32_t childIdx{}; childIdx < node.childCount; ++childIdx)
+		{
+			// X
+			float tx1 = (node.minX[childIdx] - origin.x) * invDirection.x;
+			float tx2 = (node.maxX[childIdx] - origin.x) * invDirection.x;
+
+			float tmin = std::min(tx1, tx2);
+			float tmax = std::max(tx1, tx2);
+
+			// Y
+			float ty1 = (node.minY[childIdx] - origin.y) * invDirection.y;
+			float ty2 = (node.maxY[childIdx] - origin.y) * invDirection.y;
+
+			tmin = std::max(tmin, std::min(ty1, ty2));
+			tmax = std::min(tmax, std::max(ty1, ty2));
+
+			// Z
+			float tz1 = (node.minZ[childIdx] - origin.z) * invDirection.z;
+			float tz2 = (node.maxZ[childIdx] - origin.z) * invDirection.z;
+
+			tmin = std::max(tmin, std::min(tz1, tz2));
+			tmax = std::min(tmax, std::max(tz1, tz2));
+
+			distances[childIdx] = tmin;
+			if (tmax >= tmin && tmax >= tMin && tmin <= tMax) hitMask |= 1 << childIdx;
+		}
+		return hitMask;
+	}
+#pragma endregion
+}
@@ -7,12 +7,17 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "CpuDispatch.h"
 
 using namespace dae;
 
@@ -40,18 +45,59 @@ void PrintSettings()
 	std::cout << "\tSettings" << std::endl;
 	std::cout << "===========================\n" << std::endl;
 	std::cout << "X : Take a screenshot" << std::endl;
+	std::cout << "C : Toggle capturing every frame" << std::endl;
 	std::cout << "F2 : Toggle Shadows" << std::endl;
 	std::cout << "F3 : Cycle Lighting Mode" << std::endl;
-	std::cout << "F4 : Cycle between Scenes\n" << std::endl;
+	std::cout << "F4 : Cycle between Scenes" << std::endl;
+	std::cout << "F5 : Cycle Acceleration Structure" << std::endl;
+	std::cout << "F6 : Cycle Primary Ray Packet Size" << std::endl;
+	std::cout << "F7 : Toggle Render Quality (Final / Preview)" << std::endl;
+	std::cout << "F8 : Cycle Tone Mapping" << std::endl;
+	std::cout << "PageUp / PageDown : Double / Halve Exposure" << std::endl;
+	std::cout << "F9 : Print Render Thread Times" << std::endl;
+	std::cout << "F10 : Toggle Present Latency Policy (Queue / Drop)" << std::endl;
+	std::cout << "F11 : Cycle Screenshot Format (BMP / PNG / PFM)\n" << std::endl;
 }
 
 int main(int argc, char* args[])
 {
 	PrintSettings();
 
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//--isa=sse|avx2|avx512 forces the kernels of one instruction set, for testing the older paths on a newer CPU
+	//--tile-size=N sets the side of the tiles the render threads pick up
+	//--pipelined updates the next frame's scene while the current one traces, see the render loop
+	//--back-buffers=2|3 sets how many frames can be resolved ahead of the window
+	uint32_t tileSize{};
+	uint32_t backBufferCount{ 2 };
+	bool isPipelined{};
+	for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+	{
+		const std::string_view argument{ args[argIdx] };
+		if (argument == "--pipelined")
+		{
+			isPipelined = true;
+			continue;
+		}
+		if (argument.starts_with("--back-buffers="))
+		{
+			backBufferCount = static_cast<uint32_t>(std::atoi(args[argIdx] + 15));
+			continue;
+		}
+		if (argument.starts_with("--tile-size="))
+		{
+			tileSize = static_cast<uint32_t>(std::atoi(args[argIdx] + 12));
+			continue;
+		}
+		if (!argument.starts_with("--isa=")) continue;
+
+		IsaLevel isaLevel{};
+		if (!Dispatch::ParseIsaLevel(argument.substr(6), isaLevel))
+			std::cout << "Unknown instruction set " << argument.substr(6) << ", expected sse, avx2 or avx512" << std::endl;
+		else if (!Dispatch::SelectIsaLevel(isaLevel))
+			std::cout << Dispatch::GetIsaName(isaLevel) << " is not supported by this CPU" << std::endl;
+	}
+	std::cout << "Kernels: " << Dispatch::GetIsaName(Dispatch::GetKernels().isaLevel)
+		<< " (CPU supports " << Dispatch::GetIsaName(Dispatch::DetectIsaLevel()) << ")\n" << std::endl;
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -70,12 +116,33 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(pWindow, backBufferCount);
+	if (tileSize > 0) pRenderer->SetTileSize(tileSize);
+	std::cout << "Rendering " << pRenderer->GetTileSize() << "x" << pRenderer->GetTileSize() << " tiles on " << pRenderer->GetThreadCount() << " threads"
+		<< (isPipelined ? ", pipelined" : "") << ", " << pRenderer->GetBackBufferCount() << " back buffers\n" << std::endl;
 
-	const auto pBunnyScene = new Scene_Bunny();
-	pBunnyScene->Initialize();
-	const auto pSphereScene = new Scene_W4();
-	pSphereScene->Initialize();
+	//the scenes are the only ones updated, the pipelined loop traces snapshots of them so the next frame can be updated meanwhile.
+	//Each scene has two snapshots used in turn: one is traced while the update of the next frame is synced into the other.
+	Scene* pScenes[int(WeeklyScenes::count)]{ new Scene_W4(), new Scene_Bunny() };
+	Scene* pSnapshots[int(WeeklyScenes::count)][2]{};
+	if (isPipelined)
+	{
+		for (Scene*& pSnapshot : pSnapshots[int(WeeklyScenes::SphereScene)]) pSnapshot = new Scene_W4();
+		for (Scene*& pSnapshot : pSnapshots[int(WeeklyScenes::BunnyScene)]) pSnapshot = new Scene_Bunny();
+	}
+	for (int sceneIdx{}; sceneIdx < int(WeeklyScenes::count); ++sceneIdx)
+	{
+		for (Scene* pScene : { pScenes[sceneIdx], pSnapshots[sceneIdx][0], pSnapshots[sceneIdx][1] })
+		{
+			if (!pScene) continue;
+			pScene->Initialize();
+			pScene->BuildAccelerationStructure();
+		}
+	}
+	//the scene whose next frame the previous iteration synced into pSnapshots[scene][snapshotIdx]
+	const Scene* pSyncedScene{};
+	int snapshotIdx{};
+	bool hasTracedFrame{};
 	
 	WeeklyScenes currentScene{ WeeklyScenes::SphereScene };
 	//Start loop
@@ -86,9 +153,11 @@ int main(int argc, char* args[])
 
 	float printTimer = 0.f;
 	bool isLooping = true;
-	bool takeScreenshot = false;
 	while (isLooping)
 	{
+		//the pipelined frame in flight has to finish before the input may change the renderer or the scenes
+		pRenderer->EndTrace();
+
 		//--------- Get input events ---------
 		SDL_Event e;
 		while (SDL_PollEvent(&e))
@@ -100,7 +169,13 @@ int main(int argc, char* args[])
 				break;
 			case SDL_KEYUP:
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
-					takeScreenshot = true;
+					pRenderer->CaptureFrame();
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_C)
+				{
+					pRenderer->ToggleContinuousCapture();
+					std::cout << "Capturing every frame: " << (pRenderer->IsCapturingContinuously() ? "on" : "off") << std::endl;
+				}
 
 				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
 					pRenderer->ToggleShadows();
@@ -113,28 +188,107 @@ int main(int argc, char* args[])
 					int current{ int(currentScene) };
 					currentScene = WeeklyScenes((current + 1) % int(WeeklyScenes::count));
 				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+				{
+					//the snapshot synced for the next frame still has the old structure, so it is synced again
+					Scene* pScene{ pScenes[int(currentScene)] };
+					pScene->SetAccelerator(AcceleratorType((int(pScene->GetAccelerator()) + 1) % int(AcceleratorType::count)));
+					pSyncedScene = nullptr;
+
+					const AcceleratorStats stats{ pScene->GetAcceleratorStats() };
+					std::cout << "Accelerator: " << stats.name << " (" << stats.primitiveCount << " primitives, " << stats.nodeCount << " nodes, "
+						<< stats.memoryUsage / 1024 << " KB, built in " << stats.buildTime << " ms)" << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+				{
+					pRenderer->CyclePacketSize();
+					const uint32_t packetSize{ pRenderer->GetPacketSize() };
+
+					//throughput of both ways on the current view, packets only pay off with the BVH accelerator
+					Scene* pScene{ pScenes[int(currentScene)] };
+					std::cout << "Primary rays: single " << pRenderer->MeasurePrimaryRays(pScene, 1) << " Mrays/s";
+					if (packetSize > 1)
+						std::cout << ", " << packetSize << "x" << packetSize << " packets " << pRenderer->MeasurePrimaryRays(pScene, packetSize) << " Mrays/s";
+					std::cout << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+				{
+					pRenderer->ToggleRenderQuality();
+					std::cout << "Render quality: " << (pRenderer->GetRenderQuality() == Renderer::RenderQuality::Final ? "Final" : "Preview") << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+				{
+					pRenderer->CycleToneMapping();
+					constexpr const char* toneMappingNames[]{ "MaxToOne", "Reinhard", "ACES" };
+					std::cout << "Tone mapping: " << toneMappingNames[int(pRenderer->GetResolveSettings().toneMapping)] << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_PAGEUP || e.key.keysym.scancode == SDL_SCANCODE_PAGEDOWN)
+				{
+					ResolveSettings settings{ pRenderer->GetResolveSettings() };
+					settings.exposure *= e.key.keysym.scancode == SDL_SCANCODE_PAGEUP ? 2.f : 0.5f;
+					pRenderer->SetResolveSettings(settings);
+					std::cout << "Exposure: " << settings.exposure << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					//idle time is the tail of the frame the thread spent without a tile to render
+					const std::vector<ThreadStats>& threadStats{ pRenderer->GetFrameThreadStats() };
+					for (uint32_t threadIdx{}; threadIdx < threadStats.size(); ++threadIdx)
+					{
+						const ThreadStats& stats{ threadStats[threadIdx] };
+						std::cout << "Thread " << threadIdx << ": busy " << stats.busyTime << " ms, idle " << stats.idleTime << " ms, "
+							<< stats.taskCount << " tiles (" << stats.stolenTaskCount << " stolen)" << std::endl;
+					}
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					pRenderer->CycleLatencyPolicy();
+					std::cout << "Present latency policy: " << (pRenderer->GetLatencyPolicy() == Presenter::LatencyPolicy::Queue ? "Queue" : "Drop") << std::endl;
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+				{
+					pRenderer->CycleExportFormat();
+					std::cout << "Screenshot format: " << ImageEncoding::GetExtension(pRenderer->GetExportFormat()) << std::endl;
+				}
 				break;
 			}
 		}
 
-		switch (currentScene)
+		Scene* pScene{ pScenes[int(currentScene)] };
+		if (!isPipelined)
 		{
-		case WeeklyScenes::SphereScene:
 			//--------- Update ---------
-			pSphereScene->Update(pTimer);
+			pScene->Update(pTimer);
 
 			//--------- Render ---------
-			pRenderer->Render(pSphereScene);
-			break;
-		case WeeklyScenes::BunnyScene:
-			//--------- Update ---------
-			pBunnyScene->Update(pTimer);
+			pRenderer->Render(pScene);
+		}
+		else
+		{
+			//the first frame and the first one after a scene switch trace the current state, there is no synced snapshot yet
+			Scene** pSceneSnapshots{ pSnapshots[int(currentScene)] };
+			if (pSyncedScene != pScene) pSceneSnapshots[snapshotIdx]->SyncDynamicState(*pScene);
 
 			//--------- Render ---------
-			pRenderer->Render(pBunnyScene);
-			break;
-		default:
-			break;
+			//frame N was synced during the previous iteration, it traces while frame N - 1 is shown and frame N + 1 is updated
+			pRenderer->BeginTrace(pSceneSnapshots[snapshotIdx]);
+			if (hasTracedFrame) pRenderer->Present();
+			hasTracedFrame = true;
+
+			//--------- Update ---------
+			//the other snapshot is idle, so the sync overlaps the trace as well
+			pScene->Update(pTimer);
+			snapshotIdx = 1 - snapshotIdx;
+			pSceneSnapshots[snapshotIdx]->SyncDynamicState(*pScene);
+			pSyncedScene = pScene;
 		}
 
 		//--------- Timer ---------
@@ -143,24 +297,31 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			//the window copy runs on the present thread, so it is reported apart from the frame time
+			const PresentStats presentStats{ pRenderer->TakePresentStats() };
+			std::cout << "dFPS: " << pTimer->GetdFPS() << " (present " << presentStats.presentTime / std::max(presentStats.presentedFrames, 1u)
+				<< " ms, " << presentStats.droppedFrames << " dropped)" << std::endl;
 		}
 
-		//Save screenshot after full render
-		if (takeScreenshot)
-		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
-			else
-				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
-			takeScreenshot = false;
-		}
+		//Screenshots are written in the background, report the ones that finished since the last frame
+		const ExportStats exportStats{ pRenderer->TakeExportStats() };
+		if (exportStats.writtenFiles > 0)
+			std::cout << "Screenshot saved: " << exportStats.lastFileName << (exportStats.writtenFiles > 1 ? " (+" + std::to_string(exportStats.writtenFiles - 1) + " more)" : "") << std::endl;
+		if (exportStats.failedFiles > 0)
+			std::cout << "Something went wrong. " << exportStats.failedFiles << " screenshot(s) not saved!" << std::endl;
+		if (exportStats.skippedCaptures > 0)
+			std::cout << exportStats.skippedCaptures << " screenshot(s) skipped, the disk can't keep up" << std::endl;
 	}
 	pTimer->Stop();
+	pRenderer->EndTrace();
 
 	//Shutdown "framework"
-	delete pBunnyScene;
-	delete pSphereScene;
+	for (int sceneIdx{}; sceneIdx < int(WeeklyScenes::count); ++sceneIdx)
+	{
+		delete pScenes[sceneIdx];
+		delete pSnapshots[sceneIdx][0];
+		delete pSnapshots[sceneIdx][1];
+	}
 	delete pRenderer;
 	delete pTimer;
 
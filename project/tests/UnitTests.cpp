@@ -2,9 +2,86 @@
 #include "../src/Vector3.h"
 #include "../src/Vector4.h"
 #include "../src/Matrix.h"
+#include "../src/Utils.h"
+#include "../src/Scene.h"
+#include "../src/SphereStore.h"
+#include "../src/Material.h"
+#include "../src/FastMath.h"
+#include "../src/ThreadPool.h"
+#include "../src/ImageExporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
 
 namespace dae
 {
+	namespace
+	{
+		//count random triangles with corners up to size from their centers, the centers spread over [-extent, extent]
+		TriangleMesh MakeTriangleSoup(std::mt19937& rng, int count, float extent, float size, TriangleCullMode cullMode)
+		{
+			std::uniform_real_distribution<float> position{ -extent, extent };
+			std::uniform_real_distribution<float> offset{ -size, size };
+
+			TriangleMesh mesh{};
+			mesh.cullMode = cullMode;
+			for (int triangleIdx{}; triangleIdx < count; ++triangleIdx)
+			{
+				const Vector3 center{ position(rng), position(rng), position(rng) };
+				mesh.AppendTriangle(Triangle{ center + Vector3{ offset(rng), offset(rng), offset(rng) },
+					center + Vector3{ offset(rng), offset(rng), offset(rng) },
+					center + Vector3{ offset(rng), offset(rng), offset(rng) } }, true);
+			}
+			return mesh;
+		}
+	}
+
+	TEST(ThreadPool, RunsEveryTaskOnce) {
+		for (uint32_t threadCount : { 1u, 4u })
+		{
+			ThreadPool pool{ threadCount };
+			EXPECT_EQ(threadCount, pool.GetThreadCount());
+
+			//many short jobs in a row, every worker has to pick up each of them
+			std::vector<std::atomic<uint32_t>> runCounts(1000);
+			for (int jobIdx{}; jobIdx < 50; ++jobIdx)
+			{
+				const uint32_t taskCount{ static_cast<uint32_t>(jobIdx * 20) };
+				pool.ParallelFor(taskCount, [&](uint32_t taskIdx) { runCounts[taskIdx].fetch_add(1); });
+			}
+
+			for (uint32_t taskIdx{}; taskIdx < runCounts.size(); ++taskIdx)
+			{
+				EXPECT_EQ(49 - taskIdx / 20, runCounts[taskIdx].load()) << taskIdx;
+			}
+
+			//only the first queue has slow tasks, the other threads have to steal them
+			std::vector<std::atomic<uint32_t>> unevenRunCounts(64);
+			pool.ParallelFor(64, [&](uint32_t taskIdx) {
+				if (taskIdx < 64 / threadCount) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				unevenRunCounts[taskIdx].fetch_add(1);
+				});
+			for (const std::atomic<uint32_t>& runCount : unevenRunCounts) EXPECT_EQ(1u, runCount.load());
+
+			const std::vector<ThreadStats>& stats{ pool.GetJobStats() };
+			ASSERT_EQ(threadCount, stats.size());
+			uint32_t taskCount{}, stolenTaskCount{};
+			for (const ThreadStats& threadStats : stats)
+			{
+				taskCount += threadStats.taskCount;
+				stolenTaskCount += threadStats.stolenTaskCount;
+			}
+			EXPECT_EQ(64u, taskCount);
+			EXPECT_EQ(threadCount > 1, stolenTaskCount > 0);
+		}
+	}
+
 	// W1
 	TEST(Vector3, DotProduct) {
 		EXPECT_EQ(1.0f, Vector3::Dot(Vector3::UnitX, Vector3::UnitX)); // (1) Same direction
@@ -35,6 +112,1019 @@ namespace dae
 		EXPECT_EQ(dae::Vector3(-3.0f, 6.0f, -3.0f), dae::Vector3::Cross(v1, v2));
 	}
 
+	//SIMD_MATH builds run the SSE types against the scalar formulas, scalar builds compare the implementation with itself
+	TEST(Vector3, MatchesScalarReference) {
+		std::mt19937 rng{ 5 };
+		std::uniform_real_distribution<float> value{ -10.f, 10.f };
+
+		for (int sampleIdx{}; sampleIdx < 1000; ++sampleIdx)
+		{
+			const float x1{ value(rng) }, y1{ value(rng) }, z1{ value(rng) };
+			const float x2{ value(rng) }, y2{ value(rng) }, z2{ value(rng) };
+			const float scale{ value(rng) };
+			const Vector3 v1{ x1, y1, z1 }, v2{ x2, y2, z2 };
+
+			const float tolerance{ 1e-5f * (1.f + std::abs(x1 * x2 + y1 * y2 + z1 * z2)) };
+			EXPECT_NEAR(x1 * x2 + y1 * y2 + z1 * z2, Vector3::Dot(v1, v2), tolerance);
+			EXPECT_NEAR(std::sqrt(x1 * x1 + y1 * y1 + z1 * z1), v1.Magnitude(), 1e-5f * v1.Magnitude());
+
+			const Vector3 cross{ Vector3::Cross(v1, v2) };
+			EXPECT_NEAR(y1 * z2 - z1 * y2, cross.x, 1e-4f);
+			EXPECT_NEAR(z1 * x2 - x1 * z2, cross.y, 1e-4f);
+			EXPECT_NEAR(x1 * y2 - y1 * x2, cross.z, 1e-4f);
+
+			const float magnitude{ std::sqrt(x1 * x1 + y1 * y1 + z1 * z1) };
+			const Vector3 normalized{ v1.Normalized() };
+			EXPECT_NEAR(x1 / magnitude, normalized.x, 1e-6f);
+			EXPECT_NEAR(y1 / magnitude, normalized.y, 1e-6f);
+			EXPECT_NEAR(z1 / magnitude, normalized.z, 1e-6f);
+
+			Vector3 normalizedInPlace{ v1 };
+			EXPECT_NEAR(magnitude, normalizedInPlace.Normalize(), 1e-5f * magnitude);
+			EXPECT_EQ(normalized, normalizedInPlace);
+
+			EXPECT_EQ(Vector3(x1 + x2, y1 + y2, z1 + z2), v1 + v2);
+			EXPECT_EQ(Vector3(x1 - x2, y1 - y2, z1 - z2), v1 - v2);
+			EXPECT_EQ(Vector3(x1 * scale, y1 * scale, z1 * scale), v1 * scale);
+			EXPECT_EQ(Vector3(x1 * scale, y1 * scale, z1 * scale), scale * v1);
+			EXPECT_EQ(Vector3(-x1, -y1, -z1), -v1);
+			EXPECT_EQ(Vector3(std::min(x1, x2), std::min(y1, y2), std::min(z1, z2)), Vector3::Min(v1, v2));
+			EXPECT_EQ(Vector3(std::max(x1, x2), std::max(y1, y2), std::max(z1, z2)), Vector3::Max(v1, v2));
+
+			const float reflectScale{ 2.f * (x1 * x2 + y1 * y2 + z1 * z2) };
+			const Vector3 reflect{ Vector3::Reflect(v1, v2) };
+			EXPECT_NEAR(x1 - reflectScale * x2, reflect.x, 1e-3f);
+			EXPECT_NEAR(y1 - reflectScale * y2, reflect.y, 1e-3f);
+			EXPECT_NEAR(z1 - reflectScale * z2, reflect.z, 1e-3f);
+
+			//colors
+			const ColorRGB c1{ std::abs(x1), std::abs(y1), std::abs(z1) }, c2{ std::abs(x2) + 1.f, std::abs(y2) + 1.f, std::abs(z2) + 1.f };
+			const ColorRGB product{ c1 * c2 }, quotient{ c1 / c2 }, sum{ c1 + c2 * scale };
+			EXPECT_FLOAT_EQ(c1.r * c2.r, product.r);
+			EXPECT_FLOAT_EQ(c1.b * c2.b, product.b);
+			EXPECT_FLOAT_EQ(c1.g / c2.g, quotient.g);
+			EXPECT_FLOAT_EQ(c1.r + c2.r * scale, sum.r);
+			EXPECT_FLOAT_EQ(c1.b + c2.b * scale, sum.b);
+		}
+	}
+
+	//the header-only math folds at compile time, SIMD_MATH only keeps the constructors and matrices constexpr
+	TEST(Matrix, EvaluatesAtCompileTime) {
+		constexpr Matrix transform{ Matrix::CreateScale(2.f, 2.f, 2.f) * Matrix::CreateTranslation(1.f, 2.f, 3.f) };
+		static_assert(transform.TransformPoint(1.f, 1.f, 1.f).x == 3.f);
+		static_assert(transform.TransformVector(Vector3::UnitZ).z == 2.f);
+		static_assert(transform.GetTranslation().y == 2.f);
+		static_assert(Vector4::Dot(Vector3::UnitX.ToPoint4(), { 1, 0, 0, 1 }) == 2.f);
+#if !defined(SIMD_MATH)
+		static_assert(Vector3::Dot(Vector3::Cross(Vector3::UnitX, Vector3::UnitY), Vector3::UnitZ) == 1.f);
+		static_assert((Vector3{ 1, 2, 3 } * 2.f - Vector3::UnitX)[2] == 6.f);
+#endif
+		EXPECT_EQ(Vector3(3.f, 4.f, 5.f), transform.TransformPoint(Vector3{ 1.f, 1.f, 1.f }));
+	}
+
+	//the fast tier has to stay within the bounds FastMath.h documents, over the ranges the shading code feeds it
+	TEST(FastMath, StaysWithinErrorBounds) {
+		std::mt19937 rng{ 31 };
+		std::uniform_real_distribution<float> exponent{ -30.f, 30.f };
+		std::uniform_real_distribution<float> power{ -126.f, 127.f };
+		std::uniform_real_distribution<float> cosine{ 1e-3f, 1.f };
+		std::uniform_real_distribution<float> phongExponent{ 1.f, 100.f };
+
+		static_assert(FastMath::Pow<5>(2.f) == 32.f);
+		EXPECT_EQ(0.f, FastMath::Pow(-.5f, 60.f));
+		EXPECT_EQ(0.f, FastMath::Pow(0.f, 2.f));
+
+		for (int sampleIdx{}; sampleIdx < 100000; ++sampleIdx)
+		{
+			const float x{ std::exp2(exponent(rng)) };
+			const double invSqrt{ 1.0 / std::sqrt(static_cast<double>(x)) };
+			ASSERT_LE(std::abs(FastMath::RSqrt(x) - invSqrt), 1e-6 * invSqrt) << x;
+
+			const double log2{ std::log2(static_cast<double>(x)) };
+			ASSERT_LE(std::abs(FastMath::Log2(x) - log2), 2e-7 + 1e-7 * std::abs(log2)) << x;
+
+			const float y{ power(rng) };
+			const double exp2{ std::exp2(static_cast<double>(y)) };
+			ASSERT_LE(std::abs(FastMath::Exp2(y) - exp2), 4e-7 * exp2) << y;
+
+			const float base{ cosine(rng) }, baseExponent{ phongExponent(rng) };
+			const double pow{ std::pow(static_cast<double>(base), static_cast<double>(baseExponent)) };
+			if (pow > 1e-37)
+			{
+				ASSERT_LE(std::abs(FastMath::Pow(base, baseExponent) - pow), 4e-7 * (1.0 + std::abs(baseExponent * std::log2(base))) * pow) << base << "^" << baseExponent;
+			}
+
+			const double pow5{ std::pow(static_cast<double>(base), 5.0) };
+			ASSERT_LE(std::abs(FastMath::Pow<5>(base) - pow5), 2.0 * FLT_EPSILON * pow5) << base;
+		}
+	}
+
+	// BVH
+	TEST(BVH, MatchesLinearTriangleLoop) {
+		std::mt19937 rng{ 1337 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> offset{ -.5f, .5f };
+
+		TriangleMesh mesh{ MakeTriangleSoup(rng, 500, 5.f, .5f, TriangleCullMode::NoCulling) };
+		mesh.UpdateTransforms();
+		ASSERT_FALSE(mesh.bvh.IsEmpty());
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 500; ++rayIdx)
+		{
+			const Ray ray{ { position(rng), position(rng), -10.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() };
+
+			HitRecord linearHit{};
+			for (size_t idx{}; idx < mesh.indices.size(); idx += 3)
+			{
+				Triangle triangle{ mesh.transformedPositions[mesh.indices[idx]], mesh.transformedPositions[mesh.indices[idx + 1]],
+					mesh.transformedPositions[mesh.indices[idx + 2]], mesh.transformedNormals[idx / 3] };
+				triangle.cullMode = mesh.cullMode;
+
+				//the records describe the same triangle, only the distance may differ in the last bits
+				HitRecord triangleHit{}, recordHit{};
+				const bool didHitTriangle{ GeometryUtils::HitTest_Triangle(triangle, ray, triangleHit) };
+				EXPECT_EQ(didHitTriangle, GeometryUtils::HitTest_Triangle(mesh.triangleRecords[idx / 3], mesh.cullMode, mesh.materialIndex, ray, recordHit));
+				if (didHitTriangle)
+				{
+					EXPECT_NEAR(triangleHit.t, recordHit.t, 1e-4f * triangleHit.t);
+				}
+
+				if (recordHit.didHit && recordHit.t < linearHit.t) linearHit = recordHit;
+			}
+
+			HitRecord bvhHit{};
+			GeometryUtils::HitTest_TriangleMesh(mesh, ray, bvhHit);
+
+			EXPECT_EQ(linearHit.didHit, bvhHit.didHit);
+			if (linearHit.didHit)
+			{
+				EXPECT_FLOAT_EQ(linearHit.t, bvhHit.t);
+			}
+			EXPECT_EQ(linearHit.didHit, GeometryUtils::HitTest_TriangleMesh(mesh, ray));
+			hitCount += linearHit.didHit;
+		}
+		EXPECT_GT(hitCount, 0);
+	}
+
+	TEST(BVH, RefitKeepsTopologyAndRebuildsWhenDegraded) {
+		std::mt19937 rng{ 99 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+
+		std::vector<AABB> bounds{};
+		for (int primitiveIdx{}; primitiveIdx < 256; ++primitiveIdx)
+		{
+			const Vector3 center{ position(rng), position(rng), position(rng) };
+			bounds.emplace_back(AABB{ center - Vector3{ .1f, .1f, .1f }, center + Vector3{ .1f, .1f, .1f } });
+		}
+
+		BVH bvh{};
+		bvh.Build(bounds);
+		const size_t nodeCount{ bvh.GetNodes().size() };
+		const float buildCost{ bvh.GetBuildCost() };
+
+		//rigid translation keeps the tree exactly as good
+		for (AABB& primitiveBounds : bounds)
+		{
+			primitiveBounds.min += Vector3{ 3.f, 0.f, 0.f };
+			primitiveBounds.max += Vector3{ 3.f, 0.f, 0.f };
+		}
+		bvh.Update(bounds);
+		EXPECT_EQ(nodeCount, bvh.GetNodes().size());
+		EXPECT_FLOAT_EQ(buildCost, bvh.GetBuildCost());
+		EXPECT_NEAR(bvh.GetBuildCost(), bvh.GetCost(), 1e-3f);
+		EXPECT_NEAR(8.1f, bvh.GetNodes()[0].maxAABB.x, 1.f);
+
+		//scrambling every primitive makes the refitted tree useless and forces a rebuild
+		std::shuffle(bounds.begin(), bounds.end(), rng);
+		bvh.Refit(bounds);
+		EXPECT_GT(bvh.GetCost(), buildCost * BVH::DefaultRebuildThreshold);
+		bvh.Update(bounds);
+		EXPECT_FLOAT_EQ(bvh.GetBuildCost(), bvh.GetCost());
+		EXPECT_LT(bvh.GetCost(), buildCost * BVH::DefaultRebuildThreshold);
+	}
+
+	TEST(BVH, LBVHMatchesSAH) {
+		std::mt19937 rng{ 4242 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> offset{ -.2f, .2f };
+
+		TriangleMesh sahMesh{ MakeTriangleSoup(rng, 5000, 5.f, .2f, TriangleCullMode::NoCulling) };
+
+		TriangleMesh lbvhMesh{ sahMesh };
+		lbvhMesh.bvhBuildMode = BVHBuildMode::LBVH;
+
+		sahMesh.UpdateTransforms();
+		lbvhMesh.UpdateTransforms();
+		EXPECT_EQ(sahMesh.bvh.GetPrimitiveCount(), lbvhMesh.bvh.GetPrimitiveCount());
+		EXPECT_GE(lbvhMesh.bvh.GetBuildTime(), 0.f);
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+		{
+			const Ray ray{ { position(rng), position(rng), -10.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() };
+
+			HitRecord sahHit{};
+			HitRecord lbvhHit{};
+			GeometryUtils::HitTest_TriangleMesh(sahMesh, ray, sahHit);
+			GeometryUtils::HitTest_TriangleMesh(lbvhMesh, ray, lbvhHit);
+
+			EXPECT_EQ(sahHit.didHit, lbvhHit.didHit);
+			if (sahHit.didHit)
+			{
+				EXPECT_FLOAT_EQ(sahHit.t, lbvhHit.t);
+			}
+			hitCount += sahHit.didHit;
+		}
+		EXPECT_GT(hitCount, 0);
+
+		//a pool splits the passes into chunks, enough primitives for all four threads, but the tree stays the same
+		std::vector<AABB> bounds(40000);
+		for (AABB& primitiveBounds : bounds)
+		{
+			const Vector3 center{ position(rng), position(rng), position(rng) };
+			primitiveBounds.Grow(center);
+			primitiveBounds.Grow(center + Vector3{ .1f, .1f, .1f });
+		}
+
+		ThreadPool threadPool{ 4 };
+		BVH serialBVH{}, pooledBVH{};
+		pooledBVH.SetThreadPool(&threadPool);
+		serialBVH.Build(bounds, BVHBuildMode::LBVH);
+		pooledBVH.Build(bounds, BVHBuildMode::LBVH);
+
+		EXPECT_EQ(serialBVH.GetPrimitiveIndices(), pooledBVH.GetPrimitiveIndices());
+		ASSERT_EQ(serialBVH.GetNodes().size(), pooledBVH.GetNodes().size());
+		for (size_t nodeIdx{}; nodeIdx < serialBVH.GetNodes().size(); ++nodeIdx)
+		{
+			EXPECT_EQ(serialBVH.GetNodes()[nodeIdx].leftFirst, pooledBVH.GetNodes()[nodeIdx].leftFirst);
+			EXPECT_EQ(serialBVH.GetNodes()[nodeIdx].primitiveCount, pooledBVH.GetNodes()[nodeIdx].primitiveCount);
+		}
+	}
+
+	TEST(BVH, SBVHMatchesSAHWithinBudget) {
+		std::mt19937 rng{ 1337 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> offset{ -.05f, .05f };
+
+		//long, thin triangles spanning most of the scene overlap badly with object splits only
+		TriangleMesh sahMesh{};
+		sahMesh.cullMode = TriangleCullMode::NoCulling;
+		for (int triangleIdx{}; triangleIdx < 2000; ++triangleIdx)
+		{
+			const Vector3 start{ position(rng), position(rng), position(rng) };
+			const Vector3 end{ position(rng), position(rng), position(rng) };
+			sahMesh.AppendTriangle(Triangle{ start, end, start + Vector3{ offset(rng), offset(rng), offset(rng) } }, true);
+		}
+
+		TriangleMesh sbvhMesh{ sahMesh };
+		sbvhMesh.bvhBuildMode = BVHBuildMode::SBVH;
+
+		sahMesh.UpdateTransforms();
+		sbvhMesh.UpdateTransforms();
+
+		const uint32_t primitiveCount{ sbvhMesh.bvh.GetPrimitiveCount() };
+		EXPECT_EQ(primitiveCount, 2000u);
+		EXPECT_GT(sbvhMesh.bvh.GetReferenceCount(), primitiveCount);
+		EXPECT_LE(sbvhMesh.bvh.GetReferenceCount(), static_cast<uint32_t>(primitiveCount * (1.f + BVH::DefaultSpatialSplitBudget)));
+		EXPECT_LT(sbvhMesh.bvh.GetCost(), sahMesh.bvh.GetCost());
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+		{
+			const Ray ray{ { position(rng), position(rng), -10.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() };
+
+			HitRecord sahHit{};
+			HitRecord sbvhHit{};
+			GeometryUtils::HitTest_TriangleMesh(sahMesh, ray, sahHit);
+			GeometryUtils::HitTest_TriangleMesh(sbvhMesh, ray, sbvhHit);
+
+			EXPECT_EQ(sahHit.didHit, sbvhHit.didHit);
+			if (sahHit.didHit)
+			{
+				EXPECT_FLOAT_EQ(sahHit.t, sbvhHit.t);
+			}
+			hitCount += sahHit.didHit;
+		}
+		EXPECT_GT(hitCount, 0);
+
+		//refitting keeps every duplicated reference valid
+		sbvhMesh.bvhUpdateMode = BVHUpdateMode::Refit;
+		sbvhMesh.UpdateTransforms();
+		EXPECT_EQ(sbvhMesh.bvh.GetPrimitiveCount(), primitiveCount);
+	}
+
+	TEST(BVH, WideLayoutsMatchBinary) {
+		std::mt19937 rng{ 777 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> offset{ -.2f, .2f };
+
+		TriangleMesh binaryMesh{ MakeTriangleSoup(rng, 3000, 5.f, .2f, TriangleCullMode::NoCulling) };
+
+		TriangleMesh wide4Mesh{ binaryMesh };
+		wide4Mesh.bvhLayout = BVHLayout::Wide4;
+		TriangleMesh wide8Mesh{ binaryMesh };
+		wide8Mesh.bvhLayout = BVHLayout::Wide8;
+
+		binaryMesh.UpdateTransforms();
+		wide4Mesh.UpdateTransforms();
+		wide8Mesh.UpdateTransforms();
+		ASSERT_FALSE(wide4Mesh.wideBVH4.IsEmpty());
+		ASSERT_FALSE(wide8Mesh.wideBVH8.IsEmpty());
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+		{
+			const Ray ray{ { position(rng), position(rng), -10.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() };
+
+			HitRecord binaryHit{};
+			HitRecord wide4Hit{};
+			HitRecord wide8Hit{};
+			GeometryUtils::HitTest_TriangleMesh(binaryMesh, ray, binaryHit);
+			GeometryUtils::HitTest_TriangleMesh(wide4Mesh, ray, wide4Hit);
+			GeometryUtils::HitTest_TriangleMesh(wide8Mesh, ray, wide8Hit);
+
+			EXPECT_EQ(binaryHit.didHit, wide4Hit.didHit);
+			EXPECT_EQ(binaryHit.didHit, wide8Hit.didHit);
+			if (binaryHit.didHit)
+			{
+				EXPECT_FLOAT_EQ(binaryHit.t, wide4Hit.t);
+				EXPECT_FLOAT_EQ(binaryHit.t, wide8Hit.t);
+			}
+			EXPECT_EQ(GeometryUtils::HitTest_TriangleMesh(binaryMesh, ray), GeometryUtils::HitTest_TriangleMesh(wide8Mesh, ray));
+			hitCount += binaryHit.didHit;
+
+			//the SIMD node test has to agree with the scalar slab test on every child
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			for (const WideBVHNode<8>& node : wide8Mesh.wideBVH8.GetNodes())
+			{
+				alignas(32) float distances[8];
+				float scalarDistances[8];
+				const int hitMask{ WideBVH<8>::IntersectChildren(node, ray.origin, invDirection, ray.min, ray.max, distances) };
+				const int scalarMask{ WideBVH<8>::IntersectChildren_Scalar(node, ray.origin, invDirection, ray.min, ray.max, scalarDistances) };
+
+				ASSERT_EQ(hitMask, scalarMask);
+				for (uint32_t childIdx{}; childIdx < node.childCount; ++childIdx)
+				{
+					if (hitMask & (1 << childIdx))
+					{
+						EXPECT_FLOAT_EQ(distances[childIdx], scalarDistances[childIdx]);
+					}
+				}
+			}
+		}
+		EXPECT_GT(hitCount, 0);
+	}
+
+	TEST(TriangleBlock, MatchesScalarRecords) {
+		std::mt19937 rng{ 4321 };
+		std::uniform_real_distribution<float> position{ -3.f, 3.f };
+
+		for (const TriangleCullMode cullMode : { TriangleCullMode::NoCulling, TriangleCullMode::BackFaceCulling, TriangleCullMode::FrontFaceCulling })
+		{
+			//LBVH leaves hold several triangles, so blocks are partially and completely filled
+			TriangleMesh singleMesh{ MakeTriangleSoup(rng, 1000, 3.f, .5f, cullMode) };
+			singleMesh.bvhBuildMode = BVHBuildMode::LBVH;
+
+			TriangleMesh block4Mesh{ singleMesh };
+			block4Mesh.triangleLayout = TriangleLayout::Block4;
+			TriangleMesh block8Mesh{ singleMesh };
+			block8Mesh.triangleLayout = TriangleLayout::Block8;
+			block8Mesh.bvhLayout = BVHLayout::Wide8;
+
+			singleMesh.UpdateTransforms();
+			block4Mesh.UpdateTransforms();
+			block8Mesh.UpdateTransforms();
+			ASSERT_FALSE(block4Mesh.triangleBlocks4.IsEmpty());
+			ASSERT_FALSE(block8Mesh.triangleBlocks8.IsEmpty());
+
+			int hitCount{};
+			for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+			{
+				const Vector3 start{ position(rng), position(rng), position(rng) };
+				const Vector3 toEnd{ Vector3{ position(rng), position(rng), position(rng) } - start };
+				Ray ray{ start, toEnd.Normalized() };
+				ray.max = toEnd.Magnitude();
+
+				HitRecord singleHit{}, block4Hit{}, block8Hit{};
+				GeometryUtils::HitTest_TriangleMesh(singleMesh, ray, singleHit);
+				GeometryUtils::HitTest_TriangleMesh(block4Mesh, ray, block4Hit);
+				GeometryUtils::HitTest_TriangleMesh(block8Mesh, ray, block8Hit);
+
+				EXPECT_EQ(singleHit.didHit, block4Hit.didHit);
+				EXPECT_EQ(singleHit.didHit, block8Hit.didHit);
+				//the scalar kernel may get fused multiply-adds from the compiler, the intrinsics never do
+				if (singleHit.didHit)
+				{
+					EXPECT_NEAR(singleHit.t, block4Hit.t, 1e-4f);
+					EXPECT_NEAR(singleHit.t, block8Hit.t, 1e-4f);
+				}
+
+				const bool occluded{ GeometryUtils::Occluded_TriangleMesh(singleMesh, ray) };
+				EXPECT_EQ(occluded, GeometryUtils::Occluded_TriangleMesh(block4Mesh, ray));
+				EXPECT_EQ(occluded, GeometryUtils::Occluded_TriangleMesh(block8Mesh, ray));
+				hitCount += singleHit.didHit;
+
+				//every lane has to agree with the scalar record test
+				for (const TriangleBlock<8>& block : block8Mesh.triangleBlocks8.GetBlocks())
+				{
+					alignas(32) float distances[8];
+					const int hitMask{ TriangleBlocks<8>::Intersect(block, ray.origin, ray.direction, ray.min, ray.max, GeometryUtils::GetCullSign(cullMode), distances) };
+					for (uint32_t lane{}; lane < block.count; ++lane)
+					{
+						HitRecord laneHit{};
+						const bool didHit{ GeometryUtils::HitTest_Triangle(block8Mesh.triangleRecords[block.triangleIdx[lane]], cullMode, 0, ray, laneHit) };
+						ASSERT_EQ(didHit, (hitMask & (1 << lane)) != 0);
+						if (didHit)
+						{
+							EXPECT_NEAR(laneHit.t, distances[lane], 1e-4f);
+						}
+					}
+				}
+			}
+			EXPECT_GT(hitCount, 0);
+		}
+	}
+
+	TEST(TriangleRecord, HitsSmallTriangles) {
+		for (const TriangleLayout layout : { TriangleLayout::Single, TriangleLayout::Block4, TriangleLayout::Block8 })
+		{
+			for (const float size : { 1.f, 1e-2f, 1e-4f, 1e-6f })
+			{
+				//shadow rays cull the other side, so both sides are hit
+				TriangleMesh mesh{};
+				mesh.cullMode = TriangleCullMode::NoCulling;
+				mesh.triangleLayout = layout;
+				mesh.AppendTriangle(Triangle{ Vector3{ 0.f, 0.f, 0.f }, Vector3{ size, 0.f, 0.f }, Vector3{ 0.f, size, 0.f } }, true);
+				mesh.UpdateTransforms();
+
+				Ray ray{ Vector3{ size / 4.f, size / 4.f, 1.f }, Vector3{ 0.f, 0.f, -1.f } };
+				HitRecord hit{};
+				GeometryUtils::HitTest_TriangleMesh(mesh, ray, hit);
+				EXPECT_TRUE(hit.didHit) << size;
+				EXPECT_NEAR(hit.t, 1.f, 1e-5f);
+				EXPECT_TRUE(GeometryUtils::Occluded_TriangleMesh(mesh, ray));
+
+				//grazing the plane of the triangle still misses
+				ray = Ray{ Vector3{ -size, size / 4.f, 0.f }, Vector3{ 1.f, 0.f, 0.f } };
+				EXPECT_FALSE(GeometryUtils::HitTest_TriangleMesh(mesh, ray));
+			}
+		}
+	}
+
+	TEST(Occlusion, MatchesShadowHitTests) {
+		std::mt19937 rng{ 99 };
+		std::uniform_real_distribution<float> position{ -3.f, 3.f };
+
+		for (const TriangleCullMode cullMode : { TriangleCullMode::NoCulling, TriangleCullMode::BackFaceCulling, TriangleCullMode::FrontFaceCulling })
+		{
+			TriangleMesh mesh{ MakeTriangleSoup(rng, 500, 3.f, .5f, cullMode) };
+			mesh.CalculateNormals();
+
+			TriangleMesh wideMesh{ mesh };
+			wideMesh.bvhLayout = BVHLayout::Wide8;
+
+			mesh.UpdateTransforms();
+			wideMesh.UpdateTransforms();
+
+			int occludedCount{};
+			for (int rayIdx{}; rayIdx < 2000; ++rayIdx)
+			{
+				//short rays between two points, like a shadow ray towards a light
+				const Vector3 start{ position(rng), position(rng), position(rng) };
+				const Vector3 toLight{ Vector3{ position(rng), position(rng), position(rng) } - start };
+				Ray ray{ start, toLight.Normalized() };
+				ray.max = toLight.Magnitude();
+
+				bool linearOccluded{};
+				for (size_t triangleIdx{}; triangleIdx < mesh.normals.size(); ++triangleIdx)
+				{
+					Triangle triangle{ mesh.transformedPositions[triangleIdx * 3], mesh.transformedPositions[triangleIdx * 3 + 1],
+						mesh.transformedPositions[triangleIdx * 3 + 2], mesh.transformedNormals[triangleIdx] };
+					triangle.cullMode = cullMode;
+
+					const bool occluded{ GeometryUtils::HitTest_Triangle(triangle, ray) };
+					EXPECT_EQ(occluded, GeometryUtils::Occluded_Triangle(triangle, ray));
+					linearOccluded |= occluded;
+				}
+
+				EXPECT_EQ(linearOccluded, GeometryUtils::Occluded_TriangleMesh(mesh, ray));
+				EXPECT_EQ(linearOccluded, GeometryUtils::Occluded_TriangleMesh(wideMesh, ray));
+				occludedCount += linearOccluded;
+			}
+			EXPECT_GT(occludedCount, 0);
+		}
+	}
+
+	TEST(MeshInstance, MatchesTransformedMesh) {
+		std::mt19937 rng{ 2024 };
+		std::uniform_real_distribution<float> position{ -1.f, 1.f };
+		std::uniform_real_distribution<float> offset{ -.3f, .3f };
+
+		TriangleMesh mesh{ MakeTriangleSoup(rng, 200, 1.f, .3f, TriangleCullMode::NoCulling) };
+		mesh.UpdateTransforms();
+		const auto pSharedMesh{ std::make_shared<const TriangleMesh>(mesh) };
+
+		mesh.Scale({ 1.5f, 1.5f, 1.5f });
+		mesh.RotateY(.7f);
+		mesh.Translate({ 1.f, -2.f, 3.f });
+		mesh.UpdateTransforms();
+
+		const MeshInstance instance{ pSharedMesh, mesh.scaleTransform * mesh.rotationTransform * mesh.translationTransform, 0 };
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 500; ++rayIdx)
+		{
+			const Ray ray{ { 1.f + 2.f * position(rng), -2.f + 2.f * position(rng), -5.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() };
+
+			HitRecord meshHit{};
+			HitRecord instanceHit{};
+			GeometryUtils::HitTest_TriangleMesh(mesh, ray, meshHit);
+			GeometryUtils::HitTest_MeshInstance(instance, ray, instanceHit);
+
+			EXPECT_EQ(meshHit.didHit, instanceHit.didHit);
+			if (!meshHit.didHit || !instanceHit.didHit) continue;
+
+			++hitCount;
+			EXPECT_NEAR(meshHit.t, instanceHit.t, 1e-3f);
+			EXPECT_NEAR(1.f, std::abs(Vector3::Dot(meshHit.normal.Normalized(), instanceHit.normal)), 1e-3f);
+		}
+		EXPECT_GT(hitCount, 0);
+	}
+
+	TEST(SphereStore, MatchesScalarSpheres) {
+		std::mt19937 rng{ 99 };
+		std::uniform_real_distribution<float> position{ -5.f, 5.f };
+		std::uniform_real_distribution<float> radius{ .1f, 1.f };
+
+		std::vector<Sphere> spheres{};
+		for (int sphereIdx{}; sphereIdx < 37; ++sphereIdx)
+		{
+			spheres.emplace_back(Sphere{ { position(rng), position(rng), position(rng) }, radius(rng), static_cast<unsigned char>(sphereIdx % 5) });
+		}
+
+		//shuffled primitive order where every third slot holds another primitive
+		std::vector<uint32_t> primitiveIndices{};
+		for (uint32_t sphereIdx{}; sphereIdx < spheres.size(); ++sphereIdx)
+		{
+			primitiveIndices.emplace_back(sphereIdx);
+			if (sphereIdx % 3 == 0) primitiveIndices.emplace_back(static_cast<uint32_t>(spheres.size()) + sphereIdx);
+		}
+		std::shuffle(primitiveIndices.begin(), primitiveIndices.end(), rng);
+
+		SphereStore naturalStore{};
+		naturalStore.Build(spheres);
+		SphereStore orderedStore{};
+		orderedStore.Build(spheres, primitiveIndices);
+		EXPECT_FALSE(naturalStore.HasEmptySlots());
+		EXPECT_TRUE(orderedStore.HasEmptySlots());
+
+		int hitCount{};
+		for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+		{
+			const Vector3 start{ position(rng), position(rng), position(rng) };
+			const Vector3 toEnd{ Vector3{ position(rng), position(rng), position(rng) } - start };
+			Ray ray{ start, toEnd.Normalized() };
+			ray.max = toEnd.Magnitude();
+
+			HitRecord scalarHit{};
+			for (const Sphere& sphere : spheres)
+			{
+				HitRecord sphereHit{};
+				if (GeometryUtils::HitTest_Sphere(sphere, ray, sphereHit) && sphereHit.t < scalarHit.t) scalarHit = sphereHit;
+			}
+
+			Ray naturalRay{ ray };
+			HitRecord naturalHit{};
+			EXPECT_EQ(scalarHit.didHit, naturalStore.HitTest(0, naturalStore.GetSlotCount(), naturalRay, naturalHit));
+			EXPECT_EQ(scalarHit.didHit, naturalStore.Occluded(0, naturalStore.GetSlotCount(), ray));
+
+			//odd sized ranges, so registers straddle range ends
+			Ray orderedRay{ ray };
+			HitRecord orderedHit{};
+			bool orderedOccluded{};
+			for (uint32_t firstSlot{}; firstSlot < orderedStore.GetSlotCount(); firstSlot += 5)
+			{
+				const uint32_t slotCount{ std::min(5u, orderedStore.GetSlotCount() - firstSlot) };
+				orderedStore.HitTest(firstSlot, slotCount, orderedRay, orderedHit);
+				orderedOccluded |= orderedStore.Occluded(firstSlot, slotCount, ray);
+			}
+			EXPECT_EQ(scalarHit.didHit, orderedHit.didHit);
+			EXPECT_EQ(scalarHit.didHit, orderedOccluded);
+
+			if (!scalarHit.didHit) continue;
+			++hitCount;
+			EXPECT_NEAR(scalarHit.t, naturalHit.t, 1e-4f);
+			EXPECT_NEAR(scalarHit.t, orderedHit.t, 1e-4f);
+			EXPECT_EQ(scalarHit.materialIndex, naturalHit.materialIndex);
+			EXPECT_NEAR(Vector3::Dot(scalarHit.normal, naturalHit.normal), 1.f, 1e-4f);
+			EXPECT_FLOAT_EQ(naturalRay.max, naturalHit.t);
+
+			float t{};
+			uint32_t slot{};
+			ASSERT_TRUE(orderedStore.IntersectNearest(0, orderedStore.GetSlotCount(), ray, t, slot));
+			EXPECT_EQ(spheres[orderedStore.GetSphereIdx(slot)].materialIndex, scalarHit.materialIndex);
+		}
+		EXPECT_GT(hitCount, 0);
+	}
+
+	// Scene
+	class Scene_RandomSpheres final : public Scene
+	{
+	public:
+		void Initialize() override
+		{
+			std::mt19937 rng{ 42 };
+			std::uniform_real_distribution<float> position{ -10.f, 10.f };
+			std::uniform_real_distribution<float> radius{ .1f, .6f };
+
+			for (int sphereIdx{}; sphereIdx < 1000; ++sphereIdx)
+			{
+				AddSphere({ position(rng), position(rng), position(rng) }, radius(rng));
+			}
+			AddPlane({ 0.f, 0.f, 12.f }, { 0.f, 0.f, -1.f });
+		}
+	};
+
+	void ExpectSceneMatchesLinearLoop(AcceleratorType accelerator)
+	{
+		SCOPED_TRACE(Accelerator::GetName(accelerator));
+
+		//switching after the build has to rebuild on its own
+		Scene_RandomSpheres scene{};
+		scene.Initialize();
+		scene.BuildAccelerationStructure();
+		scene.SetAccelerator(accelerator);
+		EXPECT_EQ(scene.GetAcceleratorStats().primitiveCount, scene.GetSphereGeometries().size());
+
+		std::mt19937 rng{ 7 };
+		std::uniform_real_distribution<float> position{ -10.f, 10.f };
+		std::uniform_real_distribution<float> offset{ -.3f, .3f };
+		std::uniform_real_distribution<float> direction{ -1.f, 1.f };
+
+		for (int rayIdx{}; rayIdx < 1000; ++rayIdx)
+		{
+			//half the rays come in from the front, the other half start inside the spheres in any direction
+			const Ray ray{ rayIdx % 2 == 0 ?
+				Ray{ { position(rng), position(rng), -15.f }, Vector3{ offset(rng), offset(rng), 1.f }.Normalized() } :
+				Ray{ { position(rng), position(rng), position(rng) }, Vector3{ direction(rng), direction(rng), direction(rng) }.Normalized() } };
+
+			HitRecord linearHit{};
+			for (const Sphere& sphere : scene.GetSphereGeometries())
+			{
+				HitRecord sphereHit{};
+				if (GeometryUtils::HitTest_Sphere(sphere, ray, sphereHit) && sphereHit.t < linearHit.t) linearHit = sphereHit;
+			}
+			for (const Plane& plane : scene.GetPlaneGeometries())
+			{
+				HitRecord planeHit{};
+				if (GeometryUtils::HitTest_Plane(plane, ray, planeHit) && planeHit.t < linearHit.t) linearHit = planeHit;
+			}
+
+			HitRecord sceneHit{};
+			scene.GetClosestHit(ray, sceneHit);
+
+			//spheres go through the SIMD store, the scalar loop may get fused multiply-adds from the compiler
+			EXPECT_EQ(linearHit.didHit, sceneHit.didHit);
+			EXPECT_NEAR(linearHit.t, sceneHit.t, 1e-4f);
+			EXPECT_EQ(linearHit.didHit, scene.DoesHit(ray));
+		}
+	}
+
+	TEST(Scene, TopLevelBVHMatchesLinearLoop) {
+		ExpectSceneMatchesLinearLoop(AcceleratorType::BVH);
+	}
+
+	TEST(Scene, UniformGridMatchesLinearLoop) {
+		ExpectSceneMatchesLinearLoop(AcceleratorType::Grid);
+	}
+
+	TEST(Scene, WideBVHAndLinearAcceleratorsMatchLinearLoop) {
+		ExpectSceneMatchesLinearLoop(AcceleratorType::Linear);
+		ExpectSceneMatchesLinearLoop(AcceleratorType::WideBVH4);
+		ExpectSceneMatchesLinearLoop(AcceleratorType::WideBVH8);
+	}
+
+	TEST(RayPacket, MatchesSingleRays) {
+		std::mt19937 rng{ 17 };
+		std::uniform_real_distribution<float> position{ -10.f, 10.f };
+		std::uniform_real_distribution<float> spread{ -.05f, .05f };
+		std::uniform_real_distribution<float> direction{ -1.f, 1.f };
+
+		Scene_RandomSpheres scene{};
+		scene.Initialize();
+		scene.BuildAccelerationStructure();
+
+		TriangleMesh mesh{};
+		for (int triangleIdx{}; triangleIdx < 500; ++triangleIdx)
+		{
+			const Vector3 center{ position(rng), position(rng), position(rng) };
+			mesh.AppendTriangle(Triangle{ center + Vector3{ 1.f, 0.f, 0.f }, center + Vector3{ 0.f, 1.f, 0.f }, center + Vector3{ 0.f, 0.f, 1.f } }, true);
+		}
+		mesh.UpdateTransforms();
+
+		int meshHitCount{};
+		for (int packetIdx{}; packetIdx < 50; ++packetIdx)
+		{
+			//camera-like bundles around one direction, every tenth packet scatters in all directions and has to fall back
+			const Vector3 origin{ position(rng), position(rng), -15.f };
+			const Vector3 centerDirection{ .3f + spread(rng), -.3f + spread(rng), 1.f };
+
+			RayPacket packet{};
+			for (uint32_t lane{}; lane < RayPacket::MaxSize; ++lane)
+			{
+				const Vector3 rayDirection{ packetIdx % 10 == 0 ?
+					Vector3{ direction(rng), direction(rng), direction(rng) } :
+					centerDirection + Vector3{ 4.f * spread(rng), 4.f * spread(rng), 0.f } };
+				packet.AddRay(Ray{ origin, rayDirection.Normalized() });
+			}
+			EXPECT_EQ(packetIdx % 10 != 0, packet.isCoherent);
+
+			for (const AcceleratorType accelerator : { AcceleratorType::BVH, AcceleratorType::Linear })
+			{
+				SCOPED_TRACE(Accelerator::GetName(accelerator));
+				scene.SetAccelerator(accelerator);
+
+				RayPacket scenePacket{ packet };
+				HitRecord packetHits[RayPacket::MaxSize]{};
+				scene.GetClosestHits(scenePacket, packetHits);
+
+				for (uint32_t lane{}; lane < packet.rayCount; ++lane)
+				{
+					HitRecord singleHit{};
+					scene.GetClosestHit(packet.GetRay(lane), singleHit);
+
+					EXPECT_EQ(singleHit.didHit, packetHits[lane].didHit);
+					EXPECT_FLOAT_EQ(singleHit.t, packetHits[lane].t);
+				}
+			}
+
+			for (const TriangleLayout layout : { TriangleLayout::Single, TriangleLayout::Block4 })
+			{
+				mesh.triangleLayout = layout;
+				mesh.UpdateTransforms();
+
+				RayPacket meshPacket{ packet };
+				HitRecord packetHits[RayPacket::MaxSize]{};
+				GeometryUtils::HitTest_TriangleMesh(mesh, meshPacket, packet.GetRayMask(), packetHits);
+
+				for (uint32_t lane{}; lane < packet.rayCount; ++lane)
+				{
+					HitRecord singleHit{};
+					GeometryUtils::HitTest_TriangleMesh(mesh, packet.GetRay(lane), singleHit);
+
+					EXPECT_EQ(singleHit.didHit, packetHits[lane].didHit);
+					EXPECT_FLOAT_EQ(singleHit.t, packetHits[lane].t);
+					if (singleHit.didHit)
+					{
+						EXPECT_FLOAT_EQ(meshPacket.max[lane], singleHit.t);
+					}
+					meshHitCount += singleHit.didHit;
+				}
+			}
+		}
+		EXPECT_GT(meshHitCount, 0);
+	}
+
+	//every instruction set the CPU supports has to give the results of the SSE kernels
+	TEST(Dispatch, KernelsMatchAcrossIsaLevels) {
+		std::mt19937 rng{ 23 };
+		std::uniform_real_distribution<float> position{ -3.f, 3.f };
+		std::uniform_real_distribution<float> offset{ -.5f, .5f };
+		std::uniform_real_distribution<float> color{ 0.f, 2.f };
+
+		IsaLevel parsedLevel{};
+		EXPECT_TRUE(Dispatch::ParseIsaLevel("avx2", parsedLevel));
+		EXPECT_EQ(IsaLevel::AVX2, parsedLevel);
+		EXPECT_FALSE(Dispatch::ParseIsaLevel("neon", parsedLevel));
+
+		//spheres with padding past the last slot, like SphereStore
+		constexpr uint32_t SphereCount{ 37 };
+		std::vector<float> sphereX(SphereCount + 16), sphereY(SphereCount + 16), sphereZ(SphereCount + 16), radiusSquared(SphereCount + 16, -1.f);
+		for (uint32_t sphereIdx{}; sphereIdx < SphereCount; ++sphereIdx)
+		{
+			sphereX[sphereIdx] = position(rng);
+			sphereY[sphereIdx] = position(rng);
+			sphereZ[sphereIdx] = position(rng);
+			radiusSquared[sphereIdx] = Square(std::abs(offset(rng)));
+		}
+		const SphereSlots spheres{ sphereX.data(), sphereY.data(), sphereZ.data(), radiusSquared.data() };
+
+		TriangleMesh mesh{ MakeTriangleSoup(rng, 300, 3.f, .5f, TriangleCullMode::BackFaceCulling) };
+		mesh.bvhBuildMode = BVHBuildMode::LBVH;
+		mesh.triangleLayout = TriangleLayout::Block8;
+		mesh.UpdateTransforms();
+		TriangleMesh block4Mesh{ mesh };
+		block4Mesh.triangleLayout = TriangleLayout::Block4;
+		block4Mesh.UpdateTransforms();
+
+		const KernelTable& reference{ Dispatch::GetKernels(IsaLevel::SSE) };
+		for (int levelIdx{ 1 }; levelIdx <= static_cast<int>(Dispatch::DetectIsaLevel()); ++levelIdx)
+		{
+			const KernelTable& kernels{ Dispatch::GetKernels(static_cast<IsaLevel>(levelIdx)) };
+			SCOPED_TRACE(Dispatch::GetIsaName(kernels.isaLevel));
+			ASSERT_EQ(static_cast<IsaLevel>(levelIdx), kernels.isaLevel);
+
+			int hitCount{};
+			for (int rayIdx{}; rayIdx < 300; ++rayIdx)
+			{
+				const Vector3 start{ position(rng), position(rng), position(rng) };
+				const Vector3 toEnd{ Vector3{ position(rng), position(rng), position(rng) } - start };
+				Ray ray{ start, toEnd.Normalized() };
+				ray.max = toEnd.Magnitude();
+
+				//odd ranges, so partial registers get tested as well
+				const uint32_t firstSlot{ static_cast<uint32_t>(rayIdx % 5) };
+				float referenceT{}, t{};
+				uint32_t referenceSlot{}, slot{};
+				const bool didHit{ reference.intersectSpheres(spheres, firstSlot, SphereCount - firstSlot, ray, referenceT, referenceSlot) };
+				ASSERT_EQ(didHit, kernels.intersectSpheres(spheres, firstSlot, SphereCount - firstSlot, ray, t, slot));
+				if (didHit)
+				{
+					EXPECT_EQ(referenceSlot, slot);
+					EXPECT_NEAR(referenceT, t, 1e-4f);
+				}
+				EXPECT_EQ(reference.occludedSpheres(spheres, firstSlot, SphereCount - firstSlot, ray), kernels.occludedSpheres(spheres, firstSlot, SphereCount - firstSlot, ray));
+				hitCount += didHit;
+
+				//FMA contraction may move t by an ulp, the hit masks have to agree
+				for (const TriangleBlock<8>& block : mesh.triangleBlocks8.GetBlocks())
+				{
+					alignas(32) float referenceDistances[8], distances[8];
+					const int hitMask{ reference.intersectTriangleBlock8(block, ray.origin, ray.direction, ray.min, ray.max, 0.f, referenceDistances) };
+					ASSERT_EQ(hitMask, kernels.intersectTriangleBlock8(block, ray.origin, ray.direction, ray.min, ray.max, 0.f, distances));
+					for (int lane{}; lane < 8; ++lane)
+					{
+						if (hitMask & (1 << lane))
+						{
+							EXPECT_NEAR(referenceDistances[lane], distances[lane], 1e-4f);
+						}
+					}
+				}
+				for (const TriangleBlock<4>& block : block4Mesh.triangleBlocks4.GetBlocks())
+				{
+					alignas(32) float referenceDistances[4], distances[4];
+					ASSERT_EQ(reference.intersectTriangleBlock4(block, ray.origin, ray.direction, ray.min, ray.max, 1.f, referenceDistances),
+						kernels.intersectTriangleBlock4(block, ray.origin, ray.direction, ray.min, ray.max, 1.f, distances));
+				}
+			}
+			EXPECT_GT(hitCount, 0);
+
+			//a partly filled packet against boxes around the origin
+			RayPacket packet{};
+			for (uint32_t lane{}; lane < 45; ++lane)
+			{
+				const Vector3 origin{ position(rng), position(rng), -10.f };
+				packet.AddRay(Ray{ origin, (Vector3{ position(rng), position(rng), 0.f } - origin).Normalized() });
+			}
+			for (int boxIdx{}; boxIdx < 100; ++boxIdx)
+			{
+				const Vector3 boxMin{ position(rng), position(rng), position(rng) };
+				const Vector3 boxMax{ boxMin + Vector3{ 1.f, 1.f, 1.f } };
+				const uint64_t rayMask{ packet.GetRayMask() & ~(uint64_t{ 1 } << boxIdx % 45) };
+				EXPECT_EQ(reference.intersectPacketBox(packet, boxMin, boxMax, rayMask), kernels.intersectPacketBox(packet, boxMin, boxMax, rayMask));
+			}
+
+			//pixels have to match what SDL_MapRGB made of the clamped color, in any channel layout
+			const PixelFormat format{ 0, 8, 16, 0, 0, 0, 0xff000000 };
+			std::vector<float> red(37), green(37), blue(37);
+			for (size_t pixelIdx{}; pixelIdx < red.size(); ++pixelIdx)
+			{
+				red[pixelIdx] = color(rng);
+				green[pixelIdx] = color(rng);
+				blue[pixelIdx] = color(rng);
+			}
+			std::vector<uint32_t> pixels(red.size());
+			kernels.resolvePixels(red.data(), green.data(), blue.data(), static_cast<uint32_t>(red.size()), ResolveSettings{}, format, pixels.data());
+			for (size_t pixelIdx{}; pixelIdx < red.size(); ++pixelIdx)
+			{
+				ColorRGB clamped{ red[pixelIdx], green[pixelIdx], blue[pixelIdx] };
+				clamped.MaxToOne();
+				const uint32_t expected{ static_cast<uint8_t>(clamped.r * 255) | static_cast<uint32_t>(static_cast<uint8_t>(clamped.g * 255)) << 8
+					| static_cast<uint32_t>(static_cast<uint8_t>(clamped.b * 255)) << 16 | 0xff000000 };
+				EXPECT_EQ(expected, pixels[pixelIdx]);
+			}
+
+			//exposure, Reinhard and gamma 2.2 against the std math, the fast pow may move a channel by one step
+			const ResolveSettings settings{ 1.5f, ToneMapping::Reinhard, 2.2f };
+			kernels.resolvePixels(red.data(), green.data(), blue.data(), static_cast<uint32_t>(red.size()), settings, format, pixels.data());
+			const auto resolveChannel{ [&](float value) {
+				const float toneMapped{ value * settings.exposure / (1.f + value * settings.exposure) };
+				return static_cast<int>(static_cast<uint8_t>(std::pow(toneMapped, 1.f / settings.gamma) * 255));
+				} };
+			for (size_t pixelIdx{}; pixelIdx < red.size(); ++pixelIdx)
+			{
+				EXPECT_NEAR(resolveChannel(red[pixelIdx]), static_cast<int>(pixels[pixelIdx] & 0xff), 1);
+				EXPECT_NEAR(resolveChannel(green[pixelIdx]), static_cast<int>(pixels[pixelIdx] >> 8 & 0xff), 1);
+				EXPECT_NEAR(resolveChannel(blue[pixelIdx]), static_cast<int>(pixels[pixelIdx] >> 16 & 0xff), 1);
+				EXPECT_EQ(0xff000000, pixels[pixelIdx] & 0xff000000);
+			}
+
+			//ACES stays within [0, 1] even for very bright colors
+			const float brightRed[]{ 1000.f }, brightGreen[]{ 0.f }, brightBlue[]{ 0.5f };
+			uint32_t brightPixel{};
+			kernels.resolvePixels(brightRed, brightGreen, brightBlue, 1, ResolveSettings{ 1.f, ToneMapping::Aces }, format, &brightPixel);
+			EXPECT_EQ(0xff0000ffu, brightPixel & 0xff0000ff);
+		}
+
+		//forcing a level switches the kernels everything else calls
+		const IsaLevel selectedLevel{ Dispatch::GetKernels().isaLevel };
+		EXPECT_TRUE(Dispatch::SelectIsaLevel(IsaLevel::SSE));
+		EXPECT_EQ(IsaLevel::SSE, Dispatch::GetKernels().isaLevel);
+		Dispatch::SelectIsaLevel(selectedLevel);
+	}
+
+	TEST(Material, ShadeBatchMatchesShade) {
+		std::mt19937 rng{ 29 };
+		std::uniform_real_distribution<float> coordinate{ -1.f, 1.f };
+		const auto randomDirection{ [&]() { return Vector3{ coordinate(rng), coordinate(rng), coordinate(rng) + 2.f }.Normalized(); } };
+
+		//l and v on the side of the normal, like the renderer hands them over
+		ShadingBatch batch{};
+		std::vector<HitRecord> hitRecords(45);
+		for (HitRecord& hitRecord : hitRecords)
+		{
+			hitRecord.normal = randomDirection();
+			const Vector3 l{ randomDirection() }, v{ randomDirection() };
+			batch.AddSample(hitRecord.normal, l, v);
+		}
+
+		Material_Lambert lambert{ { 0.9f, 0.2f, 0.4f }, 0.8f };
+		Material_LambertPhong lambertPhong{ colors::Blue, 0.5f, 0.5f, 60.f };
+		Material_CookTorrence metal{ { 0.972f, 0.960f, 0.915f }, 1.f, 0.1f };
+		Material_CookTorrence plastic{ { 0.75f, 0.75f, 0.75f }, 0.f, 0.6f };
+		Material* pMaterials[]{ &lambert, &lambertPhong, &metal, &plastic };
+
+		const IsaLevel selectedLevel{ Dispatch::GetKernels().isaLevel };
+		for (int levelIdx{}; levelIdx <= static_cast<int>(Dispatch::DetectIsaLevel()); ++levelIdx)
+		{
+			Dispatch::SelectIsaLevel(static_cast<IsaLevel>(levelIdx));
+			SCOPED_TRACE(Dispatch::GetIsaName(Dispatch::GetKernels().isaLevel));
+
+			for (Material* pMaterial : pMaterials)
+			{
+				for (MathTier tier : { MathTier::Exact, MathTier::Fast })
+				{
+					float red[ShadingBatch::MaxSize], green[ShadingBatch::MaxSize], blue[ShadingBatch::MaxSize];
+					pMaterial->ShadeBatch(batch, tier, red, green, blue);
+
+					for (uint32_t sampleIdx{}; sampleIdx < batch.count; ++sampleIdx)
+					{
+						const HitRecord& hitRecord{ hitRecords[sampleIdx] };
+						const Vector3 l{ batch.lightX[sampleIdx], batch.lightY[sampleIdx], batch.lightZ[sampleIdx] };
+						const Vector3 v{ batch.viewX[sampleIdx], batch.viewY[sampleIdx], batch.viewZ[sampleIdx] };
+						ColorRGB expected{ pMaterial->Shade(hitRecord, l, v) };
+
+						//the fast pow drops the lobe facing away from the viewer, powf mirrors it for even exponents
+						const Vector3 reflect{ l - 2.f * Vector3::Dot(l, hitRecord.normal) * hitRecord.normal };
+						if (tier == MathTier::Fast && pMaterial == &lambertPhong && Vector3::Dot(reflect, -v) <= 0.f) expected = BRDF::Lambert(0.5f, colors::Blue);
+
+						EXPECT_NEAR(expected.r, red[sampleIdx], 1e-4f * std::max(1.f, std::abs(expected.r)));
+						EXPECT_NEAR(expected.g, green[sampleIdx], 1e-4f * std::max(1.f, std::abs(expected.g)));
+						EXPECT_NEAR(expected.b, blue[sampleIdx], 1e-4f * std::max(1.f, std::abs(expected.b)));
+					}
+				}
+			}
+		}
+		Dispatch::SelectIsaLevel(selectedLevel);
+	}
+
+	TEST(ImageEncoding, WritesBmpPngAndPfm) {
+		//3x2, rows of (red, green, blue) and (white, gray, black) in the default 0x00RRGGBB layout
+		constexpr uint32_t width{ 3 }, height{ 2 };
+		const uint32_t pixels[]{ 0xFF0000, 0x00FF00, 0x0000FF, 0xFFFFFF, 0x808080, 0x000000 };
+		const PixelFormat pixelFormat{};
+		std::vector<uint8_t> bytes{};
+
+		//bottom row first, 3-byte BGR pixels padded to 12 bytes per row
+		ImageEncoding::EncodeBmp(pixels, width, height, pixelFormat, bytes);
+		ASSERT_EQ(54u + 12u * height, bytes.size());
+		EXPECT_EQ('B', bytes[0]);
+		EXPECT_EQ('M', bytes[1]);
+		EXPECT_EQ((std::vector<uint8_t>{ 0xFF, 0xFF, 0xFF, 0x80, 0x80, 0x80 }), std::vector<uint8_t>(bytes.begin() + 54, bytes.begin() + 60));
+		EXPECT_EQ((std::vector<uint8_t>{ 0x00, 0x00, 0xFF }), std::vector<uint8_t>(bytes.begin() + 66, bytes.begin() + 69));
+
+		//signature, IHDR, one IDAT with a single stored block and IEND
+		ImageEncoding::EncodePng(pixels, width, height, pixelFormat, bytes);
+		constexpr size_t rowsSize{ (1 + width * 3) * height };
+		ASSERT_EQ(8u + 25u + 12u + 2u + 5u + rowsSize + 4u + 12u, bytes.size());
+		EXPECT_EQ((std::vector<uint8_t>{ 0x89, 'P', 'N', 'G' }), std::vector<uint8_t>(bytes.begin(), bytes.begin() + 4));
+		EXPECT_EQ((std::vector<uint8_t>{ 0, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00 }), std::vector<uint8_t>(bytes.begin() + 48, bytes.begin() + 55));
+		//the CRC of an empty IEND chunk is fixed
+		EXPECT_EQ((std::vector<uint8_t>{ 0xAE, 0x42, 0x60, 0x82 }), std::vector<uint8_t>(bytes.end() - 4, bytes.end()));
+
+		//the float planes, bottom row first
+		const float red[]{ 1.f, 0.f, 0.f, 4.f, .5f, 0.f }, green[]{ 0.f, 1.f, 0.f, 4.f, .5f, 0.f }, blue[]{ 0.f, 0.f, 1.f, 4.f, .5f, 0.f };
+		ImageEncoding::EncodePfm(red, green, blue, width, height, bytes);
+		const std::string header{ "PF\n3 2\n-1.0\n" };
+		ASSERT_EQ(header.size() + width * height * 3 * sizeof(float), bytes.size());
+		EXPECT_EQ(header, std::string(bytes.begin(), bytes.begin() + header.size()));
+		float firstPixel[3]{};
+		std::memcpy(firstPixel, &bytes[header.size()], sizeof(firstPixel));
+		EXPECT_EQ(4.f, firstPixel[0]);
+		EXPECT_EQ(4.f, firstPixel[2]);
+	}
+
 	// W1
 
 	int main(int argc, char** argv) {